@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <boost/uuid/uuid_io.hpp>
+
+#include <Usagi/Asset/AssetRoot.hpp>
+#include <Usagi/Asset/Package/Archive/ArchiveAssetPackage.hpp>
+#include <Usagi/Asset/Package/Archive/ArchivePacker.hpp>
+#include <Usagi/Utility/Stream.hpp>
+
+using namespace usagi;
+
+namespace
+{
+void writeFile(const std::filesystem::path &path, const std::string &content)
+{
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+class AssetArchiveTest : public ::testing::Test
+{
+protected:
+    const std::filesystem::path mSource =
+        std::filesystem::temp_directory_path() / "usagi_archive_test";
+    const std::filesystem::path mArchive =
+        std::filesystem::temp_directory_path() / "usagi_archive_test.pak";
+
+    void SetUp() override
+    {
+        std::filesystem::remove_all(mSource);
+        writeFile(mSource / "readme.txt", "plain");
+        writeFile(mSource / "shaders/a.vert", "vertex shader");
+        writeFile(mSource / "shaders/b.frag", std::string(4096, 'x'));
+        writeFile(mSource / "empty", "");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(mSource);
+        std::filesystem::remove(mArchive);
+    }
+};
+}
+
+TEST_F(AssetArchiveTest, PackedAssetsAreFoundByPathAndUuid)
+{
+    ArchivePacker packer;
+    packer.addDirectory(mSource);
+    const auto stats = packer.write(mArchive);
+    EXPECT_EQ(stats.entries, 4);
+    EXPECT_EQ(stats.compressed_entries, 1);
+    EXPECT_LT(stats.archive_bytes, stats.content_bytes);
+
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets");
+    const auto pkg = assets->addChild<ArchiveAssetPackage>("Pak", mArchive);
+    EXPECT_EQ(pkg->entryCount(), 4);
+
+    const auto a = assets->findAsset("shaders/a.vert");
+    EXPECT_EQ(a->path(), "Pak:shaders/a.vert");
+    EXPECT_EQ(a->parentPath(), "Pak:shaders/");
+    EXPECT_EQ(a->map().asStringView(), "vertex shader");
+    EXPECT_EQ(readStreamAsString(*a->open()), "vertex shader");
+    EXPECT_EQ(a->uuid(), ArchivePacker::uuidFromPath("shaders/a.vert"));
+    EXPECT_EQ(assets->findAsset(
+        "{" + to_string(ArchivePacker::uuidFromPath("shaders/a.vert")) + "}"),
+        a);
+    EXPECT_EQ(assets->findAsset("Pak:./shaders/../shaders/a.vert"), a);
+
+    // compressed entry
+    const auto b = assets->findAsset("Pak:shaders/b.frag");
+    EXPECT_EQ(b->map().asStringView(), std::string(4096, 'x'));
+    EXPECT_EQ(readStreamAsString(*b->open()), std::string(4096, 'x'));
+
+    EXPECT_TRUE(assets->findAsset("empty")->map().empty());
+    EXPECT_EQ(pkg->findByString("shaders/c.frag"), nullptr);
+    EXPECT_EQ(pkg->findByUuid(ArchivePacker::uuidFromPath("c")), nullptr);
+    EXPECT_THROW(pkg->findByString("../readme.txt"), std::runtime_error);
+}
+
+TEST_F(AssetArchiveTest, UncompressedEntriesAreAligned)
+{
+    ArchivePacker packer;
+    packer.addDirectory(mSource, false);
+    packer.addFile("extra/readme.txt", mSource / "readme.txt");
+    EXPECT_EQ(packer.write(mArchive).compressed_entries, 0);
+
+    Element root { nullptr };
+    const auto pkg = root.addChild<ArchiveAssetPackage>("Pak", mArchive);
+    for(std::uint32_t i = 0; i < pkg->entryCount(); ++i)
+        EXPECT_EQ(pkg->entry(i).data_offset % ARCHIVE_DATA_ALIGNMENT, 0);
+    const auto extra = pkg->findByString("extra/readme.txt");
+    EXPECT_EQ(extra->map().asStringView(), "plain");
+    EXPECT_TRUE(extra->uuid().is_nil());
+
+    // the view keeps the archive mapped after the package is gone
+    const auto view = pkg->findByString("shaders/b.frag")->map();
+    root.removeChild(pkg);
+    EXPECT_EQ(view.asStringView(), std::string(4096, 'x'));
+}
+
+TEST_F(AssetArchiveTest, InvalidArchivesAreRejected)
+{
+    ArchivePacker packer;
+    packer.addFile("a", mSource / "readme.txt");
+    packer.addFile("./a", mSource / "empty");
+    EXPECT_THROW(packer.write(mArchive), std::runtime_error);
+
+    writeFile(mArchive, "not an archive");
+    Element root { nullptr };
+    EXPECT_THROW(root.addChild<ArchiveAssetPackage>("Pak", mArchive),
+        std::runtime_error);
+}
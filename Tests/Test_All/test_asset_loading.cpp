@@ -0,0 +1,308 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cctype>
+#include <sstream>
+#include <thread>
+
+#include <Usagi/Asset/AssetPackage.hpp>
+#include <Usagi/Asset/AssetRoot.hpp>
+#include <Usagi/Asset/Converter/SpirvAssetConverter.hpp>
+#include <Usagi/Asset/Decoder/MappedAssetDecoder.hpp>
+#include <Usagi/Asset/Decoder/RawAssetDecoder.hpp>
+#include <Usagi/Utility/TypeCast.hpp>
+
+using namespace usagi;
+
+namespace
+{
+class MemoryAsset : public Asset
+{
+    std::string mContent;
+
+public:
+    MemoryAsset(Element *parent, std::string name, std::string content)
+        : Asset { parent, std::move(name) }
+        , mContent { std::move(content) }
+    {
+    }
+
+    std::unique_ptr<std::istream> open() override
+    {
+        return std::make_unique<std::istringstream>(mContent);
+    }
+
+    std::string path() const override { return name(); }
+    std::string parentPath() const override { return { }; }
+};
+
+class MemoryAssetPackage : public AssetPackage
+{
+    bool acceptChild(Element *child) override
+    {
+        return is_instance_of<MemoryAsset>(child);
+    }
+
+public:
+    using AssetPackage::AssetPackage;
+
+    Asset * findByUuid(const boost::uuids::uuid &uuid) override
+    {
+        return nullptr;
+    }
+
+    Asset * findByString(const std::string &string) override
+    {
+        return static_cast<Asset*>(findChild(string));
+    }
+};
+
+/**
+ * \brief Creates the assets when they are first looked up, like the
+ * filesystem package does.
+ */
+class DiscoveringAssetPackage : public MemoryAssetPackage
+{
+public:
+    using MemoryAssetPackage::MemoryAssetPackage;
+
+    std::vector<std::thread::id> lookup_threads;
+
+    Asset * findByString(const std::string &string) override
+    {
+        lookup_threads.push_back(std::this_thread::get_id());
+        if(const auto asset = MemoryAssetPackage::findByString(string))
+            return asset;
+        return addChild<MemoryAsset>(string, "// " + string);
+    }
+};
+
+std::atomic<int> gConversions = 0;
+
+struct SlowStringConverter
+{
+    using DefaultDecoder = RawAssetDecoder;
+
+    std::shared_ptr<std::string> operator()(
+        AssetLoadingContext *ctx,
+        std::istream &in,
+        const std::string &suffix) const
+    {
+        ++gConversions;
+        // leave time for the other requests to arrive
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::string content;
+        in >> content;
+        if(content == "bad")
+            throw std::runtime_error("bad asset");
+        return std::make_shared<std::string>(content + suffix);
+    }
+};
+
+struct CaseConverter
+{
+    using DefaultDecoder = MappedAssetDecoder;
+
+    std::shared_ptr<std::string> operator()(
+        AssetLoadingContext *ctx,
+        const MemoryView &data,
+        const bool upper) const
+    {
+        ++gConversions;
+        std::string content { data.asStringView() };
+        for(auto &&c : content)
+            c = static_cast<char>(upper ? std::toupper(c) : std::tolower(c));
+        return std::make_shared<std::string>(std::move(content));
+    }
+
+    static std::uint64_t cacheVariant(const bool upper)
+    {
+        return upper;
+    }
+};
+
+struct MappedStringConverter
+{
+    using DefaultDecoder = MappedAssetDecoder;
+
+    std::shared_ptr<std::string> operator()(
+        AssetLoadingContext *ctx,
+        const MemoryView &data) const
+    {
+        return std::make_shared<std::string>(data.asStringView());
+    }
+};
+}
+
+TEST(AssetLoadingTest, ConcurrentRequestsShareOneLoad)
+{
+    JobSystem jobs(2);
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets", &jobs);
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("a", "hello");
+    gConversions = 0;
+
+    auto f1 = assets->resAsync<SlowStringConverter>("a", std::string("!"));
+    auto f2 = assets->resAsync<SlowStringConverter>("Memory:a",
+        std::string("?"));
+    // a synchronous request waits for the load in flight
+    const auto r = assets->res<SlowStringConverter>("a", std::string("."));
+
+    EXPECT_EQ(*r, "hello!");
+    EXPECT_EQ(f1.get(), r);
+    EXPECT_EQ(f2.get(), r);
+    EXPECT_EQ(gConversions, 1);
+
+    // cached while referenced
+    auto f3 = assets->resAsync<SlowStringConverter>("a", std::string("!"));
+    EXPECT_EQ(f3.wait_for(std::chrono::seconds(0)),
+        std::future_status::ready);
+    EXPECT_EQ(f3.get(), r);
+    EXPECT_EQ(gConversions, 1);
+}
+
+TEST(AssetLoadingTest, UnusedSubresourcesAreRetained)
+{
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets");
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("e", "kept");
+    gConversions = 0;
+
+    assets->res<SlowStringConverter>("e", std::string());
+    // no one holds it now but the cache
+    EXPECT_EQ(*assets->res<SlowStringConverter>("e", std::string()), "kept");
+    EXPECT_EQ(gConversions, 1);
+
+    assets->subresources()->setBudget(0);
+    assets->res<SlowStringConverter>("e", std::string());
+    EXPECT_EQ(gConversions, 2);
+    EXPECT_EQ(assets->subresources()->stats().hits, 1);
+}
+
+TEST(AssetLoadingTest, PackagePriorityOverridesAssets)
+{
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets");
+    const auto base = assets->addChild<MemoryAssetPackage>("Base");
+    const auto base_a = base->addChild<MemoryAsset>("a", "base");
+    base->addChild<MemoryAsset>("b", "base");
+    EXPECT_EQ(assets->findAsset("a"), base_a);
+
+    // a package mounted later overrides those of the same priority
+    const auto mod = assets->addChild<MemoryAssetPackage>("Mod");
+    const auto mod_a = mod->addChild<MemoryAsset>("a", "mod");
+    EXPECT_EQ(assets->findAsset("a"), mod_a);
+    EXPECT_EQ(assets->findAsset("Base:a"), base_a);
+
+    // but not those of higher priority
+    const auto patch = assets->addChild<MemoryAssetPackage>("Patch", 1);
+    const auto patch_b = patch->addChild<MemoryAsset>("b", "patch");
+    const auto low = assets->addChild<MemoryAssetPackage>("Low", -1);
+    low->addChild<MemoryAsset>("a", "low");
+    low->addChild<MemoryAsset>("c", "low");
+    EXPECT_EQ(assets->findAsset("a"), mod_a);
+    EXPECT_EQ(assets->findAsset("b"), patch_b);
+    EXPECT_NE(assets->findAsset("c"), nullptr);
+    EXPECT_THROW(assets->findAsset("d"), std::runtime_error);
+    EXPECT_THROW(assets->findAsset("Patch:a"), std::runtime_error);
+
+    // indexed entries of removed assets are not returned
+    mod->removeChild(mod_a);
+    EXPECT_EQ(assets->findAsset("a"), base_a);
+    assets->removeChild(patch);
+    EXPECT_EQ(assets->findAsset("b")->parent(), base);
+}
+
+TEST(AssetLoadingTest, FailedLoadIsRetried)
+{
+    JobSystem jobs(2);
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets", &jobs);
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("b", "bad");
+    gConversions = 0;
+
+    auto f1 = assets->resAsync<SlowStringConverter>("b", std::string());
+    auto f2 = assets->resAsync<SlowStringConverter>("b", std::string());
+    jobs.waitUntil([&]() {
+        return f1.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready;
+    });
+    EXPECT_THROW(f1.get(), std::runtime_error);
+    EXPECT_THROW(f2.get(), std::runtime_error);
+    EXPECT_EQ(gConversions, 1);
+
+    EXPECT_THROW(assets->res<SlowStringConverter>("b", std::string()),
+        std::runtime_error);
+    EXPECT_EQ(gConversions, 2);
+}
+
+TEST(AssetLoadingTest, LoadsWithoutJobSystem)
+{
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets");
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("c", "sync");
+
+    auto f = assets->resAsync<SlowStringConverter>("c", std::string("!"));
+    EXPECT_EQ(f.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_EQ(*f.get(), "sync!");
+    EXPECT_THROW(assets->resAsync<SlowStringConverter>("d", std::string()),
+        std::runtime_error);
+}
+
+TEST(AssetLoadingTest, ConverterVariantsAreCachedSeparately)
+{
+    JobSystem jobs(2);
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets", &jobs);
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("g", "MiXeD");
+    gConversions = 0;
+
+    const auto upper = assets->res<CaseConverter>("g", true);
+    const auto lower = assets->resAsync<CaseConverter>("g", false).get();
+    EXPECT_EQ(*upper, "MIXED");
+    EXPECT_EQ(*lower, "mixed");
+    EXPECT_EQ(gConversions, 2);
+
+    // both stay cached
+    EXPECT_EQ(assets->res<CaseConverter>("g", true), upper);
+    EXPECT_EQ(assets->resAsync<CaseConverter>("g", false).get(), lower);
+    EXPECT_EQ(gConversions, 2);
+}
+
+TEST(AssetLoadingTest, DecodersCanConsumeMappedContent)
+{
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets");
+    const auto pkg = assets->addChild<MemoryAssetPackage>("Memory");
+    pkg->addChild<MemoryAsset>("f", "in memory");
+
+    EXPECT_EQ(*assets->res<MappedStringConverter>("f"), "in memory");
+}
+
+TEST(AssetLoadingTest, ShaderIncludesAreLocatedOnMainThread)
+{
+    JobSystem jobs(2);
+    Element root { nullptr };
+    const auto assets = root.addChild<AssetRoot>("Assets", &jobs);
+    const auto pkg = assets->addChild<DiscoveringAssetPackage>("Memory");
+    AssetGlslIncluder includer { assets };
+
+    std::optional<GlslIncluder::Include> include;
+    JobCounter counter;
+    jobs.submit([&]() {
+        include = includer.include("common.glsl", { }, false);
+    }, &counter);
+    jobs.wait(counter);
+
+    ASSERT_TRUE(include);
+    EXPECT_EQ(include->name, "common.glsl");
+    EXPECT_EQ(include->content.asStringView(), "// common.glsl");
+    ASSERT_FALSE(pkg->lookup_threads.empty());
+    for(auto &&t : pkg->lookup_threads)
+        EXPECT_EQ(t, std::this_thread::get_id());
+}
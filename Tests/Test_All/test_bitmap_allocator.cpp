@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <Usagi/Runtime/Memory/BitmapMemoryAllocator.hpp>
+
+using namespace usagi;
+
+namespace
+{
+std::size_t offset(void *p)
+{
+    return reinterpret_cast<std::size_t>(p);
+}
+}
+
+TEST(BitmapAllocatorTest, AllocateAndFree)
+{
+    BitmapMemoryAllocator alloc { nullptr, 1000, 10 };
+    EXPECT_EQ(alloc.usableSize(), 1000);
+
+    const auto a = alloc.allocate(15);
+    const auto b = alloc.allocate(10);
+    EXPECT_EQ(offset(a), 0);
+    EXPECT_EQ(offset(b), 20);
+    EXPECT_EQ(alloc.usedSize(), 30);
+
+    alloc.deallocate(a);
+    EXPECT_EQ(alloc.usedSize(), 10);
+    // first fit reuses the hole
+    EXPECT_EQ(offset(alloc.allocate(20)), 0);
+    EXPECT_THROW(alloc.allocate(1000), std::bad_alloc);
+    EXPECT_THROW(alloc.allocate(0), std::invalid_argument);
+}
+
+TEST(BitmapAllocatorTest, RunsAcrossWords)
+{
+    // 200 blocks span four words
+    BitmapMemoryAllocator alloc { nullptr, 200, 1 };
+    const auto a = alloc.allocate(60);
+    const auto b = alloc.allocate(100);
+    EXPECT_EQ(offset(b), 60);
+    EXPECT_EQ(alloc.usableSize(), 40);
+    EXPECT_THROW(alloc.allocate(41), std::bad_alloc);
+    alloc.deallocate(b);
+    const auto c = alloc.allocate(140);
+    EXPECT_EQ(offset(c), 60);
+    EXPECT_EQ(alloc.usableSize(), 0);
+    alloc.deallocate(a);
+    alloc.deallocate(c);
+    EXPECT_EQ(alloc.usedSize(), 0);
+}
+
+TEST(BitmapAllocatorTest, Alignment)
+{
+    BitmapMemoryAllocator alloc { nullptr, 64 * 256, 256 };
+    alloc.allocate(1);
+    const auto a = alloc.allocate(256, 1024);
+    EXPECT_EQ(offset(a), 1024);
+    // smaller than the blocks
+    const auto b = alloc.allocate(1, 64);
+    EXPECT_EQ(offset(b), 256);
+    EXPECT_THROW(alloc.allocate(1, 3), std::invalid_argument);
+
+    // block starts never aligned: the address is aligned within the block
+    BitmapMemoryAllocator odd { reinterpret_cast<void*>(8), 1000, 100 };
+    const auto c = odd.allocate(50, 16);
+    EXPECT_EQ(offset(c) % 16, 0);
+    odd.deallocate(c);
+    EXPECT_EQ(odd.usedSize(), 0);
+}
+
+TEST(BitmapAllocatorTest, ConcurrentAllocation)
+{
+    constexpr std::size_t BLOCKS = 4096;
+    BitmapMemoryAllocator alloc { nullptr, BLOCKS, 1 };
+    std::vector<std::uint8_t> owner(BLOCKS, 0);
+
+    const auto worker = [&](const std::uint8_t id) {
+        std::vector<std::pair<std::size_t, std::size_t>> mine;
+        for(int round = 0; round < 20000; ++round)
+        {
+            const std::size_t size = 1 + (round * 7 + id) % 80;
+            try
+            {
+                const auto p = offset(alloc.allocate(size));
+                for(std::size_t i = p; i < p + size; ++i)
+                {
+                    // never handed out twice
+                    EXPECT_EQ(owner[i], 0);
+                    owner[i] = id;
+                }
+                mine.emplace_back(p, size);
+            }
+            catch(const std::bad_alloc &)
+            {
+            }
+            if(mine.size() > 8 || (round % 3 == 0 && !mine.empty()))
+            {
+                const auto [p, s] = mine.front();
+                mine.erase(mine.begin());
+                for(std::size_t i = p; i < p + s; ++i)
+                    owner[i] = 0;
+                alloc.deallocate(reinterpret_cast<void*>(p));
+            }
+        }
+        for(auto &&[p, s] : mine)
+        {
+            for(std::size_t i = p; i < p + s; ++i)
+                owner[i] = 0;
+            alloc.deallocate(reinterpret_cast<void*>(p));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(std::uint8_t i = 1; i <= 4; ++i)
+        threads.emplace_back(worker, i);
+    for(auto &&t : threads) t.join();
+    EXPECT_EQ(alloc.usedSize(), 0);
+}
+
+TEST(BitmapAllocatorTest, Statistics)
+{
+    BitmapMemoryAllocator alloc { nullptr, 100, 1 };
+    const auto a = alloc.allocate(30);
+    const auto b = alloc.allocate(10);
+    const auto c = alloc.allocate(30);
+    alloc.deallocate(b);
+
+    const auto stats = alloc.stats();
+    EXPECT_EQ(stats.managed_bytes, 100);
+    EXPECT_EQ(stats.used_bytes, 60);
+    EXPECT_EQ(stats.peak_used_bytes, 70);
+    EXPECT_EQ(stats.total_allocations, 3);
+    EXPECT_EQ(stats.total_deallocations, 1);
+    EXPECT_EQ(stats.liveAllocations(), 2);
+    EXPECT_EQ(stats.total_allocated_bytes, 70);
+    // the free space is split into 10 and 30 bytes
+    EXPECT_EQ(stats.largest_free_bytes, 30);
+    EXPECT_DOUBLE_EQ(stats.fragmentation(), 0.25);
+
+    alloc.deallocate(a);
+    alloc.deallocate(c);
+    EXPECT_EQ(alloc.stats().fragmentation(), 0);
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <Usagi/Core/Component.hpp>
+#include <Usagi/Core/Element.hpp>
+
+using namespace usagi;
+
+namespace
+{
+struct PositionComponent : Component
+{
+    float x = 0, y = 0;
+
+    const std::type_info & baseType() override final
+    {
+        return typeid(PositionComponent);
+    }
+};
+
+struct VelocityComponent : Component
+{
+    float dx = 1, dy = 2;
+
+    const std::type_info & baseType() override
+    {
+        return typeid(VelocityComponent);
+    }
+};
+
+struct DampedVelocityComponent : VelocityComponent
+{
+    float damping = 0.5f;
+};
+
+struct TrackedComponent : Component
+{
+    bool *destroyed = nullptr;
+
+    TrackedComponent() = default;
+
+    explicit TrackedComponent(bool *destroyed)
+        : destroyed { destroyed }
+    {
+    }
+
+    ~TrackedComponent()
+    {
+        if(destroyed) *destroyed = true;
+    }
+
+    const std::type_info & baseType() override final
+    {
+        return typeid(TrackedComponent);
+    }
+};
+}
+
+TEST(ComponentStorageTest, AddGetRemove)
+{
+    Element e { nullptr };
+    EXPECT_FALSE(e.hasComponent<PositionComponent>());
+    EXPECT_EQ(e.findComponent<PositionComponent>(), nullptr);
+    EXPECT_THROW(e.getComponent<PositionComponent>(), std::runtime_error);
+
+    const auto pos = e.addComponent<PositionComponent>();
+    pos->x = 3;
+    EXPECT_TRUE(e.hasComponent<PositionComponent>());
+    EXPECT_EQ(e.getComponent<PositionComponent>(), pos);
+    EXPECT_THROW(e.addComponent<PositionComponent>(), std::runtime_error);
+
+    // adding another type moves the element to another archetype but the
+    // component itself stays in place
+    const auto vel = e.addComponent<VelocityComponent>();
+    EXPECT_EQ(e.getComponent<PositionComponent>(), pos);
+    EXPECT_EQ(e.getComponent<VelocityComponent>(), vel);
+    EXPECT_FLOAT_EQ(pos->x, 3);
+    EXPECT_EQ(e.componentMask(),
+        (componentMask<PositionComponent, VelocityComponent>()));
+
+    e.removeComponent<PositionComponent>();
+    EXPECT_FALSE(e.hasComponent<PositionComponent>());
+    EXPECT_EQ(e.getComponent<VelocityComponent>(), vel);
+    EXPECT_THROW(e.removeComponent<PositionComponent>(), std::runtime_error);
+}
+
+TEST(ComponentStorageTest, PolymorphicComponent)
+{
+    Element e { nullptr };
+    e.addComponent<DampedVelocityComponent>();
+    EXPECT_NE(e.getComponent<VelocityComponent>(), nullptr);
+    const auto damped = e.getComponent<
+        VelocityComponent, DampedVelocityComponent>();
+    ASSERT_NE(damped, nullptr);
+    EXPECT_FLOAT_EQ(damped->damping, 0.5f);
+}
+
+TEST(ComponentStorageTest, UnmanagedComponent)
+{
+    bool destroyed = false;
+    TrackedComponent tracked { &destroyed };
+    {
+        Element e { nullptr };
+        e.addComponent(&tracked);
+        EXPECT_EQ(e.getComponent<TrackedComponent>(), &tracked);
+    }
+    // the element must not have destroyed the component
+    EXPECT_FALSE(destroyed);
+    tracked.destroyed = nullptr;
+}
+
+TEST(ComponentStorageTest, ManagedComponentDestroyed)
+{
+    bool destroyed = false;
+    {
+        Element e { nullptr };
+        e.addComponent<TrackedComponent>(&destroyed);
+        EXPECT_FALSE(destroyed);
+    }
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(ComponentStorageTest, SwapRemoveKeepsOtherElements)
+{
+    Element root { nullptr };
+    std::vector<Element*> elements;
+    std::vector<PositionComponent*> positions;
+    for(int i = 0; i < 100; ++i)
+    {
+        const auto e = root.addChild();
+        const auto p = e->addComponent<PositionComponent>();
+        p->x = static_cast<float>(i);
+        elements.push_back(e);
+        positions.push_back(p);
+    }
+    // moving elements out of the archetype swaps the last rows in
+    for(int i = 0; i < 100; i += 3)
+        elements[i]->addComponent<VelocityComponent>();
+    for(int i = 0; i < 100; ++i)
+    {
+        EXPECT_EQ(elements[i]->getComponent<PositionComponent>(),
+            positions[i]);
+        EXPECT_FLOAT_EQ(positions[i]->x, static_cast<float>(i));
+        EXPECT_EQ(elements[i]->hasComponent<VelocityComponent>(), i % 3 == 0);
+    }
+    root.removeChild(elements[1]);
+    EXPECT_EQ(elements[2]->getComponent<PositionComponent>(), positions[2]);
+}
+
+TEST(ComponentStorageTest, ArchetypeIteration)
+{
+    Element root { nullptr };
+    for(int i = 0; i < 10; ++i)
+    {
+        const auto e = root.addChild();
+        e->addComponent<PositionComponent>();
+        if(i % 2) e->addComponent<VelocityComponent>();
+    }
+    std::size_t count = 0;
+    ComponentDatabase::global().forEachArchetype(
+        componentMask<PositionComponent, VelocityComponent>(),
+        [&](Archetype *a) {
+            for(auto &&s : a->column(componentTypeId<VelocityComponent>()))
+            {
+                EXPECT_NE(s.component, nullptr);
+                ++count;
+            }
+        }
+    );
+    EXPECT_EQ(count, 5);
+}
+
+TEST(ComponentStorageTest, ArenaAllocation)
+{
+    ElementArena arena;
+    {
+        Element root { nullptr };
+        root.setArena(&arena);
+        const auto a = root.addChild("a");
+        // inherited by the children
+        const auto b = a->addChild("b");
+        b->addComponent<PositionComponent>();
+        b->addComponent<DampedVelocityComponent>();
+        EXPECT_EQ(arena.elementPool<Element>().size(), 2);
+        EXPECT_EQ(arena.componentPool<PositionComponent>().size(), 1);
+        EXPECT_EQ(arena.componentPool<DampedVelocityComponent>().size(), 1);
+        EXPECT_EQ(arena.size(), 4);
+
+        // freed storage is reused
+        root.removeChild(a);
+        EXPECT_EQ(arena.size(), 0);
+        const auto bytes = arena.reservedBytes();
+        EXPECT_GT(bytes, 0);
+        const auto c = root.addChild("c");
+        c->addComponent<PositionComponent>();
+        EXPECT_EQ(arena.reservedBytes(), bytes);
+        EXPECT_EQ(arena.size(), 2);
+    }
+    // all objects are released before the arena
+    EXPECT_EQ(arena.size(), 0);
+}
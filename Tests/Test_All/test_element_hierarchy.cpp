@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <Usagi/Core/Element.hpp>
+
+using namespace usagi;
+
+TEST(ElementHierarchyTest, HandlesAreGenerational)
+{
+    Element root { nullptr };
+    const auto a = root.addChild("a");
+    const auto handle = a->handle();
+    EXPECT_TRUE(handle.valid());
+    EXPECT_EQ(Element::fromHandle(handle), a);
+
+    root.removeChild(a);
+    EXPECT_EQ(Element::fromHandle(handle), nullptr);
+
+    // the slot is reused with a new generation
+    const auto b = root.addChild("b");
+    EXPECT_EQ(b->handle().index, handle.index);
+    EXPECT_NE(b->handle(), handle);
+    EXPECT_EQ(Element::fromHandle(handle), nullptr);
+    EXPECT_EQ(Element::fromHandle(b->handle()), b);
+    EXPECT_EQ(Element::fromHandle(ElementHandle { }), nullptr);
+}
+
+TEST(ElementHierarchyTest, ChildLookupByName)
+{
+    Element root { nullptr };
+    Element other { nullptr };
+    std::vector<Element *> children;
+    // enough children to build the name index
+    for(int i = 0; i < 100; ++i)
+        children.push_back(root.addChild(std::to_string(i)));
+
+    EXPECT_EQ(root.findChild("42"), children[42]);
+    EXPECT_EQ(root.findChild("100"), nullptr);
+    EXPECT_TRUE(root.hasChild(children[7]));
+    EXPECT_FALSE(other.hasChild(children[7]));
+
+    // the child added first wins among those with the same name
+    const auto dup = root.addChild("42");
+    EXPECT_EQ(root.findChild("42"), children[42]);
+    root.removeChild("42");
+    EXPECT_EQ(root.findChild("42"), dup);
+
+    children[3]->setName("renamed");
+    EXPECT_EQ(root.findChild("3"), nullptr);
+    EXPECT_EQ(root.findChild("renamed"), children[3]);
+    EXPECT_THROW(root.removeChild("3"), std::runtime_error);
+
+    // removal keeps the order of the other children
+    root.removeChild(children[0]);
+    EXPECT_EQ(root.childByIndex(0), children[1]);
+    EXPECT_EQ(root.childrenCount(), 99);
+}
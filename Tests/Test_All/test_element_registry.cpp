@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include <Usagi/Core/Clock.hpp>
+#include <Usagi/Core/Component.hpp>
+#include <Usagi/Core/Element.hpp>
+#include <Usagi/Game/CollectionSystem.hpp>
+#include <Usagi/Game/ElementRegistry.hpp>
+
+using namespace usagi;
+
+namespace
+{
+struct ValueComponent : Component
+{
+    int value = 0;
+
+    const std::type_info & baseType() override final
+    {
+        return typeid(ValueComponent);
+    }
+};
+
+struct TagComponent : Component
+{
+    const std::type_info & baseType() override final
+    {
+        return typeid(TagComponent);
+    }
+};
+
+struct SumSystem : CollectionSystem<ValueComponent, TagComponent>
+{
+    int sum = 0;
+
+    void update(const Clock &clock) override
+    {
+        sum = 0;
+        forEach([&](Element *, ValueComponent &v, TagComponent &) {
+            sum += v.value;
+        });
+    }
+
+    const std::type_info & type() override
+    {
+        return typeid(SumSystem);
+    }
+
+    const Registry & registry() const { return mRegistry; }
+};
+}
+
+TEST(ElementRegistryTest, InsertErase)
+{
+    Element root { nullptr };
+    ElementRegistry<ValueComponent> registry;
+    std::vector<Element *> elements;
+    for(int i = 0; i < 10; ++i)
+    {
+        const auto e = root.addChild();
+        e->addComponent<ValueComponent>()->value = i;
+        EXPECT_TRUE(registry.insertOrAssign(
+            e, e->getComponent<ValueComponent>()));
+        elements.push_back(e);
+    }
+    EXPECT_FALSE(registry.insertOrAssign(
+        elements[0], elements[0]->getComponent<ValueComponent>()));
+    EXPECT_EQ(registry.size(), 10);
+
+    EXPECT_TRUE(registry.erase(elements[3]));
+    EXPECT_FALSE(registry.erase(elements[3]));
+    EXPECT_FALSE(registry.contains(elements[3]));
+    EXPECT_EQ(registry.size(), 9);
+    registry.forEach([&](Element *e, ValueComponent &c) {
+        EXPECT_EQ(e->getComponent<ValueComponent>(), &c);
+        EXPECT_NE(c.value, 3);
+    });
+}
+
+TEST(ElementRegistryTest, SwapRemoveKeepsColumnsAligned)
+{
+    Element root { nullptr };
+    ElementRegistry<ValueComponent, TagComponent> registry;
+    std::vector<Element *> elements;
+    for(int i = 0; i < 8; ++i)
+    {
+        const auto e = root.addChild();
+        e->addComponent<ValueComponent>()->value = i;
+        e->addComponent<TagComponent>();
+        registry.insertOrAssign(e,
+            e->getComponent<ValueComponent>(),
+            e->getComponent<TagComponent>());
+        elements.push_back(e);
+    }
+    // remove from the front, the middle and the back
+    registry.erase(elements[0]);
+    registry.erase(elements[4]);
+    registry.erase(elements[7]);
+    ASSERT_EQ(registry.size(), 5);
+
+    const auto &dense = registry.elements();
+    const auto &values = registry.components<ValueComponent>();
+    const auto &tags = registry.components<TagComponent>();
+    ASSERT_EQ(values.size(), dense.size());
+    ASSERT_EQ(tags.size(), dense.size());
+    for(std::size_t i = 0; i < dense.size(); ++i)
+    {
+        EXPECT_EQ(values[i], dense[i]->getComponent<ValueComponent>());
+        EXPECT_EQ(tags[i], dense[i]->getComponent<TagComponent>());
+        EXPECT_TRUE(registry.contains(dense[i]));
+    }
+    // the moved entries can still be erased by element
+    for(auto &&i : { 1, 2, 3, 5, 6 })
+        EXPECT_TRUE(registry.erase(elements[i]));
+    EXPECT_TRUE(registry.empty());
+}
+
+TEST(ElementRegistryTest, CollectionSystemTracksRequiredComponents)
+{
+    Element root { nullptr };
+    SumSystem system;
+    Clock clock;
+    const auto a = root.addChild();
+    const auto b = root.addChild();
+    a->addComponent<ValueComponent>()->value = 1;
+    b->addComponent<ValueComponent>()->value = 2;
+    system.onElementComponentChanged(a);
+    system.onElementComponentChanged(b);
+    // neither has all the required components
+    EXPECT_TRUE(system.registry().empty());
+
+    a->addComponent<TagComponent>();
+    b->addComponent<TagComponent>();
+    system.onElementComponentChanged(a);
+    system.onElementComponentChanged(b);
+    system.update(clock);
+    EXPECT_EQ(system.sum, 3);
+
+    a->removeComponent<TagComponent>();
+    system.onElementComponentChanged(a);
+    system.update(clock);
+    EXPECT_EQ(system.sum, 2);
+    EXPECT_FALSE(system.registry().contains(a));
+}
+
+TEST(ElementRegistryTest, StaleEntryNotMatchedByReusedSlot)
+{
+    Element root { nullptr };
+    ElementRegistry<ValueComponent> registry;
+
+    const auto old_element = root.addChild();
+    const auto old_component = old_element->addComponent<ValueComponent>();
+    registry.insertOrAssign(old_element, old_component);
+    const auto old_handle = old_element->handle();
+    // destroyed without being erased from the registry
+    root.removeChild(old_element);
+
+    const auto element = root.addChild();
+    const auto component = element->addComponent<ValueComponent>();
+    component->value = 1;
+    // the slot is reused with a new generation
+    ASSERT_EQ(element->handle().index, old_handle.index);
+    EXPECT_NE(element->handle(), old_handle);
+
+    EXPECT_FALSE(registry.contains(element));
+    EXPECT_TRUE(registry.insertOrAssign(element, component));
+    // the stale entry was replaced
+    ASSERT_EQ(registry.size(), 1);
+    EXPECT_EQ(registry.element(0), element);
+    EXPECT_EQ(registry.component<ValueComponent>(0), component);
+    EXPECT_TRUE(registry.erase(element));
+    EXPECT_TRUE(registry.empty());
+}
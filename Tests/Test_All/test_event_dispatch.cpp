@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+
+#include <Usagi/Core/Component.hpp>
+#include <Usagi/Core/Element.hpp>
+#include <Usagi/Core/Event/Event.hpp>
+#include <Usagi/Core/Event/EventQueue.hpp>
+#include <Usagi/Core/Event/Library/Component/ComponentAddedEvent.hpp>
+#include <Usagi/Core/Event/Library/Component/ComponentsChangedEvent.hpp>
+#include <Usagi/Game/CollectionSystem.hpp>
+#include <Usagi/Game/GameState.hpp>
+
+using namespace usagi;
+
+namespace
+{
+struct PingEvent : Event
+{
+    int value = 0;
+
+    explicit PingEvent(const int value)
+        : value(value)
+    {
+    }
+};
+
+struct PongEvent : Event
+{
+};
+
+struct TagAComponent : Component
+{
+    const std::type_info & baseType() override
+    {
+        return typeid(TagAComponent);
+    }
+};
+
+struct TagBComponent : Component
+{
+    const std::type_info & baseType() override
+    {
+        return typeid(TagBComponent);
+    }
+};
+
+struct CountingSystem : CollectionSystem<TagAComponent>
+{
+    int visited = 0;
+
+    void update(const Clock &clock) override
+    {
+        visited = 0;
+        forEach([&](Element *, TagAComponent &) { ++visited; });
+    }
+
+    const std::type_info & type() override
+    {
+        return typeid(CountingSystem);
+    }
+};
+}
+
+TEST(EventDispatchTest, BubblingAndTypeFiltering)
+{
+    Element root { nullptr };
+    const auto a = root.addChild();
+    const auto b = a->addChild();
+
+    int root_pings = 0, a_pings = 0, pongs = 0;
+    root.addEventListener<PingEvent>([&](PingEvent &e) {
+        root_pings += e.value;
+    });
+    a->addEventListener<PingEvent>([&](PingEvent &e) {
+        a_pings += e.value;
+        EXPECT_EQ(e.source(), b);
+    });
+    root.addEventListener<PongEvent>([&](Event &) { ++pongs; });
+
+    b->sendEvent<PingEvent>(2);
+    EXPECT_EQ(a_pings, 2);
+    EXPECT_EQ(root_pings, 2);
+    EXPECT_EQ(pongs, 0);
+
+    b->sendEvent<PongEvent>();
+    EXPECT_EQ(pongs, 1);
+    EXPECT_EQ(a_pings, 2);
+}
+
+TEST(EventDispatchTest, StopBubblingAndCancel)
+{
+    Element root { nullptr };
+    const auto a = root.addChild();
+
+    bool root_called = false, first = false, second = false, third = false;
+    root.addEventListener<PingEvent>([&](PingEvent &) { root_called = true; });
+    a->addEventListener<PingEvent>([&](PingEvent &e) {
+        first = true;
+        e.stopBubbling();
+    });
+    a->addEventListener<PingEvent>([&](PingEvent &) { second = true; });
+    a->sendEvent<PingEvent>(1);
+    // all handlers at the level run, but the parent does not
+    EXPECT_TRUE(first);
+    EXPECT_TRUE(second);
+    EXPECT_FALSE(root_called);
+
+    root.addEventListener<PongEvent>([&](PongEvent &e) { e.cancel(); });
+    root.addEventListener<PongEvent>([&](PongEvent &) { third = true; });
+    a->sendEvent<PongEvent>();
+    EXPECT_FALSE(third);
+}
+
+TEST(EventDispatchTest, ListenerAddedDuringHandling)
+{
+    Element root { nullptr };
+    int count = 0;
+    root.addEventListener<PingEvent>([&](PingEvent &) {
+        ++count;
+        root.addEventListener<PingEvent>([&](PingEvent &) { ++count; });
+    });
+    root.sendEvent<PingEvent>(0);
+    EXPECT_EQ(count, 1);
+    root.sendEvent<PingEvent>(0);
+    EXPECT_EQ(count, 3);
+}
+
+TEST(EventQueueTest, CoalescesComponentChanges)
+{
+    EventQueue queue;
+    queue.setEnabled(true);
+    Element root { nullptr };
+    root.setEventQueue(&queue);
+
+    int added = 0;
+    std::vector<std::pair<Element *, ComponentMask>> changes;
+    root.addEventListener<ComponentAddedEvent>([&](ComponentAddedEvent &) {
+        ++added;
+    });
+    root.addEventListener<ComponentsChangedEvent>(
+        [&](ComponentsChangedEvent &e) {
+            changes.emplace_back(e.source(), e.changed);
+        });
+
+    const auto a = root.addChild();
+    const auto b = root.addChild();
+    const auto c = root.addChild();
+    a->addComponent<TagAComponent>();
+    a->addComponent<TagBComponent>();
+    b->addComponent<TagBComponent>();
+    c->addComponent<TagAComponent>();
+    EXPECT_EQ(queue.size(), 3);
+    EXPECT_TRUE(changes.empty());
+
+    // removals are notified immediately since the component is destroyed
+    a->removeComponent<TagBComponent>();
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].first, a);
+    EXPECT_EQ(changes[0].second, componentMask<TagBComponent>());
+    EXPECT_EQ(queue.size(), 3);
+    changes.clear();
+
+    // destroying an element drops its queued events and notifies the
+    // removal of its components immediately
+    root.removeChild(c);
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].second, componentMask<TagAComponent>());
+    changes.clear();
+
+    queue.flush();
+    EXPECT_EQ(added, 0);
+    ASSERT_EQ(changes.size(), 2);
+    EXPECT_EQ(changes[0].first, a);
+    EXPECT_EQ(changes[0].second,
+        (componentMask<TagAComponent, TagBComponent>()));
+    EXPECT_EQ(changes[1].first, b);
+    EXPECT_EQ(changes[1].second, componentMask<TagBComponent>());
+    EXPECT_TRUE(queue.empty());
+
+    // events are sent immediately when queueing is disabled
+    queue.setEnabled(false);
+    b->addComponent<TagAComponent>();
+    EXPECT_EQ(added, 1);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueueTest, RemovedComponentNotVisitedBeforeFlush)
+{
+    EventQueue queue;
+    Element root { nullptr };
+    root.setEventQueue(&queue);
+    const auto state = root.addChild<GameState>("state");
+    const auto system = state->addSystem<CountingSystem>("counting");
+    Clock clock;
+
+    queue.setEnabled(true);
+    const auto a = state->addChild();
+    const auto b = state->addChild();
+    a->addComponent<TagAComponent>();
+    b->addComponent<TagAComponent>();
+    queue.flush();
+    state->update(clock);
+    EXPECT_EQ(system->visited, 2);
+
+    // the component is destroyed at once, so the system must not see it
+    // in the same frame even though the queue is not flushed yet
+    a->removeComponent<TagAComponent>();
+    state->update(clock);
+    EXPECT_EQ(system->visited, 1);
+
+    // a component added and removed within the frame is never visited
+    a->addComponent<TagAComponent>();
+    a->removeComponent<TagAComponent>();
+    state->update(clock);
+    EXPECT_EQ(system->visited, 1);
+    queue.flush();
+    state->update(clock);
+    EXPECT_EQ(system->visited, 1);
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <Usagi/Runtime/Memory/FrameRingAllocator.hpp>
+
+using namespace usagi;
+
+namespace
+{
+std::size_t offset(void *p)
+{
+    return reinterpret_cast<std::size_t>(p);
+}
+}
+
+TEST(FrameRingAllocatorTest, RetireFrames)
+{
+    FrameRingAllocator alloc { nullptr, 1024 };
+    EXPECT_EQ(offset(alloc.allocate(100)), 0);
+    EXPECT_EQ(offset(alloc.allocate(100)), 112);
+    const auto frame0 = alloc.closeFrame();
+
+    EXPECT_EQ(offset(alloc.allocate(500)), 224);
+    const auto frame1 = alloc.closeFrame();
+    EXPECT_THROW(alloc.allocate(400), std::bad_alloc);
+    // the failed request did not consume the ring
+    EXPECT_EQ(alloc.closeFrame(), frame1);
+
+    alloc.retire(frame0);
+    EXPECT_EQ(offset(alloc.allocate(200)), 736);
+    // skips the end of the ring since allocations are contiguous
+    EXPECT_EQ(offset(alloc.allocate(200)), 0);
+    // retiring an older frame again changes nothing
+    alloc.retire(frame0);
+    EXPECT_EQ(alloc.usedSize(), alloc.closeFrame() - frame0);
+    EXPECT_THROW(alloc.allocate(100), std::bad_alloc);
+
+    alloc.retire(frame1);
+    alloc.retire(alloc.closeFrame());
+    EXPECT_EQ(alloc.usedSize(), 0);
+    EXPECT_EQ(offset(alloc.allocate(8, 256)) % 256, 0);
+}
+
+TEST(FrameRingAllocatorTest, ConcurrentAllocation)
+{
+    constexpr std::size_t SIZE = 1024 * 1024;
+    FrameRingAllocator alloc { nullptr, SIZE };
+    std::vector<char> owner(SIZE, 0);
+
+    for(int frame = 0; frame < 20; ++frame)
+    {
+        std::vector<std::thread> threads;
+        for(char t = 1; t <= 4; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                for(int i = 0; i < 200; ++i)
+                {
+                    const auto size = 16 + (i * 37 + t) % 200;
+                    const auto p = offset(alloc.allocate(size));
+                    ASSERT_LE(p + size, SIZE);
+                    for(auto j = p; j < p + size; ++j)
+                    {
+                        EXPECT_EQ(owner[j], 0);
+                        owner[j] = t;
+                    }
+                }
+            });
+        }
+        for(auto &&t : threads) t.join();
+        alloc.retire(alloc.closeFrame());
+        std::fill(owner.begin(), owner.end(), 0);
+    }
+    EXPECT_EQ(alloc.usedSize(), 0);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+#include <Usagi/Core/Job/JobSystem.hpp>
+
+using namespace usagi;
+
+TEST(WorkStealingDequeTest, OwnerIsLifoThiefIsFifo)
+{
+    WorkStealingDeque<int> deque(2);
+    int items[5] = { 0, 1, 2, 3, 4 };
+    for(auto &&i : items)
+        deque.push(&i);
+    EXPECT_EQ(deque.sizeApprox(), 5);
+    EXPECT_EQ(deque.pop(), &items[4]);
+    EXPECT_EQ(deque.steal(), &items[0]);
+    EXPECT_EQ(deque.steal(), &items[1]);
+    EXPECT_EQ(deque.pop(), &items[3]);
+    EXPECT_EQ(deque.pop(), &items[2]);
+    EXPECT_EQ(deque.pop(), nullptr);
+    EXPECT_EQ(deque.steal(), nullptr);
+}
+
+TEST(JobSystemTest, CounterWaitsForAllJobs)
+{
+    JobSystem jobs(3);
+    JobCounter counter;
+    std::atomic<int> sum = 0;
+    for(int i = 1; i <= 1000; ++i)
+        jobs.submit([&sum, i]() { sum += i; }, &counter);
+    jobs.wait(counter);
+    EXPECT_TRUE(counter.done());
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(JobSystemTest, NestedSubmission)
+{
+    JobSystem jobs(3);
+    JobCounter counter;
+    std::atomic<int> count = 0;
+    for(int i = 0; i < 10; ++i)
+    {
+        jobs.submit([&]() {
+            for(int j = 0; j < 10; ++j)
+                jobs.submit([&]() { ++count; }, &counter);
+        }, &counter);
+    }
+    jobs.wait(counter);
+    EXPECT_EQ(count, 100);
+}
+
+TEST(JobSystemTest, ParallelFor)
+{
+    JobSystem jobs(3);
+    std::vector<int> values(10007, 1);
+    jobs.parallelFor(0, values.size(), 64,
+        [&](const std::size_t begin, const std::size_t end) {
+            EXPECT_LE(end - begin, 64);
+            for(auto i = begin; i < end; ++i)
+                values[i] *= 2;
+        });
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), 0), 20014);
+
+    EXPECT_THROW(jobs.parallelFor(0, 100, 1,
+        [](const std::size_t begin, std::size_t) {
+            if(begin == 50) throw std::runtime_error("failed");
+        }), std::runtime_error);
+}
+
+TEST(JobSystemTest, NoWorkers)
+{
+    JobSystem jobs(0);
+    std::atomic<int> count = 0;
+    jobs.parallelFor(0, 100, 1,
+        [&](std::size_t, std::size_t) { ++count; });
+    EXPECT_EQ(count, 100);
+}
+
+TEST(JobSystemTest, MainThreadAffinity)
+{
+    JobSystem jobs(3);
+    const auto main_thread = std::this_thread::get_id();
+    JobCounter counter;
+    std::atomic<int> on_main = 0;
+    for(int i = 0; i < 10; ++i)
+    {
+        jobs.submit([&]() {
+            jobs.submitMainThread([&]() {
+                if(std::this_thread::get_id() == main_thread)
+                    ++on_main;
+            }, &counter);
+        }, &counter);
+    }
+    jobs.wait(counter);
+    EXPECT_EQ(on_main, 10);
+}
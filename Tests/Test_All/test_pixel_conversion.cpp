@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <Usagi/Utility/PixelConversion.hpp>
+
+using namespace usagi;
+
+namespace
+{
+// odd counts exercise both the vectorized loops and the scalar remainders
+constexpr std::size_t PIXEL_COUNTS[] = { 0, 1, 3, 5, 7, 8, 15, 33, 1027 };
+
+std::vector<std::uint8_t> randomBytes(const std::size_t count)
+{
+    std::mt19937 gen { 42 };
+    std::uniform_int_distribution<int> dist { 0, 255 };
+    std::vector<std::uint8_t> bytes(count);
+    for(auto &&b : bytes)
+        b = static_cast<std::uint8_t>(dist(gen));
+    return bytes;
+}
+
+std::uint8_t referencePremultiply(const int color, const int alpha)
+{
+    return static_cast<std::uint8_t>(std::lround(color * alpha / 255.0));
+}
+}
+
+TEST(PixelConversionTest, Rgb8ToRgba8)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        const auto src = randomBytes(count * 3);
+        std::vector<std::uint8_t> dst(count * 4);
+        convertRgb8ToRgba8(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(dst[i * 4 + 0], src[i * 3 + 0]);
+            EXPECT_EQ(dst[i * 4 + 1], src[i * 3 + 1]);
+            EXPECT_EQ(dst[i * 4 + 2], src[i * 3 + 2]);
+            EXPECT_EQ(dst[i * 4 + 3], 0xFF);
+        }
+    }
+}
+
+TEST(PixelConversionTest, L8ToRgba8)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        const auto src = randomBytes(count);
+        std::vector<std::uint8_t> dst(count * 4);
+        convertL8ToRgba8(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            // gray instead of red
+            EXPECT_EQ(dst[i * 4 + 0], src[i]);
+            EXPECT_EQ(dst[i * 4 + 1], src[i]);
+            EXPECT_EQ(dst[i * 4 + 2], src[i]);
+            EXPECT_EQ(dst[i * 4 + 3], 0xFF);
+        }
+    }
+}
+
+TEST(PixelConversionTest, La8ToRgba8)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        const auto src = randomBytes(count * 2);
+        std::vector<std::uint8_t> dst(count * 4);
+        convertLa8ToRgba8(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(dst[i * 4 + 0], src[i * 2 + 0]);
+            EXPECT_EQ(dst[i * 4 + 1], src[i * 2 + 0]);
+            EXPECT_EQ(dst[i * 4 + 2], src[i * 2 + 0]);
+            EXPECT_EQ(dst[i * 4 + 3], src[i * 2 + 1]);
+        }
+    }
+}
+
+TEST(PixelConversionTest, PremultiplyRgba8)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        auto src = randomBytes(count * 4);
+        if(count > 1)
+        {
+            // edge alpha values
+            src[3] = 0;
+            src[7] = 255;
+        }
+        std::vector<std::uint8_t> dst(src.size());
+        premultiplyRgba8(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count * 4; i += 4)
+        {
+            for(std::size_t c = 0; c < 3; ++c)
+            {
+                EXPECT_EQ(dst[i + c],
+                    referencePremultiply(src[i + c], src[i + 3]));
+            }
+            EXPECT_EQ(dst[i + 3], src[i + 3]);
+        }
+
+        // in place
+        premultiplyRgba8(src.data(), src.data(), count);
+        EXPECT_EQ(src, dst);
+    }
+}
+
+TEST(PixelConversionTest, PremultiplySrgba8)
+{
+    const std::uint8_t src[] = {
+        255, 128, 0, 255,
+        255, 128, 0, 0,
+        255, 255, 255, 128,
+    };
+    std::uint8_t dst[sizeof(src)];
+    premultiplySrgba8(src, dst, 3);
+
+    // opaque pixels are unchanged
+    EXPECT_EQ(dst[0], 255);
+    EXPECT_EQ(dst[1], 128);
+    EXPECT_EQ(dst[2], 0);
+    EXPECT_EQ(dst[3], 255);
+    // transparent pixels become black
+    EXPECT_EQ(dst[4], 0);
+    EXPECT_EQ(dst[5], 0);
+    EXPECT_EQ(dst[6], 0);
+    EXPECT_EQ(dst[7], 0);
+    // half of linear white is about 188 in sRGB, not 128
+    EXPECT_EQ(dst[8], 188);
+    EXPECT_EQ(dst[11], 128);
+}
+
+TEST(PixelConversionTest, FloatToHalf)
+{
+    EXPECT_EQ(floatToHalf(0.f), 0x0000);
+    EXPECT_EQ(floatToHalf(-0.f), 0x8000);
+    EXPECT_EQ(floatToHalf(1.f), 0x3C00);
+    EXPECT_EQ(floatToHalf(-2.f), 0xC000);
+    EXPECT_EQ(floatToHalf(65504.f), 0x7BFF);
+    EXPECT_EQ(floatToHalf(65520.f), 0x7C00);
+    EXPECT_EQ(floatToHalf(std::numeric_limits<float>::infinity()), 0x7C00);
+    EXPECT_EQ(floatToHalf(std::ldexp(1.f, -24)), 0x0001);
+    EXPECT_EQ(floatToHalf(std::ldexp(1.f, -14)), 0x0400);
+    // ties round to even
+    EXPECT_EQ(floatToHalf(1.f + std::ldexp(1.f, -11)), 0x3C00);
+    EXPECT_EQ(floatToHalf(1.f + 3 * std::ldexp(1.f, -11)), 0x3C02);
+    EXPECT_TRUE(std::isnan(halfToFloat(floatToHalf(
+        std::numeric_limits<float>::quiet_NaN()))));
+
+    // every finite half converts back to itself
+    for(std::uint32_t h = 0; h < 0x10000; ++h)
+    {
+        if((h & 0x7C00) == 0x7C00) continue;
+        ASSERT_EQ(floatToHalf(halfToFloat(static_cast<std::uint16_t>(h))), h);
+    }
+}
+
+TEST(PixelConversionTest, Float32ToFloat16)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        std::mt19937 gen { 42 };
+        std::uniform_real_distribution<float> dist { -70000.f, 70000.f };
+        std::vector<float> src(count);
+        for(auto &&f : src)
+            f = dist(gen) * std::ldexp(1.f, static_cast<int>(gen() % 40) - 30);
+        std::vector<std::uint16_t> dst(count);
+        convertFloat32ToFloat16(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+            EXPECT_EQ(dst[i], floatToHalf(src[i]));
+    }
+}
+
+TEST(PixelConversionTest, Rgb32fToRgba16f)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        std::vector<float> src(count * 3);
+        for(std::size_t i = 0; i < src.size(); ++i)
+            src[i] = static_cast<float>(i) * 0.37f;
+        std::vector<std::uint16_t> dst(count * 4);
+        convertRgb32fToRgba16f(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(dst[i * 4 + 0], floatToHalf(src[i * 3 + 0]));
+            EXPECT_EQ(dst[i * 4 + 1], floatToHalf(src[i * 3 + 1]));
+            EXPECT_EQ(dst[i * 4 + 2], floatToHalf(src[i * 3 + 2]));
+            EXPECT_EQ(dst[i * 4 + 3], 0x3C00);
+        }
+    }
+}
+
+TEST(PixelConversionTest, L32fToRgba16f)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        std::vector<float> src(count);
+        for(std::size_t i = 0; i < src.size(); ++i)
+            src[i] = static_cast<float>(i) * 0.37f;
+        std::vector<std::uint16_t> dst(count * 4);
+        convertL32fToRgba16f(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(dst[i * 4 + 0], floatToHalf(src[i]));
+            EXPECT_EQ(dst[i * 4 + 1], floatToHalf(src[i]));
+            EXPECT_EQ(dst[i * 4 + 2], floatToHalf(src[i]));
+            EXPECT_EQ(dst[i * 4 + 3], 0x3C00);
+        }
+    }
+}
+
+TEST(PixelConversionTest, La32fToRgba16f)
+{
+    for(auto &&count : PIXEL_COUNTS)
+    {
+        std::vector<float> src(count * 2);
+        for(std::size_t i = 0; i < src.size(); ++i)
+            src[i] = static_cast<float>(i) * 0.37f;
+        std::vector<std::uint16_t> dst(count * 4);
+        convertLa32fToRgba16f(src.data(), dst.data(), count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(dst[i * 4 + 0], floatToHalf(src[i * 2 + 0]));
+            EXPECT_EQ(dst[i * 4 + 1], floatToHalf(src[i * 2 + 0]));
+            EXPECT_EQ(dst[i * 4 + 2], floatToHalf(src[i * 2 + 0]));
+            EXPECT_EQ(dst[i * 4 + 3], floatToHalf(src[i * 2 + 1]));
+        }
+    }
+}
@@ -1,9 +1,40 @@
 #include <gtest/gtest.h>
 
+#include <map>
+
 #include <Usagi/Runtime/Graphics/Shader/SpirvBinary.hpp>
 
 using namespace usagi;
 
+namespace
+{
+class MapIncluder : public GlslIncluder
+{
+public:
+    std::map<std::string, std::string> files;
+
+    std::optional<Include> include(
+        const std::string &header_name,
+        const std::string &includer_name,
+        bool relative) override
+    {
+        const auto iter = files.find(header_name);
+        if(iter == files.end()) return { };
+        return Include {
+            iter->first,
+            { nullptr, iter->second.data(), iter->second.size() }
+        };
+    }
+};
+
+const char INCLUDING_SHADER[] = R"(#version 450 core
+#extension GL_GOOGLE_include_directive : require
+#include "color.glsl"
+layout(location = 0) out vec4 out_Color;
+void main() { out_Color = color(); }
+)";
+}
+
 TEST(ShaderTest, VertexShaderCompilationTest)
 {
     EXPECT_NO_THROW(SpirvBinary::fromGlslSourceFile(
@@ -31,3 +62,118 @@ TEST(ShaderTest, FragmentShaderLoadTest)
         "data/shaders/frag.spv"
     ));
 }
+
+TEST(ShaderTest, CachedCompilationTest)
+{
+    const auto cache = std::filesystem::temp_directory_path() /
+        "usagi_shader_cache_test";
+    std::filesystem::remove_all(cache);
+    const auto count_files = [&](const char *extension) {
+        std::size_t count = 0;
+        for(auto &&f : std::filesystem::directory_iterator(cache))
+            count += f.path().extension() == extension;
+        return count;
+    };
+
+    const auto compiled = SpirvBinary::fromGlslSourceFile(
+        "data/shaders/glsl_shader.vert", ShaderStage::VERTEX, cache);
+    EXPECT_EQ(count_files(".spv"), 1);
+    // the reflection is cached next to the binary
+    EXPECT_EQ(count_files(".refl"), 1);
+    const auto cached = SpirvBinary::fromGlslSourceFile(
+        "data/shaders/glsl_shader.vert", ShaderStage::VERTEX, cache);
+    EXPECT_EQ(cached->bytecodes(), compiled->bytecodes());
+
+    std::filesystem::remove_all(cache);
+}
+
+TEST(ShaderTest, IncludedFilesInvalidateCacheTest)
+{
+    const auto cache = std::filesystem::temp_directory_path() /
+        "usagi_shader_include_test";
+    std::filesystem::remove_all(cache);
+    const auto count_binaries = [&]() {
+        std::size_t count = 0;
+        for(auto &&f : std::filesystem::directory_iterator(cache))
+            count += f.path().extension() == ".spv";
+        return count;
+    };
+
+    MapIncluder includer;
+    includer.files["color.glsl"] = "#include \"one.glsl\"\n"
+        "vec4 color() { return vec4(ONE); }\n";
+    includer.files["one.glsl"] = "#define ONE 1\n";
+
+    const auto first = SpirvBinary::fromGlslSourceString(INCLUDING_SHADER,
+        ShaderStage::FRAGMENT, cache, &includer, "main.frag");
+    EXPECT_EQ(first->dependencies(),
+        std::vector<std::string>({ "color.glsl", "one.glsl" }));
+    const auto cached = SpirvBinary::fromGlslSourceString(INCLUDING_SHADER,
+        ShaderStage::FRAGMENT, cache, &includer, "main.frag");
+    EXPECT_EQ(cached->bytecodes(), first->bytecodes());
+    EXPECT_EQ(cached->dependencies(), first->dependencies());
+    EXPECT_EQ(count_binaries(), 1);
+
+    // changing an indirectly included file recompiles the shader
+    includer.files["one.glsl"] = "#define ONE 0\n";
+    const auto changed = SpirvBinary::fromGlslSourceString(INCLUDING_SHADER,
+        ShaderStage::FRAGMENT, cache, &includer, "main.frag");
+    EXPECT_NE(changed->bytecodes(), first->bytecodes());
+    EXPECT_EQ(count_binaries(), 2);
+
+    includer.files.clear();
+    EXPECT_THROW(SpirvBinary::fromGlslSourceString(INCLUDING_SHADER,
+        ShaderStage::FRAGMENT, cache, &includer, "main.frag"),
+        std::runtime_error);
+
+    std::filesystem::remove_all(cache);
+}
+
+TEST(ShaderTest, ReflectionSerializationTest)
+{
+    ShaderReflection reflection;
+    reflection.inputs = { { "in_Position", 0 }, { "in_Color", 1 } };
+    reflection.resources = {
+        { "sTexture", ShaderResourceType::SAMPLED_IMAGE, 1, 2, 1 },
+        { "uCamera", ShaderResourceType::UNIFORM_BUFFER, 0, 0, 1 },
+    };
+    reflection.push_constant_fields = { { "uScale", 0, 8 }, { "uT", 8, 8 } };
+    reflection.push_constant_size = 16;
+
+    const auto data = reflection.serialize();
+    const auto loaded = ShaderReflection::deserialize(data);
+    EXPECT_EQ(loaded.push_constant_size, 16);
+    ASSERT_EQ(loaded.inputs.size(), 2);
+    EXPECT_EQ(loaded.inputs[1].name, "in_Color");
+    EXPECT_EQ(loaded.inputs[1].location, 1);
+    ASSERT_EQ(loaded.resources.size(), 2);
+    EXPECT_EQ(loaded.resources[0].name, "sTexture");
+    EXPECT_EQ(loaded.resources[0].type, ShaderResourceType::SAMPLED_IMAGE);
+    EXPECT_EQ(loaded.resources[0].set, 1);
+    EXPECT_EQ(loaded.resources[0].binding, 2);
+    ASSERT_EQ(loaded.push_constant_fields.size(), 2);
+    EXPECT_EQ(loaded.push_constant_fields[1].name, "uT");
+    EXPECT_EQ(loaded.push_constant_fields[1].offset, 8);
+
+    EXPECT_THROW(ShaderReflection::deserialize(data.substr(0, data.size() - 1)),
+        std::runtime_error);
+    EXPECT_THROW(ShaderReflection::deserialize("garbage"), std::runtime_error);
+}
+
+TEST(ShaderTest, CachedReflectionTest)
+{
+    const auto cache = std::filesystem::temp_directory_path() /
+        "usagi_shader_reflection_test";
+    std::filesystem::remove_all(cache);
+
+    const auto compiled = SpirvBinary::fromGlslSourceFile(
+        "data/shaders/glsl_shader.vert", ShaderStage::VERTEX, cache);
+    const auto cached = SpirvBinary::fromGlslSourceFile(
+        "data/shaders/glsl_shader.vert", ShaderStage::VERTEX, cache);
+    EXPECT_EQ(cached->reflection().serialize(),
+        compiled->reflection().serialize());
+    EXPECT_EQ(cached->reflection().inputs.size(), 3);
+    EXPECT_EQ(cached->reflection().push_constant_fields.size(), 2);
+
+    std::filesystem::remove_all(cache);
+}
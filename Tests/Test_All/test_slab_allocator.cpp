@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <Usagi/Runtime/Memory/SlabMemoryAllocator.hpp>
+
+using namespace usagi;
+
+namespace
+{
+std::size_t offset(void *p)
+{
+    return reinterpret_cast<std::size_t>(p);
+}
+}
+
+TEST(SlabAllocatorTest, SmallAllocations)
+{
+    SlabMemoryAllocator alloc { nullptr, 1024 * 1024 };
+    EXPECT_EQ(alloc.usedSize(), 0);
+
+    std::set<std::size_t> offsets;
+    for(int i = 0; i < 1000; ++i)
+    {
+        const auto p = offset(alloc.allocate(40));
+        EXPECT_EQ(p % 16, 0);
+        EXPECT_TRUE(offsets.insert(p).second);
+    }
+    // rounded up to the 48-byte class
+    EXPECT_EQ(alloc.usedSize(), 1000 * 48);
+    for(auto &&p : offsets)
+        alloc.deallocate(reinterpret_cast<void*>(p));
+    EXPECT_EQ(alloc.usedSize(), 0);
+    EXPECT_EQ(alloc.usableSize(), 1024 * 1024);
+}
+
+TEST(SlabAllocatorTest, AlignmentAndLargeAllocations)
+{
+    SlabMemoryAllocator alloc { nullptr, 1024 * 1024, 256 };
+    const auto a = alloc.allocate(1);
+    const auto b = alloc.allocate(300, 1024);
+    EXPECT_EQ(offset(a) % 256, 0);
+    EXPECT_EQ(offset(b) % 1024, 0);
+
+    // served by the pages directly
+    const auto c = alloc.allocate(100 * 1024);
+    EXPECT_EQ(offset(c) % SlabMemoryAllocator::PAGE_SIZE, 0);
+    EXPECT_GE(alloc.usedSize(), 256 + 1024 + 100 * 1024);
+
+    alloc.deallocate(a);
+    alloc.deallocate(b);
+    alloc.deallocate(c);
+    EXPECT_EQ(alloc.usedSize(), 0);
+    EXPECT_THROW(alloc.allocate(2 * 1024 * 1024), std::bad_alloc);
+    EXPECT_THROW(alloc.allocate(1, 3), std::invalid_argument);
+}
+
+TEST(SlabAllocatorTest, EmptySlabsAreReleased)
+{
+    SlabMemoryAllocator alloc { nullptr, 4 * SlabMemoryAllocator::SLAB_SIZE };
+    // fill the whole region with one size class
+    std::vector<void *> objects;
+    try
+    {
+        while(true) objects.push_back(alloc.allocate(1024));
+    }
+    catch(const std::bad_alloc &)
+    {
+    }
+    EXPECT_EQ(objects.size(), 4 * SlabMemoryAllocator::SLAB_SIZE / 1024);
+    for(auto &&p : objects)
+        alloc.deallocate(p);
+
+    // the slabs can be used by another class, except the one kept by the
+    // previous class and the ones holding the objects cached by the thread
+    std::vector<void *> others;
+    for(int i = 0; i < 30; ++i)
+        others.push_back(alloc.allocate(4000));
+    for(auto &&p : others)
+        alloc.deallocate(p);
+    EXPECT_EQ(alloc.usedSize(), 0);
+}
+
+TEST(SlabAllocatorTest, CrossThreadDeallocation)
+{
+    SlabMemoryAllocator alloc { nullptr, 16 * 1024 * 1024 };
+    constexpr int COUNT = 20000;
+
+    std::vector<void *> produced(COUNT);
+    std::thread producer([&]() {
+        for(int i = 0; i < COUNT; ++i)
+            produced[i] = alloc.allocate(16 + i % 300);
+    });
+    producer.join();
+
+    std::vector<std::thread> consumers;
+    for(int t = 0; t < 4; ++t)
+    {
+        consumers.emplace_back([&, t]() {
+            for(int i = t; i < COUNT; i += 4)
+            {
+                alloc.deallocate(produced[i]);
+                // reuse in this thread
+                alloc.deallocate(alloc.allocate(64));
+            }
+        });
+    }
+    for(auto &&t : consumers) t.join();
+    EXPECT_EQ(alloc.usedSize(), 0);
+}
+
+TEST(SlabAllocatorTest, Statistics)
+{
+    SlabMemoryAllocator alloc { nullptr, 1024 * 1024 };
+    const auto a = alloc.allocate(100);
+    const auto b = alloc.allocate(20 * 1024);
+    alloc.deallocate(a);
+
+    const auto stats = alloc.stats();
+    EXPECT_EQ(stats.total_allocations, 2);
+    EXPECT_EQ(stats.total_deallocations, 1);
+    EXPECT_EQ(stats.used_bytes, 20 * 1024);
+    // the peak is sampled when slabs are created and stats are read
+    EXPECT_GE(stats.peak_used_bytes, 20 * 1024);
+    alloc.deallocate(b);
+    EXPECT_EQ(alloc.stats().liveAllocations(), 0);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <Usagi/Asset/SubresourceCache.hpp>
+
+using namespace usagi;
+
+namespace
+{
+struct Blob
+{
+    std::size_t size;
+    bool *destroyed = nullptr;
+
+    Blob(std::size_t size, bool *destroyed = nullptr)
+        : size(size)
+        , destroyed(destroyed)
+    {
+    }
+
+    ~Blob()
+    {
+        if(destroyed) *destroyed = true;
+    }
+};
+
+ElementHandle asset(std::uint32_t index)
+{
+    return { index, 1 };
+}
+}
+
+namespace usagi
+{
+template <>
+struct SubresourceSize<Blob>
+{
+    std::size_t operator()(const Blob &res) const
+    {
+        return res.size;
+    }
+};
+}
+
+TEST(SubresourceCacheTest, RetainsWithoutUsers)
+{
+    SubresourceCache cache { 1000 };
+    bool destroyed = false;
+    cache.insert(asset(1), std::make_shared<Blob>(100, &destroyed));
+    // no user holds it but the cache
+    EXPECT_FALSE(destroyed);
+    const auto res = cache.find<Blob>(asset(1));
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->size, 100);
+    EXPECT_FALSE(cache.find<Blob>(asset(2)));
+    EXPECT_FALSE(cache.find<int>(asset(1)));
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.retained_bytes, 100);
+    ASSERT_EQ(stats.types.size(), 1);
+    EXPECT_EQ(stats.types[0].retained_count, 1);
+    EXPECT_EQ(stats.types[0].retained_bytes, 100);
+}
+
+TEST(SubresourceCacheTest, EvictsLeastRecentlyUsed)
+{
+    SubresourceCache cache { 250 };
+    bool destroyed[3] = { };
+    for(std::uint32_t i = 0; i < 3; ++i)
+        cache.insert(asset(i), std::make_shared<Blob>(100, &destroyed[i]));
+    // the first one was evicted to fit the third one
+    EXPECT_TRUE(destroyed[0]);
+    EXPECT_FALSE(cache.find<Blob>(asset(0)));
+
+    // use the second so the third becomes the least recently used
+    EXPECT_TRUE(cache.find<Blob>(asset(1)));
+    cache.insert(asset(3), std::make_shared<Blob>(100));
+    EXPECT_TRUE(destroyed[2]);
+    EXPECT_FALSE(destroyed[1]);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 2);
+    EXPECT_EQ(stats.retained_bytes, 200);
+}
+
+TEST(SubresourceCacheTest, EvictedResourcesInUseAreStillFound)
+{
+    SubresourceCache cache { 150 };
+    const auto a = std::make_shared<Blob>(100);
+    cache.insert(asset(1), a);
+    cache.insert(asset(2), std::make_shared<Blob>(100));
+    EXPECT_EQ(cache.stats().evictions, 1);
+
+    // still referenced by us, found and retained again
+    EXPECT_EQ(cache.find<Blob>(asset(1)), a);
+    EXPECT_FALSE(cache.find<Blob>(asset(2)));
+    EXPECT_EQ(cache.stats().retained_bytes, 100);
+
+    cache.setBudget(0);
+    EXPECT_EQ(cache.stats().retained_bytes, 0);
+    EXPECT_EQ(cache.find<Blob>(asset(1)), a);
+    EXPECT_EQ(cache.stats().retained_bytes, 0);
+}
+
+TEST(SubresourceCacheTest, ExpiredEntriesAreSwept)
+{
+    SubresourceCache cache { 0 };
+    // assets streamed in and out, each released by the cache while in use
+    // and dropped by its user later, without being looked up again
+    std::shared_ptr<Blob> in_use;
+    for(std::uint32_t i = 0; i < 1000; ++i)
+    {
+        in_use = std::make_shared<Blob>(100);
+        cache.insert(asset(i), in_use);
+    }
+    EXPECT_LE(cache.stats().entries, SubresourceCache::MIN_SWEEP_THRESHOLD);
+    EXPECT_EQ(cache.find<Blob>(asset(999)), in_use);
+}
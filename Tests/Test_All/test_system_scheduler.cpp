@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <Usagi/Core/Clock.hpp>
+#include <Usagi/Core/Job/JobSystem.hpp>
+#include <Usagi/Game/SystemScheduler.hpp>
+
+using namespace usagi;
+
+namespace
+{
+ComponentMask bit(const std::size_t type_id)
+{
+    return ComponentMask { }.set(type_id);
+}
+
+class TrackingSystem : public System
+{
+    ComponentAccess mAccess;
+    std::atomic<int> &mActive;
+
+public:
+    // the number of updates running when this one started and finished
+    int active_on_start = 0;
+    int active_on_finish = 0;
+    std::thread::id thread;
+
+    TrackingSystem(ComponentAccess access, std::atomic<int> &active)
+        : mAccess { std::move(access) }
+        , mActive { active }
+    {
+    }
+
+    void update(const Clock &clock) override
+    {
+        thread = std::this_thread::get_id();
+        active_on_start = ++mActive;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        active_on_finish = mActive;
+        --mActive;
+    }
+
+    void onElementComponentChanged(Element *element) override
+    {
+    }
+
+    ComponentAccess componentAccess() const override
+    {
+        return mAccess;
+    }
+
+    const std::type_info & type() override
+    {
+        return typeid(TrackingSystem);
+    }
+};
+}
+
+TEST(SystemSchedulerTest, AccessConflicts)
+{
+    const ComponentAccess read_0 { bit(0), { } };
+    const ComponentAccess write_0 { { }, bit(0) };
+    const ComponentAccess read_1_write_2 { bit(1), bit(2) };
+    EXPECT_FALSE(read_0.conflictsWith(read_0));
+    EXPECT_TRUE(read_0.conflictsWith(write_0));
+    EXPECT_TRUE(write_0.conflictsWith(read_0));
+    EXPECT_TRUE(write_0.conflictsWith(write_0));
+    EXPECT_FALSE(write_0.conflictsWith(read_1_write_2));
+    EXPECT_FALSE(ComponentAccess { }.conflictsWith({ }));
+
+    // exclusive accesses conflict even with those accessing no component
+    ComponentAccess exclusive;
+    exclusive.exclusive = true;
+    EXPECT_TRUE(exclusive.conflictsWith({ }));
+    EXPECT_TRUE(ComponentAccess { }.conflictsWith(exclusive));
+}
+
+TEST(SystemSchedulerTest, ExclusiveUpdatesRunAlone)
+{
+    JobSystem jobs(3);
+    std::atomic<int> active = 0;
+    ComponentAccess exclusive;
+    exclusive.exclusive = true;
+
+    TrackingSystem first { { }, active };
+    TrackingSystem second { { }, active };
+    TrackingSystem barrier { exclusive, active };
+    TrackingSystem third { { }, active };
+    SystemScheduler scheduler;
+    scheduler.addSystem(&first);
+    scheduler.addSystem(&second);
+    scheduler.addSystem(&barrier);
+    scheduler.addSystem(&third);
+
+    Clock clock;
+    scheduler.update(clock, &jobs);
+    EXPECT_EQ(barrier.active_on_start, 1);
+    EXPECT_EQ(barrier.active_on_finish, 1);
+    EXPECT_EQ(third.active_on_start, 1);
+}
+
+TEST(SystemSchedulerTest, ExclusiveUpdatesRunOnCallingThread)
+{
+    JobSystem jobs(3);
+    std::atomic<int> active = 0;
+    ComponentAccess exclusive;
+    exclusive.exclusive = true;
+
+    TrackingSystem first { exclusive, active };
+    TrackingSystem second { exclusive, active };
+    TrackingSystem independent { { }, active };
+    SystemScheduler scheduler;
+    scheduler.addSystem(&first);
+    scheduler.addSystem(&second);
+    scheduler.addSystem(&independent);
+
+    Clock clock;
+    scheduler.update(clock, &jobs);
+    EXPECT_EQ(first.thread, std::this_thread::get_id());
+    EXPECT_EQ(second.thread, std::this_thread::get_id());
+    // a batch of a single subsystem is not submitted either
+    EXPECT_EQ(independent.thread, std::this_thread::get_id());
+    EXPECT_EQ(second.active_on_start, 1);
+}
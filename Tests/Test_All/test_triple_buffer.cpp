@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <set>
+#include <thread>
+
+#include <Usagi/Runtime/Memory/TripleBuffer.hpp>
+
+using namespace usagi;
+
+namespace
+{
+struct Snapshot
+{
+    int frame = -1;
+    // must always equal frame * 2 if the snapshot is consistent
+    int check = -2;
+};
+}
+
+TEST(TripleBufferTest, LatestSnapshotWins)
+{
+    TripleBuffer<Snapshot> buffer;
+    EXPECT_FALSE(buffer.update());
+    EXPECT_EQ(buffer.readBuffer().frame, -1);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        buffer.writeBuffer().frame = i;
+        buffer.publish();
+    }
+    EXPECT_TRUE(buffer.update());
+    EXPECT_EQ(buffer.readBuffer().frame, 2);
+    EXPECT_FALSE(buffer.update());
+    EXPECT_EQ(buffer.readBuffer().frame, 2);
+
+    // the producer never writes into the buffer being read
+    buffer.writeBuffer().frame = 3;
+    EXPECT_EQ(buffer.readBuffer().frame, 2);
+}
+
+TEST(TripleBufferTest, ConsumerKeepsRecentSnapshots)
+{
+    MultiBuffer<std::unique_ptr<int>, 5> buffer {
+        [](std::size_t) { return std::make_unique<int>(-1); }
+    };
+    std::set<int *> seen;
+    for(int i = 0; i < 10; ++i)
+    {
+        *buffer.writeBuffer() = i;
+        buffer.publish();
+        ASSERT_TRUE(buffer.update());
+        seen.insert(buffer.readBuffer().get());
+        // the three snapshots taken last remain untouched
+        EXPECT_EQ(*buffer.readBuffer(0), i);
+        if(i >= 2)
+        {
+            EXPECT_EQ(*buffer.readBuffer(1), i - 1);
+            EXPECT_EQ(*buffer.readBuffer(2), i - 2);
+        }
+    }
+    EXPECT_EQ(seen.size(), 5);
+}
+
+TEST(TripleBufferTest, ConcurrentProducerConsumer)
+{
+    TripleBuffer<Snapshot> buffer;
+    constexpr int FRAMES = 100000;
+
+    std::thread producer([&]() {
+        for(int i = 0; i < FRAMES; ++i)
+        {
+            auto &s = buffer.writeBuffer();
+            s.frame = i;
+            s.check = i * 2;
+            buffer.publish();
+        }
+    });
+
+    int last = -1;
+    while(last != FRAMES - 1)
+    {
+        buffer.update();
+        const auto &s = buffer.readBuffer();
+        ASSERT_EQ(s.check, s.frame * 2);
+        ASSERT_GE(s.frame, last);
+        last = s.frame;
+    }
+    producer.join();
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+
+#include <Usagi/Utility/MappedFile.hpp>
 #include <Usagi/Utility/TypeCast.hpp>
 #include <Usagi/Utility/RotateCounter.hpp>
 
@@ -72,3 +76,26 @@ TEST(RotateCounterTest, wrap)
     EXPECT_EQ(a++, 2);
     EXPECT_EQ(a.current(), 0);
 }
+
+TEST(MappedFileTest, MapsFileContent)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+        "usagi_mapped_file_test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "mapped content";
+    }
+    {
+        const auto view = mapFile(path);
+        EXPECT_EQ(view.asStringView(), "mapped content");
+        // the subview keeps the mapping alive
+        const auto sub = view.subview(7, 7);
+        EXPECT_EQ(sub.asStringView(), "content");
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    }
+    EXPECT_TRUE(mapFile(path).empty());
+    std::filesystem::remove(path);
+    EXPECT_THROW(mapFile(path), std::runtime_error);
+}
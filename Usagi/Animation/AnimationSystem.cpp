@@ -37,9 +37,8 @@ struct Sentry
 void usagi::AnimationSystem::update(const Clock &clock)
 {
     mActiveCount = 0;
-    for(auto &&e : mRegistry)
-    {
-        const auto ani = std::get<AnimationComponent*>(e.second);
+    forEach([&](Element *, AnimationComponent &component) {
+        const auto ani = &component;
         auto last_finished = true;
         for(auto i = ani->animations.begin(); i != ani->animations.end();)
         {
@@ -106,7 +105,7 @@ void usagi::AnimationSystem::update(const Clock &clock)
                 last_finished = false;
             }
         }
-    }
+    });
 }
 
 void AnimationSystem::immediatelyFinishAll()
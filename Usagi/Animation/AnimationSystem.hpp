@@ -6,6 +6,12 @@
 
 namespace usagi
 {
+/**
+ * \brief Advances the animations of the elements. The animation functions
+ * and callbacks are invoked by update(), which may run concurrently with
+ * the subsystems not accessing AnimationComponent, so they must only modify
+ * the state they animate and which is not accessed by other subsystems.
+ */
 class AnimationSystem final : public CollectionSystem<AnimationComponent>
 {
     std::size_t mActiveCount = 0;
@@ -13,6 +19,11 @@ class AnimationSystem final : public CollectionSystem<AnimationComponent>
 public:
     void update(const Clock &clock) override;
 
+    ComponentAccess componentAccess() const override
+    {
+        return { { }, componentMask<AnimationComponent>() };
+    }
+
     const std::type_info & type() override
     {
         return typeid(decltype(*this));
@@ -1,5 +1,7 @@
 ﻿#include "Asset.hpp"
 
+#include <Usagi/Utility/Stream.hpp>
+
 // todo use alternative to boost library
 
 usagi::Asset::Asset(Element *parent, std::string name, boost::uuids::uuid uuid)
@@ -7,3 +9,12 @@ usagi::Asset::Asset(Element *parent, std::string name, boost::uuids::uuid uuid)
     , mUuid { uuid }
 {
 }
+
+usagi::MemoryView usagi::Asset::map()
+{
+    const auto in = open();
+    auto content = std::make_shared<std::string>(readStreamAsString(*in));
+    const auto data = content->data();
+    const auto size = content->size();
+    return { std::move(content), data, size };
+}
@@ -1,10 +1,12 @@
 ﻿#pragma once
 
+#include <memory>
+
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/nil_generator.hpp>
 
 #include <Usagi/Core/Element.hpp>
-#include <Usagi/Utility/TypeCast.hpp>
+#include <Usagi/Utility/MemoryView.hpp>
 
 namespace usagi
 {
@@ -13,15 +15,6 @@ class Asset : public Element
 protected:
     const boost::uuids::uuid mUuid;
 
-    /**
-     * \brief Different types of resources may be derived from a single asset.
-     * For example, a JSON may be used to load a scene or a character.
-     * This map stores weak references to the asset as a cache. An external
-     * strong reference must be held to retain the loaded status of the
-     * subresource.
-     */
-    std::map<std::type_index, std::any> mSubresources;
-
 public:
     Asset(
         Element *parent,
@@ -31,6 +24,15 @@ public:
 
     virtual std::unique_ptr<std::istream> open() = 0;
 
+    /**
+     * \brief Get the whole content of the asset as read-only memory. Assets
+     * backed by files map them into memory so that no copy is made. The
+     * default implementation reads the stream returned by open() into a
+     * buffer.
+     * \return
+     */
+    virtual MemoryView map();
+
     boost::uuids::uuid uuid() const { return mUuid; }
 
     /**
@@ -52,36 +54,5 @@ public:
     {
         return DecoderT()(*open());
     }
-
-    template <typename SubresourceT>
-    std::shared_ptr<SubresourceT> subresource() const
-    {
-        const auto i = mSubresources.find(typeid(SubresourceT));
-        if(i == mSubresources.end()) return { };
-        return std::any_cast<const std::weak_ptr<SubresourceT>&>(i->second)
-            .lock();
-    }
-
-    template <typename SubresourceT>
-    void addSubresource(std::shared_ptr<SubresourceT> &res)
-    {
-        const auto i = mSubresources.insert({
-            typeid(SubresourceT), std::weak_ptr<SubresourceT>(res)
-        });
-        // subresource already exists
-        if(!i.second)
-        {
-            auto &old = std::any_cast<std::weak_ptr<SubresourceT>&>(
-                i.first->second);
-            if(!old.expired())
-            {
-                throw std::runtime_error(
-                    "Attempting to overwrite a subresource currently in use."
-                );
-            }
-            // replace expired subresource
-            old = res;
-        }
-    }
 };
 }
@@ -7,7 +7,11 @@ bool usagi::AssetPackage::acceptChild(Element *child)
     return is_instance_of<AssetPackage>(child);
 }
 
-usagi::AssetPackage::AssetPackage(Element *parent, std::string name)
+usagi::AssetPackage::AssetPackage(
+    Element *parent,
+    std::string name,
+    const int priority)
     : Element { parent, std::move(name) }
+    , mPriority { priority }
 {
 }
@@ -10,13 +10,37 @@ class Asset;
 
 class AssetPackage : public Element
 {
+    const int mPriority;
+
     bool acceptChild(Element *child) override;
 
 public:
-    AssetPackage(Element *parent, std::string name);
+    /**
+     * \brief
+     * \param parent
+     * \param name
+     * \param priority When searching assets in all packages, those with
+     * higher priority are searched first and override the assets with the
+     * same path in other packages.
+     */
+    AssetPackage(Element *parent, std::string name, int priority = 0);
     virtual ~AssetPackage() = default;
 
+    int priority() const { return mPriority; }
+
+    /**
+     * \brief
+     * \param uuid
+     * \return nullptr if the package does not contain the asset.
+     */
     virtual Asset * findByUuid(const boost::uuids::uuid &uuid) = 0;
+
+    /**
+     * \brief
+     * \param string
+     * \return nullptr if the package does not contain the asset. Throws
+     * if the string is not a valid path.
+     */
     virtual Asset * findByString(const std::string &string) = 0;
 };
 }
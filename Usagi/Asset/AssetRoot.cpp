@@ -1,5 +1,7 @@
 ﻿#include "AssetRoot.hpp"
 
+#include <algorithm>
+
 #include <boost/uuid/string_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
@@ -8,68 +10,121 @@
 #include "AssetPackage.hpp"
 #include "Asset.hpp"
 
-usagi::AssetRoot::AssetRoot(Element *parent, std::string name)
+usagi::AssetRoot::AssetRoot(
+    Element *parent,
+    std::string name,
+    JobSystem *jobs)
     : Element(parent, std::move(name))
+    , mJobSystem(jobs)
 {
 }
 
-usagi::Asset * usagi::AssetRoot::findAssetByUuid(
-    const boost::uuids::uuid &uuid) const
+usagi::AssetRoot::~AssetRoot()
 {
-    LOG(info, "Searching asset by UUID: {}", boost::uuids::to_string(uuid));
-    for(auto iter = childrenBegin(); iter != childrenEnd(); ++iter)
+    // the loading jobs refer to the assets which are about to be destroyed
+    if(mJobSystem)
     {
-        auto pkg = static_cast<AssetPackage*>(iter->get());
-        if(const auto asset = pkg->findByUuid(uuid))
+        mJobSystem->waitUntil([&]() {
+            std::lock_guard<std::mutex> lock(mLoadLock);
+            return mPendingLoads.empty();
+        });
+    }
+}
+
+template <typename Search>
+usagi::Asset * usagi::AssetRoot::searchPackages(Search search) const
+{
+    for(auto iter = mPackages.begin(); iter != mPackages.end();)
+    {
+        const auto pkg = static_cast<AssetPackage*>(
+            Element::fromHandle(iter->handle));
+        // unmounted
+        if(!pkg)
+        {
+            iter = mPackages.erase(iter);
+            continue;
+        }
+        if(const auto asset = search(pkg))
             return asset;
+        ++iter;
     }
     return nullptr;
 }
 
+usagi::Asset * usagi::AssetRoot::findAssetByUuid(
+    const boost::uuids::uuid &uuid) const
+{
+    std::lock_guard<std::mutex> lock(mIndexLock);
+
+    const auto iter = mUuidIndex.find(uuid);
+    if(iter != mUuidIndex.end())
+    {
+        if(const auto asset = Element::fromHandle(iter->second))
+            return static_cast<Asset*>(asset);
+        mUuidIndex.erase(iter);
+    }
+
+    LOG(debug, "Searching asset by UUID: {}", boost::uuids::to_string(uuid));
+    const auto asset = searchPackages([&](AssetPackage *pkg) {
+        return pkg->findByUuid(uuid);
+    });
+    if(asset) mUuidIndex.emplace(uuid, asset->handle());
+    return asset;
+}
+
 usagi::Asset * usagi::AssetRoot::findAssetByString(
-    std::string string) const
+    const std::string &string) const
 {
+    std::lock_guard<std::mutex> lock(mIndexLock);
+
+    const auto iter = mLocatorIndex.find(string);
+    if(iter != mLocatorIndex.end())
+    {
+        if(const auto asset = Element::fromHandle(iter->second))
+            return static_cast<Asset*>(asset);
+        mLocatorIndex.erase(iter);
+    }
+
+    Asset *asset = nullptr;
     const auto colon_pos = string.find_first_of(':');
     if(colon_pos != std::string::npos) // package name is specified
     {
-        string[colon_pos] = 0; // separate package name and path
-        // c_str is essential to the correct segmentation by the \0.
-        const std::string package_name { string.c_str() };
-        const std::string path { string.c_str() + colon_pos + 1};
+        const auto package_name = string.substr(0, colon_pos);
+        const auto path = string.substr(colon_pos + 1);
 
-        LOG(info, "Searching asset in package {}: {}", package_name, path);
+        LOG(debug, "Searching asset in package {}: {}", package_name, path);
         if(const auto pkg =
             static_cast<AssetPackage*>(findChild(package_name)))
         {
-            return pkg->findByString(path);
+            asset = pkg->findByString(path);
         }
-        return nullptr;
     }
-
-    LOG(info, "Searching asset in all packages: {}", string);
-    // search each package linearly
-    for(auto iter = childrenBegin(); iter != childrenEnd(); ++iter)
+    else
     {
-        auto pkg = static_cast<AssetPackage*>(iter->get());
-        try
-        {
-            if(const auto asset = pkg->findByString(string))
-                return asset;
-        }
-        catch(const std::exception &e)
-        {
-            LOG(error,
-                "An exception was thrown while searching package {}: {}",
-                pkg->name(), e.what()
-            );
-        }
+        LOG(debug, "Searching asset in all packages: {}", string);
+        asset = searchPackages([&](AssetPackage *pkg) {
+            return pkg->findByString(string);
+        });
     }
-    return nullptr;
+    if(asset) mLocatorIndex.emplace(string, asset->handle());
+    return asset;
 }
 
 bool usagi::AssetRoot::acceptChild(Element *child)
 {
-    return is_instance_of<AssetPackage>(child);
+    const auto pkg = dynamic_cast<AssetPackage*>(child);
+    if(!pkg) return false;
+
+    std::lock_guard<std::mutex> lock(mIndexLock);
+    // insert before the packages of the same priority
+    const auto pos = std::find_if(mPackages.begin(), mPackages.end(),
+        [&](const MountedPackage &p) { return p.priority <= pkg->priority(); }
+    );
+    mPackages.insert(pos, { pkg->handle(), pkg->priority() });
+    // the new package may override the assets found before
+    mLocatorIndex.clear();
+    mUuidIndex.clear();
+    return true;
 }
 
 usagi::Asset * usagi::AssetRoot::findAsset(std::string locator) const
@@ -80,7 +135,7 @@ usagi::Asset * usagi::AssetRoot::findAsset(std::string locator) const
     if(locator.front() == '{') // try UUID
         asset = findAssetByUuid(boost::uuids::string_generator()(locator));
     else
-        asset = findAssetByString(std::move(locator));
+        asset = findAssetByString(locator);
     if(asset == nullptr)
         throw std::runtime_error("Asset not found.");
     return asset;
@@ -1,11 +1,25 @@
 ﻿#pragma once
 
+#include <any>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
 
 #include <Usagi/Core/Element.hpp>
+#include <Usagi/Core/Job/JobSystem.hpp>
 
 #include "Asset.hpp"
 #include "AssetLoadingContext.hpp"
+#include "SubresourceCache.hpp"
 
 namespace usagi
 {
@@ -14,11 +28,90 @@ class AssetPath;
 
 class AssetRoot : public Element
 {
+    JobSystem *mJobSystem = nullptr;
+
+    /**
+     * \brief Different types of resources may be derived from a single
+     * asset. For example, a JSON may be used to load a scene or a character.
+     */
+    SubresourceCache mSubresources;
+
+    /**
+     * \brief Guards the loads in flight. Looking up the cache and the
+     * pending loads happens atomically under it.
+     */
+    mutable std::mutex mLoadLock;
+
+    /**
+     * \brief Cached loads that have started but not finished, keyed by the
+     * asset, the subresource type and the variant like the cache. Each value
+     * holds a std::shared_future of the subresource. A request for a
+     * subresource being loaded shares the future instead of loading it again.
+     */
+    std::map<
+        std::tuple<Asset *, std::type_index, std::uint64_t>,
+        std::any
+    > mPendingLoads;
+
+    struct MountedPackage
+    {
+        ElementHandle handle;
+        int priority = 0;
+    };
+
+    /**
+     * \brief Guards the package list and the lookup indices. Held while
+     * searching the packages since they may create assets on discovery.
+     */
+    mutable std::mutex mIndexLock;
+
+    /**
+     * \brief Searched in order when a locator does not specify the package.
+     * Sorted by descending priority. Among packages of the same priority,
+     * the ones mounted later come first so that they override the earlier
+     * ones.
+     */
+    mutable std::vector<MountedPackage> mPackages;
+
+    /**
+     * \brief Assets found by previous lookups. Handles are stored instead of
+     * pointers so that entries of removed assets are detected. Cleared when a
+     * package is mounted since it may override the assets found before.
+     */
+    mutable std::unordered_map<std::string, ElementHandle> mLocatorIndex;
+    mutable std::unordered_map<
+        boost::uuids::uuid,
+        ElementHandle,
+        boost::hash<boost::uuids::uuid>
+    > mUuidIndex;
+
+    template <typename Search>
+    Asset * searchPackages(Search search) const;
+
     Asset * findAssetByUuid(const boost::uuids::uuid &uuid) const;
-    Asset * findAssetByString(std::string string) const;
+    Asset * findAssetByString(const std::string &string) const;
 
     bool acceptChild(Element *child) override;
 
+    /**
+     * \brief Decoders accepting a MemoryView are given the mapped content of
+     * the asset, which avoids copying it through a stream. Others are given
+     * an input stream.
+     */
+    template <typename DecoderT, typename = void>
+    struct DecodeHelper
+    {
+        using DecodedT = decltype(std::declval<DecoderT>()(
+            std::declval<std::istream&>()));
+    };
+
+    template <typename DecoderT>
+    struct DecodeHelper<DecoderT, std::enable_if_t<
+        std::is_invocable_v<DecoderT, const MemoryView &>>>
+    {
+        using DecodedT = std::invoke_result_t<DecoderT, const MemoryView &>;
+    };
+
     template <
         typename ConverterT,
         typename DecoderT = typename ConverterT::DefaultDecoder,
@@ -28,12 +121,173 @@ class AssetRoot : public Element
     {
         using ReturnT = decltype(std::declval<ConverterT>()(
             std::declval<AssetLoadingContext*>(),
-            std::declval<decltype(std::declval<DecoderT>()(
-                std::declval<std::istream&>()))&>(),
+            std::declval<typename DecodeHelper<DecoderT>::DecodedT&>(),
             std::declval<Args>()...
         ));
     };
 
+    /**
+     * \brief Converters whose results depend on their arguments, such as
+     * conversion options, may define a static cacheVariant() accepting the
+     * converter arguments. Its value distinguishes the cached results of the
+     * same asset converted with different arguments.
+     */
+    template <typename ConverterT, typename... Args>
+    static auto cacheVariant(int, const Args &...converter_args)
+        -> decltype(std::uint64_t(ConverterT::cacheVariant(converter_args...)))
+    {
+        return ConverterT::cacheVariant(converter_args...);
+    }
+
+    template <typename ConverterT, typename... Args>
+    static std::uint64_t cacheVariant(long, const Args &...)
+    {
+        return 0;
+    }
+
+    template <typename ResultT>
+    struct LoadTicket
+    {
+        std::shared_future<ResultT> future;
+        // not null if the caller is responsible for performing the load
+        std::shared_ptr<std::promise<ResultT>> promise;
+    };
+
+    /**
+     * \brief Look up the subresource in the cache and the pending loads.
+     * If neither has it, register a new pending load and return its promise
+     * to the caller, who must fulfill it with finishLoad().
+     * \tparam ResultT
+     * \param asset
+     * \param variant
+     * \return
+     */
+    template <typename ResultT>
+    LoadTicket<ResultT> beginLoad(Asset *asset, const std::uint64_t variant)
+    {
+        using SubresourceT = typename ResultT::element_type;
+
+        LoadTicket<ResultT> ticket;
+        std::lock_guard<std::mutex> lock(mLoadLock);
+        if(auto res = mSubresources.find<SubresourceT>(
+            asset->handle(), variant))
+        {
+            std::promise<ResultT> ready;
+            ready.set_value(std::move(res));
+            ticket.future = ready.get_future().share();
+            return ticket;
+        }
+        const auto [iter, inserted] = mPendingLoads.try_emplace(
+            { asset, typeid(SubresourceT), variant });
+        if(!inserted)
+        {
+            ticket.future = std::any_cast<const std::shared_future<ResultT>&>(
+                iter->second);
+            return ticket;
+        }
+        ticket.promise = std::make_shared<std::promise<ResultT>>();
+        ticket.future = ticket.promise->get_future().share();
+        iter->second = ticket.future;
+        return ticket;
+    }
+
+    /**
+     * \brief Cache the subresource and fulfill the pending load. If the
+     * load failed, the exception is propagated to all waiting requests and
+     * the next request retries the load.
+     * \tparam ResultT
+     * \param asset
+     * \param variant
+     * \param promise
+     * \param load Performs the load and returns the subresource.
+     */
+    template <typename ResultT, typename Load>
+    void finishLoad(
+        Asset *asset,
+        const std::uint64_t variant,
+        std::promise<ResultT> &promise,
+        Load &&load)
+    {
+        using SubresourceT = typename ResultT::element_type;
+
+        ResultT res;
+        std::exception_ptr exception;
+        try
+        {
+            res = load();
+        }
+        catch(...)
+        {
+            exception = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mLoadLock);
+            if(!exception)
+                mSubresources.insert(asset->handle(), res, variant);
+            mPendingLoads.erase({ asset, typeid(SubresourceT), variant });
+        }
+        if(exception)
+            promise.set_exception(exception);
+        else
+            promise.set_value(std::move(res));
+    }
+
+    /**
+     * \brief Wait for a load performed by another request. The calling
+     * thread executes other jobs meanwhile, which may include the load
+     * itself.
+     * \tparam ResultT
+     * \param future
+     */
+    template <typename ResultT>
+    void waitLoad(const std::shared_future<ResultT> &future) const
+    {
+        const auto ready = [&]() {
+            return future.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready;
+        };
+        if(mJobSystem)
+            mJobSystem->waitUntil(ready);
+        else
+            future.wait();
+    }
+
+    template <typename ConverterT, typename DecoderT, typename... Args>
+    static auto convert(AssetLoadingContext &ctx, Args &&...converter_args)
+    {
+        // the mapping or the stream must outlive the decoded value since
+        // it may refer to them
+        if constexpr(std::is_invocable_v<DecoderT, const MemoryView &>)
+        {
+            const auto view = ctx.asset->map();
+            return ConverterT()(
+                // converter can use the context to request additional
+                // resources
+                &ctx,
+                DecoderT()(view),
+                std::forward<Args>(converter_args)...);
+        }
+        else
+        {
+            // not using Asset::decode() so the lifetime of opened istream is
+            // in our control
+            const auto in = ctx.asset->open();
+            return ConverterT()(
+                &ctx,
+                DecoderT()(*in),
+                std::forward<Args>(converter_args)...);
+        }
+    }
+
+    AssetLoadingContext createContext(const std::string &locator)
+    {
+        AssetLoadingContext ctx;
+        ctx.asset_root = this;
+        ctx.locator = locator;
+        ctx.asset = findAsset(locator);
+        return ctx;
+    }
+
     /**
      * \brief Note that uncached loading may return any value, but cached
      * loading may only return a shared_ptr in order to store in the cache.
@@ -56,37 +310,59 @@ class AssetRoot : public Element
         Args &&...converter_args)
         -> typename FindHelper<ConverterT, DecoderT, Args...>::ReturnT
     {
-        AssetLoadingContext ctx;
-        ctx.asset_root = this;
-        ctx.locator = locator;
-        ctx.asset = findAsset(locator);
+        using ReturnT =
+            typename FindHelper<ConverterT, DecoderT, Args...>::ReturnT;
+
+        auto ctx = createContext(locator);
 
-        // found in cache
         if constexpr(AllowCache)
         {
-            if(auto res = ctx.asset->subresource<typename FindHelper<
-                ConverterT, DecoderT, Args...>::ReturnT::element_type
-            >()) return std::move(res);
+            const auto variant = cacheVariant<ConverterT>(0, converter_args...);
+            auto ticket = beginLoad<ReturnT>(ctx.asset, variant);
+            // found in cache or being loaded by another request
+            if(!ticket.promise)
+            {
+                waitLoad(ticket.future);
+                return ticket.future.get();
+            }
+            finishLoad(ctx.asset, variant, *ticket.promise, [&]() {
+                return convert<ConverterT, DecoderT>(
+                    ctx, std::forward<Args>(converter_args)...);
+            });
+            return ticket.future.get();
+        }
+        else
+        {
+            return convert<ConverterT, DecoderT>(
+                ctx, std::forward<Args>(converter_args)...);
         }
-
-        // load from stream
-        // not using Asset::decode() so the lifetime of opened istream is in
-        // our control
-        const auto in = ctx.asset->open();
-        auto res = ConverterT()(
-            // converter can use the context to request additional resources
-            &ctx,
-            DecoderT()(*in),
-            std::forward<Args>(converter_args)...);
-        if constexpr(AllowCache) ctx.asset->addSubresource(res);
-        return std::move(res);
     }
 
 public:
-    AssetRoot(Element *parent, std::string name);
+    /**
+     * \brief
+     * \param parent
+     * \param name
+     * \param jobs The job system executing asynchronous loads. If null,
+     * resAsync() loads on the calling thread.
+     */
+    AssetRoot(Element *parent, std::string name, JobSystem *jobs = nullptr);
+    ~AssetRoot();
 
+    /**
+     * \brief Find the asset referred to by the locator, which is either a
+     * UUID enclosed in braces, a path prefixed by the package name and a
+     * colon, or a path searched in all packages in the order of priority.
+     * Results are indexed so repeated lookups take constant time.
+     * \param locator
+     * \return
+     */
     Asset * findAsset(std::string locator) const;
 
+    SubresourceCache * subresources() { return &mSubresources; }
+
+    JobSystem * jobs() const { return mJobSystem; }
+
     template <
         typename ConverterT,
         typename DecoderT = typename ConverterT::DefaultDecoder,
@@ -100,6 +376,57 @@ public:
         );
     }
 
+    /**
+     * \brief Load a subresource on the worker threads of the job system.
+     * The asset is located on the calling thread, which throws if it is not
+     * found, while decoding and conversion are performed by a job. Requests
+     * for a subresource that is cached or being loaded share the result
+     * without loading it again. The converter arguments are copied into the
+     * job, and the converter must be safe to call from any thread.
+     * \tparam ConverterT
+     * \tparam DecoderT
+     * \tparam Args
+     * \param locator
+     * \param converter_args
+     * \return A future of the subresource. Exceptions thrown by the decoder
+     * or the converter are rethrown by get().
+     */
+    template <
+        typename ConverterT,
+        typename DecoderT = typename ConverterT::DefaultDecoder,
+        typename... Args
+    >
+    auto resAsync(const std::string &locator, Args &&...converter_args)
+    {
+        using ReturnT = typename FindHelper<
+            ConverterT, DecoderT, std::decay_t<Args>&...>::ReturnT;
+
+        auto ctx = createContext(locator);
+        const auto variant = cacheVariant<ConverterT>(0, converter_args...);
+        auto ticket = beginLoad<ReturnT>(ctx.asset, variant);
+        if(!ticket.promise)
+            return ticket.future;
+
+        auto job = [
+            this,
+            ctx = std::move(ctx),
+            variant,
+            promise = ticket.promise,
+            args = std::make_tuple(std::forward<Args>(converter_args)...)
+        ]() mutable {
+            finishLoad(ctx.asset, variant, *promise, [&]() {
+                return std::apply([&](auto &...a) {
+                    return convert<ConverterT, DecoderT>(ctx, a...);
+                }, args);
+            });
+        };
+        if(mJobSystem)
+            mJobSystem->submit(std::move(job));
+        else
+            job();
+        return ticket.future;
+    }
+
     template <
         typename ConverterT,
         typename DecoderT = typename ConverterT::DefaultDecoder,
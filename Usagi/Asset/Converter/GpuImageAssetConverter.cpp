@@ -1,39 +1,216 @@
 ﻿#include "GpuImageAssetConverter.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include <Usagi/Asset/Decoder/ImageBuffer.hpp>
 #include <Usagi/Core/Logging.hpp>
 #include <Usagi/Runtime/Graphics/Enum/GpuBufferFormat.hpp>
 #include <Usagi/Runtime/Graphics/GpuDevice.hpp>
 #include <Usagi/Runtime/Graphics/GpuImage.hpp>
 #include <Usagi/Runtime/Graphics/GpuImageCreateInfo.hpp>
+#include <Usagi/Utility/PixelConversion.hpp>
 
-std::shared_ptr<usagi::GpuImage>
-usagi::GpuImageAssetConverter::operator()(
-    AssetLoadingContext *ctx,
+namespace
+{
+using namespace usagi;
+
+using StagingWriter = std::function<void(void *staging)>;
+
+struct ConvertedImage
+{
+    GpuBufferFormat format;
+    std::size_t size = 0;
+    StagingWriter write;
+};
+
+// pixels converted at a time through a buffer on the stack when a second
+// pass is needed, since the staging memory is slow to read back.
+constexpr std::size_t CHUNK_PIXELS = 256;
+
+ConvertedImage convertUint8(
     const ImageBuffer &buffer,
-    GpuDevice *device) const
+    const std::size_t pixel_count,
+    const GpuImageConversionOptions &options)
 {
-    if(buffer.format != ImageBuffer::ChannelFormat::UINT8)
+    const auto src = reinterpret_cast<const std::uint8_t*>(
+        buffer.buffer.get());
+    const auto rgba_format = options.srgb
+        ? GpuBufferFormat::R8G8B8A8_SRGB
+        : GpuBufferFormat::R8G8B8A8_UNORM;
+    const auto copy = [src, size = buffer.buffer_size](void *staging) {
+        std::memcpy(staging, src, size);
+    };
+    const auto premultiply = options.srgb
+        ? premultiplySrgba8
+        : premultiplyRgba8;
+
+    switch(buffer.channels)
     {
-        LOG(error, "Only uint8 images are implemented yet.");
-        throw std::runtime_error("Unimplemented image format.");
+        // opaque, so premultiplying does not change it
+        case 1: return { rgba_format, pixel_count * 4, [=](void *staging) {
+            convertL8ToRgba8(
+                src, static_cast<std::uint8_t*>(staging), pixel_count);
+        } };
+        case 2:
+            if(!options.premultiply_alpha)
+            {
+                return { rgba_format, pixel_count * 4, [=](void *staging) {
+                    convertLa8ToRgba8(
+                        src, static_cast<std::uint8_t*>(staging), pixel_count);
+                } };
+            }
+            return { rgba_format, pixel_count * 4, [=](void *staging) {
+                const auto dst = static_cast<std::uint8_t*>(staging);
+                std::uint8_t rgba[CHUNK_PIXELS * 4];
+                for(std::size_t i = 0; i < pixel_count; i += CHUNK_PIXELS)
+                {
+                    const auto n = std::min(CHUNK_PIXELS, pixel_count - i);
+                    convertLa8ToRgba8(src + i * 2, rgba, n);
+                    premultiply(rgba, dst + i * 4, n);
+                }
+            } };
+        case 3: return { rgba_format, pixel_count * 4, [=](void *staging) {
+            convertRgb8ToRgba8(
+                src, static_cast<std::uint8_t*>(staging), pixel_count);
+        } };
+        case 4:
+            if(!options.premultiply_alpha)
+                return { rgba_format, pixel_count * 4, copy };
+            return { rgba_format, pixel_count * 4, [=](void *staging) {
+                premultiply(
+                    src, static_cast<std::uint8_t*>(staging), pixel_count);
+            } };
+        default:
+            LOG(error, "Invalid channel amount: {}", buffer.channels);
+            throw std::runtime_error("Invalid image.");
     }
+}
 
-    GpuImageCreateInfo info;
+ConvertedImage convertFloat32(
+    const ImageBuffer &buffer,
+    const std::size_t pixel_count,
+    const GpuImageConversionOptions &options)
+{
+    const auto src = reinterpret_cast<const float*>(buffer.buffer.get());
     switch(buffer.channels)
     {
-        case 1: info.format = GpuBufferFormat::R8_UNORM; break;
-        case 2: info.format = GpuBufferFormat::R8G8_UNORM; break;
-        case 3: info.format = GpuBufferFormat::R8G8B8_UNORM; break;
-        case 4: info.format = GpuBufferFormat::R8G8B8A8_UNORM; break;
+        case 1:
+            return { GpuBufferFormat::R16G16B16A16_SFLOAT, pixel_count * 8,
+                [=](void *staging) {
+                    convertL32fToRgba16f(src,
+                        static_cast<std::uint16_t*>(staging), pixel_count);
+                } };
+        case 2:
+            if(!options.premultiply_alpha)
+            {
+                return { GpuBufferFormat::R16G16B16A16_SFLOAT,
+                    pixel_count * 8, [=](void *staging) {
+                        convertLa32fToRgba16f(src,
+                            static_cast<std::uint16_t*>(staging), pixel_count);
+                    } };
+            }
+            // rare for HDR images, so not vectorized
+            return { GpuBufferFormat::R16G16B16A16_SFLOAT, pixel_count * 8,
+                [=](void *staging) {
+                    const auto dst = static_cast<std::uint16_t*>(staging);
+                    for(std::size_t i = 0; i < pixel_count; ++i)
+                    {
+                        const auto alpha = src[i * 2 + 1];
+                        const auto l = floatToHalf(src[i * 2] * alpha);
+                        dst[i * 4 + 0] = l;
+                        dst[i * 4 + 1] = l;
+                        dst[i * 4 + 2] = l;
+                        dst[i * 4 + 3] = floatToHalf(alpha);
+                    }
+                } };
+        case 3:
+            return { GpuBufferFormat::R16G16B16A16_SFLOAT, pixel_count * 8,
+                [=](void *staging) {
+                    convertRgb32fToRgba16f(src,
+                        static_cast<std::uint16_t*>(staging), pixel_count);
+                } };
+        case 4:
+            if(!options.premultiply_alpha)
+            {
+                return { GpuBufferFormat::R16G16B16A16_SFLOAT,
+                    pixel_count * 8, [=](void *staging) {
+                        convertFloat32ToFloat16(src,
+                            static_cast<std::uint16_t*>(staging),
+                            pixel_count * 4);
+                    } };
+            }
+            // rare for HDR images, so not vectorized
+            return { GpuBufferFormat::R16G16B16A16_SFLOAT, pixel_count * 8,
+                [=](void *staging) {
+                    const auto dst = static_cast<std::uint16_t*>(staging);
+                    for(std::size_t i = 0; i < pixel_count * 4; i += 4)
+                    {
+                        const auto alpha = src[i + 3];
+                        dst[i + 0] = floatToHalf(src[i + 0] * alpha);
+                        dst[i + 1] = floatToHalf(src[i + 1] * alpha);
+                        dst[i + 2] = floatToHalf(src[i + 2] * alpha);
+                        dst[i + 3] = floatToHalf(alpha);
+                    }
+                } };
         default:
             LOG(error, "Invalid channel amount: {}", buffer.channels);
             throw std::runtime_error("Invalid image.");
     }
+}
+}
+
+std::shared_ptr<usagi::GpuImage>
+usagi::GpuImageAssetConverter::operator()(
+    AssetLoadingContext *ctx,
+    const ImageBuffer &buffer,
+    GpuDevice *device,
+    const GpuImageConversionOptions &options) const
+{
+    const auto pixel_count =
+        std::size_t(buffer.image_size.x()) * buffer.image_size.y();
+
+    ConvertedImage converted;
+    switch(buffer.format)
+    {
+        case ImageBuffer::ChannelFormat::UINT8:
+            converted = convertUint8(buffer, pixel_count, options);
+            break;
+        case ImageBuffer::ChannelFormat::FLOAT32:
+            converted = convertFloat32(buffer, pixel_count, options);
+            break;
+        default:
+            LOG(error, "Unsupported image channel format.");
+            throw std::runtime_error("Unimplemented image format.");
+    }
+
+    GpuImageCreateInfo info;
+    info.format = converted.format;
     info.size = buffer.image_size;
     info.usage = GpuImageUsage::SAMPLED;
 
     auto image = device->createImage(info);
-    image->upload(buffer.buffer.get(), buffer.buffer_size);
+    image->upload(converted.size, converted.write);
     return image;
 }
+
+std::size_t usagi::SubresourceSize<usagi::GpuImage>::operator()(
+    const GpuImage &res) const
+{
+    std::size_t texel_size;
+    switch(res.format().format)
+    {
+        case GpuBufferFormat::R8_UNORM: texel_size = 1; break;
+        case GpuBufferFormat::R8G8_UNORM: texel_size = 2; break;
+        case GpuBufferFormat::R8G8B8_UNORM: texel_size = 3; break;
+        case GpuBufferFormat::R16_SFLOAT: texel_size = 2; break;
+        case GpuBufferFormat::R16G16B16A16_SFLOAT: texel_size = 8; break;
+        case GpuBufferFormat::R32G32_SFLOAT: texel_size = 8; break;
+        case GpuBufferFormat::R32G32B32_SFLOAT: texel_size = 12; break;
+        case GpuBufferFormat::R32G32B32A32_SFLOAT: texel_size = 16; break;
+        default: texel_size = 4; break;
+    }
+    const auto size = res.size();
+    return std::size_t(size.x()) * size.y() * texel_size *
+        std::max<std::size_t>(res.format().sample_count, 1);
+}
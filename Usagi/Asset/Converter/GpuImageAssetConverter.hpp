@@ -2,6 +2,7 @@
 
 #include <memory>
 
+#include <Usagi/Asset/SubresourceCache.hpp>
 #include <Usagi/Asset/Decoder/StbImageAssetDecoder.hpp>
 #include <Usagi/Runtime/Graphics/GpuImage.hpp>
 
@@ -11,6 +12,29 @@ struct AssetLoadingContext;
 struct ImageBuffer;
 class GpuDevice;
 
+struct GpuImageConversionOptions
+{
+    /**
+     * \brief Use an sRGB format for 8-bit color images so that the GPU
+     * converts them to linear values when sampling. HDR images are always
+     * linear.
+     */
+    bool srgb = false;
+
+    /**
+     * \brief Multiply the color of images with alpha by the alpha.
+     */
+    bool premultiply_alpha = false;
+};
+
+/**
+ * \brief Creates a sampled image from the decoded pixels, converting them into
+ * the staging memory of the upload. All images are expanded to RGBA, so that
+ * gray images sample as gray and the options apply to them as well, and
+ * since 3-channel formats are rarely supported for sampling. HDR images are
+ * stored as 16-bit floats.
+ * Images converted with different options are cached separately.
+ */
 struct GpuImageAssetConverter
 {
     using DefaultDecoder = StbImageAssetDecoder;
@@ -18,6 +42,21 @@ struct GpuImageAssetConverter
     std::shared_ptr<GpuImage> operator()(
         AssetLoadingContext *ctx,
         const ImageBuffer &buffer,
-        GpuDevice *device) const;
+        GpuDevice *device,
+        const GpuImageConversionOptions &options = { }) const;
+
+    static std::uint64_t cacheVariant(
+        GpuDevice *device,
+        const GpuImageConversionOptions &options = { })
+    {
+        return std::uint64_t(options.srgb) |
+            std::uint64_t(options.premultiply_alpha) << 1;
+    }
+};
+
+template <>
+struct SubresourceSize<GpuImage>
+{
+    std::size_t operator()(const GpuImage &res) const;
 };
 }
@@ -1,12 +1,74 @@
 ﻿#include "SpirvAssetConverter.hpp"
 
+#include <Usagi/Asset/AssetLoadingContext.hpp>
+#include <Usagi/Asset/AssetRoot.hpp>
+#include <Usagi/Core/Logging.hpp>
 #include <Usagi/Runtime/Graphics/Shader/SpirvBinary.hpp>
 
+usagi::AssetGlslIncluder::AssetGlslIncluder(AssetRoot *asset_root)
+    : mAssetRoot { asset_root }
+{
+}
+
+std::optional<usagi::GlslIncluder::Include> usagi::AssetGlslIncluder::include(
+    const std::string &header_name,
+    const std::string &includer_name,
+    const bool relative)
+{
+    Asset *asset = nullptr;
+    std::string path;
+    std::exception_ptr exception;
+    const auto find = [&]() {
+        try
+        {
+            auto locator = header_name;
+            if(relative && !includer_name.empty())
+            {
+                locator = mAssetRoot->findAsset(includer_name)->parentPath() +
+                    header_name;
+            }
+            asset = mAssetRoot->findAsset(locator);
+            path = asset->path();
+        }
+        catch(...)
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    const auto jobs = mAssetRoot->jobs();
+    if(jobs && !jobs->isMainThread())
+    {
+        JobCounter counter;
+        jobs->submitMainThread(find, &counter);
+        jobs->wait(counter);
+    }
+    else
+    {
+        find();
+    }
+
+    try
+    {
+        if(exception) std::rethrow_exception(exception);
+        return Include { std::move(path), asset->map() };
+    }
+    catch(const std::exception &e)
+    {
+        LOG(debug, "Could not include {} from {}: {}",
+            header_name, includer_name, e.what());
+        return { };
+    }
+}
+
 std::shared_ptr<usagi::SpirvBinary> usagi::SpirvAssetConverter::operator()(
     AssetLoadingContext *ctx,
-    std::istream &in,
+    const MemoryView &source,
     const ShaderStage stage,
     const std::optional<std::filesystem::path> & cache_folder) const
 {
-    return SpirvBinary::fromGlslSourceStream(in, stage, cache_folder);
+    AssetGlslIncluder includer { ctx->asset_root };
+    return SpirvBinary::fromGlslSourceString(
+        source.asStringView(), stage, cache_folder,
+        &includer, ctx->asset->path());
 }
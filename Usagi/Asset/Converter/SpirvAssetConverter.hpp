@@ -4,23 +4,63 @@
 #include <filesystem>
 #include <optional>
 
-#include <Usagi/Asset/Decoder/RawAssetDecoder.hpp>
+#include <Usagi/Asset/SubresourceCache.hpp>
+#include <Usagi/Asset/Decoder/MappedAssetDecoder.hpp>
 #include <Usagi/Runtime/Graphics/Shader/SpirvBinary.hpp>
 
 namespace usagi
 {
 struct AssetLoadingContext;
+class AssetRoot;
 
+/**
+ * \brief Resolves #include directives to assets. Relative includes are
+ * looked up in the directory of the including asset, others are treated as
+ * asset locators. Included assets are named by their full paths.
+ *
+ * Shaders are usually compiled by jobs, but locating an asset may create
+ * elements on discovery, which is only safe on the main thread. So the
+ * lookups made on other threads are performed by the main thread of the
+ * job system of the asset root while the calling thread waits.
+ */
+class AssetGlslIncluder : public GlslIncluder
+{
+    AssetRoot *mAssetRoot = nullptr;
+
+public:
+    explicit AssetGlslIncluder(AssetRoot *asset_root);
+
+    std::optional<Include> include(
+        const std::string &header_name,
+        const std::string &includer_name,
+        bool relative) override;
+};
+
+/**
+ * \brief Compiles GLSL source assets, which may include other assets. The
+ * compiled binaries are cached under the cache folder until the source or
+ * any included asset changes.
+ */
 struct SpirvAssetConverter
 {
-    using DefaultDecoder = RawAssetDecoder;
+    using DefaultDecoder = MappedAssetDecoder;
 
     std::shared_ptr<SpirvBinary> operator()(
         AssetLoadingContext *ctx,
-        std::istream &in,
+        const MemoryView &source,
         ShaderStage stage,
         const std::optional<std::filesystem::path> & cache_folder =
             "./.cache/shader"
     ) const;
 };
+
+template <>
+struct SubresourceSize<SpirvBinary>
+{
+    std::size_t operator()(const SpirvBinary &res) const
+    {
+        return sizeof(SpirvBinary) +
+            res.bytecodes().size() * sizeof(SpirvBinary::Bytecode);
+    }
+};
 }
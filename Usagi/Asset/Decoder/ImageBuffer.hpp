@@ -7,6 +7,10 @@
 
 namespace usagi
 {
+/**
+ * \brief A decoded image with tightly packed pixels in the channel count and
+ * format of the file. HDR images are decoded into linear float values.
+ */
 struct ImageBuffer
 {
     using Byte = std::byte;
@@ -23,8 +27,5 @@ struct ImageBuffer
         // UINT16,
         // UINT32,
     } format = ChannelFormat::UINT8;
-
-    // todo hdr support
-    // bool hdr = false;
 };
 }
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <Usagi/Utility/MemoryView.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Passes the memory-mapped content of the asset directly to
+ * converter.
+ */
+struct MappedAssetDecoder
+{
+    const MemoryView & operator()(const MemoryView &data) const
+    {
+        return data;
+    }
+};
+}
@@ -1,5 +1,8 @@
 ﻿#include "StbImageAssetDecoder.hpp"
 
+#include <climits>
+#include <type_traits>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -49,29 +52,74 @@ stbi_io_callbacks gCallbacks
 };
 }
 
-usagi::ImageBuffer usagi::StbImageAssetDecoder::operator()(
-    std::istream &in) const
+namespace
+{
+template <typename Channel>
+usagi::ImageBuffer wrapImage(
+    Channel *data,
+    const int x,
+    const int y,
+    const int channels)
 {
-    int x, y, channels, force_channels = 4;
-    // todo 4 channels is forced, as the support for 3 channel images is not implemented yet.
-    auto *data = stbi_load_from_callbacks(
-        &gCallbacks, &in, &x, &y, &channels, force_channels);
     if(data == nullptr)
     {
         LOG(error, "Failed to load image: {}", stbi_failure_reason());
         throw std::runtime_error(stbi_failure_reason());
     }
 
-    ImageBuffer img;
+    usagi::ImageBuffer img;
 
     img.buffer = {
-        reinterpret_cast<ImageBuffer::Byte*>(data), stbi_image_free
+        reinterpret_cast<usagi::ImageBuffer::Byte*>(data), stbi_image_free
     };
-    img.buffer_size = x * y * force_channels * sizeof(std::uint8_t);
+    img.buffer_size = std::size_t(x) * y * channels * sizeof(Channel);
     img.image_size = { x, y };
-    img.channels = force_channels; // channels;
-    img.format = ImageBuffer::ChannelFormat::UINT8;
-    // img.hdr = false;
+    img.channels = channels;
+    img.format = std::is_floating_point_v<Channel>
+        ? usagi::ImageBuffer::ChannelFormat::FLOAT32
+        : usagi::ImageBuffer::ChannelFormat::UINT8;
 
     return img;
 }
+}
+
+usagi::ImageBuffer usagi::StbImageAssetDecoder::operator()(
+    std::istream &in) const
+{
+    // the test consumes the stream
+    const auto start = in.tellg();
+    const bool hdr = stbi_is_hdr_from_callbacks(&gCallbacks, &in);
+    in.clear();
+    in.seekg(start);
+
+    // native channel count
+    int x, y, channels;
+    if(hdr)
+    {
+        auto *data = stbi_loadf_from_callbacks(
+            &gCallbacks, &in, &x, &y, &channels, 0);
+        return wrapImage(data, x, y, channels);
+    }
+    auto *data = stbi_load_from_callbacks(
+        &gCallbacks, &in, &x, &y, &channels, 0);
+    return wrapImage(data, x, y, channels);
+}
+
+usagi::ImageBuffer usagi::StbImageAssetDecoder::operator()(
+    const MemoryView &data) const
+{
+    if(data.size() > static_cast<std::size_t>(INT_MAX))
+        throw std::runtime_error("Image file is too large.");
+
+    const auto bytes = reinterpret_cast<const stbi_uc*>(data.data());
+    const auto size = static_cast<int>(data.size());
+    int x, y, channels;
+    if(stbi_is_hdr_from_memory(bytes, size))
+    {
+        auto *pixels = stbi_loadf_from_memory(
+            bytes, size, &x, &y, &channels, 0);
+        return wrapImage(pixels, x, y, channels);
+    }
+    auto *pixels = stbi_load_from_memory(bytes, size, &x, &y, &channels, 0);
+    return wrapImage(pixels, x, y, channels);
+}
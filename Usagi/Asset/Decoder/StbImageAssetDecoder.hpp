@@ -1,7 +1,10 @@
 ﻿#pragma once
 
+#include <istream>
 #include <string>
 
+#include <Usagi/Utility/MemoryView.hpp>
+
 #include "ImageBuffer.hpp"
 
 namespace usagi
@@ -10,10 +13,20 @@ bool isStbImageSupportedFormat(const std::string &file_extension);
 
 /**
  * \brief Decodes byte stream of JPG, PNG, TGA, BMP, PSD, GIF, HDR, PIC file.
- * Requires the stream to be
+ * The channel count of the file is kept, leaving the expansion to the
+ * converter. HDR files are decoded into FLOAT32 and others into UINT8.
+ * The stream must be seekable.
  */
 struct StbImageAssetDecoder
 {
     ImageBuffer operator()(std::istream &in) const;
+
+    /**
+     * \brief Decode directly from memory, such as a mapped file, without
+     * copying through a stream.
+     * \param data
+     * \return
+     */
+    ImageBuffer operator()(const MemoryView &data) const;
 };
 }
@@ -2,6 +2,7 @@
 
 #include <Usagi/Asset/AssetRoot.hpp>
 #include <Usagi/Asset/Converter/GpuImageAssetConverter.hpp>
+#include <Usagi/Asset/Converter/SpirvAssetConverter.hpp>
 #include <Usagi/Game/Game.hpp>
 #include <Usagi/Runtime/Runtime.hpp>
 
@@ -13,3 +14,39 @@ std::shared_ptr<usagi::GpuImage> usagi::loadTexture(
         locator, game->runtime()->gpu()
     );
 }
+
+std::shared_future<std::shared_ptr<usagi::GpuImage>>
+usagi::loadTextureAsync(
+    Game *game,
+    const std::string &locator)
+{
+    return game->assets()->resAsync<GpuImageAssetConverter>(
+        locator, game->runtime()->gpu()
+    );
+}
+
+std::vector<std::shared_ptr<usagi::SpirvBinary>> usagi::loadShaders(
+    Game *game,
+    const std::vector<ShaderSource> &shaders)
+{
+    std::vector<std::shared_future<std::shared_ptr<SpirvBinary>>> futures;
+    futures.reserve(shaders.size());
+    for(auto &&s : shaders)
+    {
+        futures.push_back(game->assets()->resAsync<SpirvAssetConverter>(
+            s.locator, s.stage
+        ));
+    }
+
+    std::vector<std::shared_ptr<SpirvBinary>> binaries;
+    binaries.reserve(futures.size());
+    for(auto &&f : futures)
+    {
+        game->jobs()->waitUntil([&]() {
+            return f.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready;
+        });
+        binaries.push_back(f.get());
+    }
+    return binaries;
+}
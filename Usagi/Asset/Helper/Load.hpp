@@ -1,12 +1,37 @@
 ﻿#pragma once
 
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include <Usagi/Runtime/Graphics/Shader/ShaderStage.hpp>
 
 namespace usagi
 {
 class Game;
 class GpuImage;
+class SpirvBinary;
 
 std::shared_ptr<GpuImage> loadTexture(Game *game, const std::string &locator);
+std::shared_future<std::shared_ptr<GpuImage>> loadTextureAsync(
+    Game *game,
+    const std::string &locator);
+
+struct ShaderSource
+{
+    std::string locator;
+    ShaderStage stage;
+};
+
+/**
+ * \brief Compile the shaders in parallel on the job system of the game and
+ * wait for all of them. The calling thread takes part in the compilation.
+ * \param game
+ * \param shaders
+ * \return The binaries in the order of the sources.
+ */
+std::vector<std::shared_ptr<SpirvBinary>> loadShaders(
+    Game *game,
+    const std::vector<ShaderSource> &shaders);
 }
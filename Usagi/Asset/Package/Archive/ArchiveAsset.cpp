@@ -0,0 +1,78 @@
+﻿#include "ArchiveAsset.hpp"
+
+#include <lz4.h>
+
+#include <Usagi/Core/Logging.hpp>
+#include <Usagi/Utility/Stream.hpp>
+#include <Usagi/Utility/TypeCast.hpp>
+
+usagi::ArchiveAsset::ArchiveAsset(
+    Element *parent,
+    std::string name,
+    const boost::uuids::uuid uuid,
+    const std::uint32_t entry_index)
+    : Asset { parent, std::move(name), uuid }
+    , mEntryIndex { entry_index }
+{
+    assert(is_instance_of<ArchiveAssetPackage>(parent));
+}
+
+usagi::ArchiveAssetPackage * usagi::ArchiveAsset::package() const
+{
+    return static_cast<ArchiveAssetPackage*>(parent());
+}
+
+std::string usagi::ArchiveAsset::path() const
+{
+    return fmt::format("{}:{}", package()->name(), name());
+}
+
+std::string usagi::ArchiveAsset::parentPath() const
+{
+    const auto path = std::filesystem::u8path(name());
+    return fmt::format("{}:{}/",
+        package()->name(), path.parent_path().u8string());
+}
+
+std::unique_ptr<std::istream> usagi::ArchiveAsset::open()
+{
+    return std::make_unique<MemoryViewInputStream>(map());
+}
+
+usagi::MemoryView usagi::ArchiveAsset::map()
+{
+    const auto &entry = package()->entry(mEntryIndex);
+    const auto stored = package()->storedData(entry);
+
+    switch(entry.compression)
+    {
+        case ArchiveCompression::NONE:
+        {
+            if(entry.size != entry.stored_size)
+                throw std::runtime_error("Corrupted asset archive.");
+            return stored;
+        }
+        case ArchiveCompression::LZ4:
+        {
+            LOG(debug, "Decompressing asset: {}", name());
+
+            if(entry.size > LZ4_MAX_INPUT_SIZE ||
+                entry.stored_size > LZ4_MAX_INPUT_SIZE)
+                throw std::runtime_error("Asset is too large for LZ4.");
+            const auto buffer = std::shared_ptr<char[]>(new char[entry.size]);
+            const auto size = LZ4_decompress_safe(
+                reinterpret_cast<const char*>(stored.data()),
+                buffer.get(),
+                static_cast<int>(stored.size()),
+                static_cast<int>(entry.size));
+            if(size < 0 || static_cast<std::uint64_t>(size) != entry.size)
+            {
+                LOG(error, "Failed to decompress asset: {}", name());
+                throw std::runtime_error("Corrupted asset archive.");
+            }
+            return { buffer, buffer.get(), entry.size };
+        }
+        default:
+            throw std::runtime_error("Unsupported asset compression.");
+    }
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <Usagi/Asset/Asset.hpp>
+
+#include "ArchiveAssetPackage.hpp"
+
+namespace usagi
+{
+class ArchiveAsset : public Asset
+{
+    const std::uint32_t mEntryIndex;
+
+    ArchiveAssetPackage * package() const;
+
+public:
+    ArchiveAsset(
+        Element *parent,
+        std::string name,
+        boost::uuids::uuid uuid,
+        std::uint32_t entry_index);
+
+    std::unique_ptr<std::istream> open() override;
+
+    /**
+     * \brief Uncompressed entries are returned as a view into the mapped
+     * archive without copying. Compressed entries are decompressed into a
+     * new buffer on every call.
+     * \return
+     */
+    MemoryView map() override;
+
+    std::string path() const override;
+    std::string parentPath() const override;
+};
+}
@@ -0,0 +1,170 @@
+﻿#include "ArchiveAssetPackage.hpp"
+
+#include <cstring>
+
+#include <Usagi/Core/Logging.hpp>
+#include <Usagi/Utility/MappedFile.hpp>
+#include <Usagi/Utility/TypeCast.hpp>
+
+#include "ArchiveAsset.hpp"
+
+usagi::ArchiveAssetPackage::ArchiveAssetPackage(
+    Element *parent,
+    std::string name,
+    std::filesystem::path archive_path,
+    const int priority)
+    : AssetPackage { parent, std::move(name), priority }
+    , mArchivePath { std::move(archive_path) }
+    , mArchive { mapFile(mArchivePath) }
+{
+    LOG(info, "Mounting asset archive: {}", mArchivePath.u8string());
+
+    // only the header and the bounds of the tables are checked here so that
+    // the mount does not touch the pages of the table of contents. the
+    // entries are validated when they are accessed.
+    mHeader = at<ArchiveHeader>(0);
+    if(std::memcmp(mHeader->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+        throw std::runtime_error("Not an asset archive.");
+    if(mHeader->version != ARCHIVE_VERSION)
+        throw std::runtime_error("Unsupported asset archive version.");
+    at<ArchiveEntry>(mHeader->entries_offset, mHeader->entry_count);
+    at<char>(mHeader->strings_offset, mHeader->strings_size);
+    validateIndex(mHeader->path_index);
+    validateIndex(mHeader->uuid_index);
+}
+
+template <typename T>
+const T * usagi::ArchiveAssetPackage::at(
+    const std::uint64_t offset,
+    const std::uint64_t count) const
+{
+    if(offset > mArchive.size() ||
+        count > (mArchive.size() - offset) / sizeof(T) ||
+        offset % alignof(T) != 0)
+    {
+        LOG(error, "Corrupted asset archive: {}", mArchivePath.u8string());
+        throw std::runtime_error("Corrupted asset archive.");
+    }
+    return reinterpret_cast<const T*>(mArchive.data() + offset);
+}
+
+void usagi::ArchiveAssetPackage::validateIndex(const ArchiveIndex &index) const
+{
+    if(index.bucket_bits > 31 || index.slot_count > mHeader->entry_count)
+        throw std::runtime_error("Corrupted asset archive.");
+    const auto bucket_count = std::uint64_t(1) << index.bucket_bits;
+    at<ArchiveIndexSlot>(index.offset, index.slot_count);
+    at<std::uint32_t>(
+        index.offset + index.slot_count * sizeof(ArchiveIndexSlot),
+        bucket_count + 1);
+}
+
+template <typename Match>
+std::uint32_t usagi::ArchiveAssetPackage::lookup(
+    const ArchiveIndex &index,
+    const std::uint64_t hash,
+    Match match) const
+{
+    const auto bucket_count = std::uint64_t(1) << index.bucket_bits;
+    const auto slots = at<ArchiveIndexSlot>(index.offset, index.slot_count);
+    const auto buckets = at<std::uint32_t>(
+        index.offset + index.slot_count * sizeof(ArchiveIndexSlot),
+        bucket_count + 1);
+
+    const auto bucket = archiveBucket(hash, index.bucket_bits);
+    const auto begin = buckets[bucket], end = buckets[bucket + 1];
+    if(begin > end || end > index.slot_count)
+        throw std::runtime_error("Corrupted asset archive.");
+    // slots in a bucket are sorted by hash
+    for(auto i = begin; i < end && slots[i].hash <= hash; ++i)
+    {
+        if(slots[i].hash == hash && match(entry(slots[i].entry)))
+            return slots[i].entry;
+    }
+    return NOT_FOUND;
+}
+
+const usagi::ArchiveEntry & usagi::ArchiveAssetPackage::entry(
+    const std::uint32_t index) const
+{
+    if(index >= mHeader->entry_count)
+        throw std::runtime_error("Corrupted asset archive.");
+    return at<ArchiveEntry>(mHeader->entries_offset, mHeader->entry_count)[
+        index];
+}
+
+std::string_view usagi::ArchiveAssetPackage::entryPath(
+    const ArchiveEntry &entry) const
+{
+    if(entry.path_offset > mHeader->strings_size ||
+        entry.path_size > mHeader->strings_size - entry.path_offset)
+        throw std::runtime_error("Corrupted asset archive.");
+    return {
+        at<char>(mHeader->strings_offset) + entry.path_offset,
+        entry.path_size
+    };
+}
+
+usagi::MemoryView usagi::ArchiveAssetPackage::storedData(
+    const ArchiveEntry &entry) const
+{
+    at<std::byte>(entry.data_offset, entry.stored_size);
+    return mArchive.subview(entry.data_offset, entry.stored_size);
+}
+
+std::string usagi::ArchiveAssetPackage::normalizePath(
+    const std::filesystem::path &path)
+{
+    const auto normalized = path.relative_path().lexically_normal();
+    if(normalized.empty())
+        throw std::runtime_error("Empty path.");
+    const auto &first_component = *normalized.begin();
+    if(first_component == ".")
+        throw std::runtime_error("Path does not point to a file.");
+    if(first_component == "..")
+        throw std::runtime_error("Path must be within the archive.");
+    return normalized.generic_u8string();
+}
+
+usagi::Asset * usagi::ArchiveAssetPackage::findByEntry(
+    const std::uint32_t entry_index)
+{
+    const auto &e = entry(entry_index);
+    const auto path = std::string(entryPath(e));
+    if(const auto asset = findChild(path))
+        return static_cast<Asset*>(asset);
+    boost::uuids::uuid uuid;
+    std::memcpy(uuid.data, e.uuid, sizeof(e.uuid));
+    return addChild<ArchiveAsset>(path, uuid, entry_index);
+}
+
+usagi::Asset * usagi::ArchiveAssetPackage::findByUuid(
+    const boost::uuids::uuid &uuid)
+{
+    const auto key = std::string_view(
+        reinterpret_cast<const char*>(uuid.data), uuid.size());
+    const auto index = lookup(mHeader->uuid_index, archiveHash(key),
+        [&](const ArchiveEntry &e) {
+            return std::memcmp(e.uuid, uuid.data, sizeof(e.uuid)) == 0;
+        });
+    return index == NOT_FOUND ? nullptr : findByEntry(index);
+}
+
+usagi::Asset * usagi::ArchiveAssetPackage::findByString(
+    const std::string &string)
+{
+    const auto path = normalizePath(std::filesystem::u8path(string));
+    // assets found before
+    if(const auto asset = findChild(path))
+        return static_cast<Asset*>(asset);
+    const auto index = lookup(mHeader->path_index, archiveHash(path),
+        [&](const ArchiveEntry &e) {
+            return entryPath(e) == path;
+        });
+    return index == NOT_FOUND ? nullptr : findByEntry(index);
+}
+
+bool usagi::ArchiveAssetPackage::acceptChild(Element *child)
+{
+    return is_instance_of<ArchiveAsset>(child);
+}
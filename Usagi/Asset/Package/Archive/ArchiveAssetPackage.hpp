@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <filesystem>
+
+#include <Usagi/Asset/AssetPackage.hpp>
+#include <Usagi/Utility/MemoryView.hpp>
+
+#include "ArchiveFormat.hpp"
+
+namespace usagi
+{
+/**
+ * \brief A package reading assets from a single archive file created by
+ * ArchivePacker. The archive is mapped into memory and its table of contents
+ * is used in place, so mounting it does not depend on the number of assets
+ * and finding an asset never touches the filesystem.
+ */
+class ArchiveAssetPackage : public AssetPackage
+{
+    std::filesystem::path mArchivePath;
+    MemoryView mArchive;
+    const ArchiveHeader *mHeader = nullptr;
+
+    static constexpr std::uint32_t NOT_FOUND = ~std::uint32_t(0);
+
+    template <typename T>
+    const T * at(std::uint64_t offset, std::uint64_t count = 1) const;
+    void validateIndex(const ArchiveIndex &index) const;
+
+    /**
+     * \brief Find the entry whose key has the hash and satisfies the
+     * predicate.
+     * \tparam Match
+     * \param index
+     * \param hash
+     * \param match
+     * \return The entry index or NOT_FOUND.
+     */
+    template <typename Match>
+    std::uint32_t lookup(
+        const ArchiveIndex &index,
+        std::uint64_t hash,
+        Match match) const;
+
+    Asset * findByEntry(std::uint32_t entry_index);
+
+    bool acceptChild(Element *child) override;
+
+public:
+    ArchiveAssetPackage(
+        Element *parent,
+        std::string name,
+        std::filesystem::path archive_path,
+        int priority = 0
+    );
+
+    /**
+     * \brief Convert the path into the form stored in the archive, which is
+     * relative, lexically normal and separated by forward slashes. Throws if
+     * the path does not point into the archive.
+     * \param path
+     * \return
+     */
+    static std::string normalizePath(const std::filesystem::path &path);
+
+    Asset * findByUuid(const boost::uuids::uuid &uuid) override;
+    Asset * findByString(const std::string &string) override;
+
+    std::filesystem::path archivePath() const { return mArchivePath; }
+    std::uint32_t entryCount() const { return mHeader->entry_count; }
+
+    const ArchiveEntry & entry(std::uint32_t index) const;
+    std::string_view entryPath(const ArchiveEntry &entry) const;
+
+    /**
+     * \brief The content of the entry as stored in the archive, which is
+     * compressed if the entry is.
+     * \param entry
+     * \return
+     */
+    MemoryView storedData(const ArchiveEntry &entry) const;
+};
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/*
+ * Layout of an asset archive. All integers are little-endian.
+ *
+ *  ArchiveHeader
+ *  entry data, each aligned to ARCHIVE_DATA_ALIGNMENT
+ *  ArchiveEntry[entry_count]
+ *  path strings referred to by the entries, not null-terminated
+ *  path index: ArchiveIndexSlot[entry_count] sorted by hash,
+ *      uint32_t bucket_starts[bucket_count + 1]
+ *  UUID index: same as the path index, excluding entries with nil UUID
+ *
+ * A lookup hashes the key, takes the top bits of the hash as the bucket and
+ * compares the slots in the bucket, so it takes constant time on average
+ * without building any table when mounting the archive.
+ */
+
+namespace usagi
+{
+constexpr char ARCHIVE_MAGIC[8] = { 'U', 'S', 'A', 'G', 'I', 'P', 'A', 'K' };
+constexpr std::uint32_t ARCHIVE_VERSION = 1;
+constexpr std::uint64_t ARCHIVE_DATA_ALIGNMENT = 64;
+
+enum class ArchiveCompression : std::uint32_t
+{
+    NONE = 0,
+    LZ4 = 1,
+};
+
+struct ArchiveIndex
+{
+    std::uint64_t offset = 0;
+    // number of buckets is 1 << bucket_bits
+    std::uint32_t bucket_bits = 0;
+    std::uint32_t slot_count = 0;
+};
+
+struct ArchiveHeader
+{
+    char magic[8];
+    std::uint32_t version = ARCHIVE_VERSION;
+    std::uint32_t entry_count = 0;
+    std::uint64_t entries_offset = 0;
+    std::uint64_t strings_offset = 0;
+    std::uint64_t strings_size = 0;
+    ArchiveIndex path_index;
+    ArchiveIndex uuid_index;
+};
+
+struct ArchiveEntry
+{
+    std::uint64_t path_hash = 0;
+    // relative to the string table
+    std::uint32_t path_offset = 0;
+    std::uint32_t path_size = 0;
+    std::uint8_t uuid[16] { };
+    std::uint64_t data_offset = 0;
+    // size in the archive, which differs from size if compressed
+    std::uint64_t stored_size = 0;
+    std::uint64_t size = 0;
+    ArchiveCompression compression = ArchiveCompression::NONE;
+    std::uint32_t reserved = 0;
+};
+
+struct ArchiveIndexSlot
+{
+    std::uint64_t hash = 0;
+    std::uint32_t entry = 0;
+    std::uint32_t reserved = 0;
+};
+
+static_assert(sizeof(ArchiveHeader) == 72);
+static_assert(sizeof(ArchiveEntry) == 64);
+static_assert(sizeof(ArchiveIndexSlot) == 16);
+
+/**
+ * \brief 64-bit FNV-1a hash used for the keys of the archive indices. Must not
+ * be changed without bumping ARCHIVE_VERSION.
+ * \param bytes
+ * \return
+ */
+constexpr std::uint64_t archiveHash(const std::string_view bytes)
+{
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for(const auto c : bytes)
+    {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+constexpr std::uint32_t archiveBucket(
+    const std::uint64_t hash,
+    const std::uint32_t bucket_bits)
+{
+    return bucket_bits == 0
+        ? 0 : static_cast<std::uint32_t>(hash >> (64 - bucket_bits));
+}
+}
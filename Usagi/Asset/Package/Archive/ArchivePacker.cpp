@@ -0,0 +1,239 @@
+﻿#include "ArchivePacker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include <lz4.h>
+#include <boost/uuid/name_generator_sha1.hpp>
+
+#include <Usagi/Core/Logging.hpp>
+#include <Usagi/Utility/MappedFile.hpp>
+
+#include "ArchiveAssetPackage.hpp"
+#include "ArchiveFormat.hpp"
+
+namespace
+{
+using namespace usagi;
+
+class ArchiveWriter
+{
+    std::ofstream mOut;
+    std::uint64_t mOffset = 0;
+
+public:
+    explicit ArchiveWriter(const std::filesystem::path &path)
+        : mOut { path, std::ios::binary | std::ios::out | std::ios::trunc }
+    {
+        if(!mOut)
+        {
+            LOG(error, "Failed to open {}", path.u8string());
+            throw std::runtime_error("Failed to open file.");
+        }
+        mOut.exceptions(std::ios::badbit | std::ios::failbit);
+    }
+
+    std::uint64_t offset() const { return mOffset; }
+
+    void write(const void *data, const std::size_t size)
+    {
+        mOut.write(static_cast<const char*>(data), size);
+        mOffset += size;
+    }
+
+    template <typename T>
+    void write(const std::vector<T> &values)
+    {
+        write(values.data(), values.size() * sizeof(T));
+    }
+
+    void align(const std::uint64_t alignment)
+    {
+        static constexpr char ZEROS[ARCHIVE_DATA_ALIGNMENT] { };
+        const auto padding = (alignment - mOffset % alignment) % alignment;
+        write(ZEROS, padding);
+    }
+
+    void writeHeader(const ArchiveHeader &header)
+    {
+        mOut.seekp(0);
+        mOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+};
+
+ArchiveIndex writeIndex(
+    ArchiveWriter &writer,
+    std::vector<ArchiveIndexSlot> slots)
+{
+    ArchiveIndex index;
+    index.slot_count = static_cast<std::uint32_t>(slots.size());
+    // about one slot per bucket
+    while((std::uint64_t(1) << index.bucket_bits) < slots.size())
+        ++index.bucket_bits;
+
+    // sorting by hash also groups the slots by bucket since the bucket is
+    // taken from the top bits of the hash
+    std::sort(slots.begin(), slots.end(), [](auto &&lhs, auto &&rhs) {
+        return lhs.hash < rhs.hash;
+    });
+    std::vector<std::uint32_t> bucket_starts(
+        (std::size_t(1) << index.bucket_bits) + 1);
+    for(auto &&slot : slots)
+        ++bucket_starts[archiveBucket(slot.hash, index.bucket_bits) + 1];
+    for(std::size_t i = 1; i < bucket_starts.size(); ++i)
+        bucket_starts[i] += bucket_starts[i - 1];
+
+    writer.align(alignof(ArchiveIndexSlot));
+    index.offset = writer.offset();
+    writer.write(slots);
+    writer.write(bucket_starts);
+    return index;
+}
+}
+
+boost::uuids::uuid usagi::ArchivePacker::uuidFromPath(const std::string &path)
+{
+    static const boost::uuids::name_generator_sha1 generator {
+        boost::uuids::ns::url()
+    };
+    return generator("usagi-asset:" + path);
+}
+
+void usagi::ArchivePacker::addFile(
+    const std::string &path,
+    std::filesystem::path source,
+    const boost::uuids::uuid uuid,
+    const bool compress)
+{
+    mEntries.push_back({
+        ArchiveAssetPackage::normalizePath(std::filesystem::u8path(path)),
+        std::move(source),
+        uuid,
+        compress
+    });
+}
+
+void usagi::ArchivePacker::addDirectory(
+    const std::filesystem::path &root,
+    const bool compress)
+{
+    for(auto &&file : std::filesystem::recursive_directory_iterator(root))
+    {
+        if(!file.is_regular_file()) continue;
+        const auto path = ArchiveAssetPackage::normalizePath(
+            file.path().lexically_relative(root));
+        addFile(path, file.path(), uuidFromPath(path), compress);
+    }
+}
+
+usagi::ArchivePackerStats usagi::ArchivePacker::write(
+    const std::filesystem::path &output) const
+{
+    std::vector<const PendingEntry *> pending;
+    pending.reserve(mEntries.size());
+    for(auto &&e : mEntries)
+        pending.push_back(&e);
+    std::sort(pending.begin(), pending.end(), [](auto &&lhs, auto &&rhs) {
+        return lhs->path < rhs->path;
+    });
+    {
+        std::set<boost::uuids::uuid> uuids;
+        for(std::size_t i = 0; i < pending.size(); ++i)
+        {
+            if(i > 0 && pending[i]->path == pending[i - 1]->path)
+            {
+                LOG(error, "Duplicated asset path: {}", pending[i]->path);
+                throw std::runtime_error("Duplicated asset path.");
+            }
+            if(!pending[i]->uuid.is_nil() &&
+                !uuids.insert(pending[i]->uuid).second)
+            {
+                LOG(error, "Duplicated asset UUID: {}", pending[i]->path);
+                throw std::runtime_error("Duplicated asset UUID.");
+            }
+        }
+    }
+
+    LOG(info, "Packing {} assets into {}", pending.size(), output.u8string());
+
+    ArchivePackerStats stats;
+    ArchiveWriter writer(output);
+    ArchiveHeader header;
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.entry_count = static_cast<std::uint32_t>(pending.size());
+    // the header is rewritten after the tables are placed
+    writer.write(&header, sizeof(header));
+
+    std::vector<ArchiveEntry> entries(pending.size());
+    std::string strings;
+    std::vector<ArchiveIndexSlot> path_slots, uuid_slots;
+    std::vector<char> compressed;
+    for(std::size_t i = 0; i < pending.size(); ++i)
+    {
+        const auto &src = *pending[i];
+        auto &entry = entries[i];
+        const auto index = static_cast<std::uint32_t>(i);
+
+        entry.path_hash = archiveHash(src.path);
+        entry.path_offset = static_cast<std::uint32_t>(strings.size());
+        entry.path_size = static_cast<std::uint32_t>(src.path.size());
+        strings += src.path;
+        std::memcpy(entry.uuid, src.uuid.data, sizeof(entry.uuid));
+        path_slots.push_back({ entry.path_hash, index });
+        if(!src.uuid.is_nil())
+        {
+            uuid_slots.push_back({ archiveHash({
+                reinterpret_cast<const char*>(src.uuid.data), src.uuid.size()
+            }), index });
+        }
+
+        const auto content = mapFile(src.source);
+        entry.size = content.size();
+        const void *data = content.data();
+        entry.stored_size = content.size();
+        if(src.compress && content.size() > 0 &&
+            content.size() <= LZ4_MAX_INPUT_SIZE)
+        {
+            const auto size = static_cast<int>(content.size());
+            compressed.resize(LZ4_compressBound(size));
+            const auto compressed_size = LZ4_compress_default(
+                reinterpret_cast<const char*>(content.data()),
+                compressed.data(),
+                size,
+                static_cast<int>(compressed.size()));
+            if(compressed_size > 0 &&
+                static_cast<std::uint64_t>(compressed_size) <=
+                content.size() - content.size() / MIN_COMPRESSION_GAIN)
+            {
+                entry.compression = ArchiveCompression::LZ4;
+                entry.stored_size = compressed_size;
+                data = compressed.data();
+                ++stats.compressed_entries;
+            }
+        }
+
+        writer.align(ARCHIVE_DATA_ALIGNMENT);
+        entry.data_offset = writer.offset();
+        writer.write(data, entry.stored_size);
+        stats.content_bytes += entry.size;
+    }
+
+    writer.align(alignof(ArchiveEntry));
+    header.entries_offset = writer.offset();
+    writer.write(entries);
+    header.strings_offset = writer.offset();
+    header.strings_size = strings.size();
+    writer.write(strings.data(), strings.size());
+    header.path_index = writeIndex(writer, std::move(path_slots));
+    header.uuid_index = writeIndex(writer, std::move(uuid_slots));
+    stats.archive_bytes = writer.offset();
+    writer.writeHeader(header);
+
+    stats.entries = pending.size();
+    LOG(info, "Packed {} bytes into {} bytes, {} of {} assets compressed",
+        stats.content_bytes, stats.archive_bytes,
+        stats.compressed_entries, stats.entries);
+    return stats;
+}
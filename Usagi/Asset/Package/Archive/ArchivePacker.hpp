@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/nil_generator.hpp>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+struct ArchivePackerStats
+{
+    std::size_t entries = 0;
+    std::size_t compressed_entries = 0;
+    std::uint64_t content_bytes = 0;
+    std::uint64_t archive_bytes = 0;
+};
+
+/**
+ * \brief Builds an archive read by ArchiveAssetPackage from loose files.
+ * Entries are stored in the order of their paths so that assets of the same
+ * directory are adjacent in the archive.
+ */
+class ArchivePacker : Noncopyable
+{
+    struct PendingEntry
+    {
+        std::string path;
+        std::filesystem::path source;
+        boost::uuids::uuid uuid;
+        bool compress = false;
+    };
+
+    std::vector<PendingEntry> mEntries;
+
+public:
+    /**
+     * \brief Entries are stored compressed only if this saves at least
+     * 1 / MIN_COMPRESSION_GAIN of their size. Otherwise, they can be mapped
+     * without decompression.
+     */
+    static constexpr std::uint64_t MIN_COMPRESSION_GAIN = 8;
+
+    /**
+     * \brief Derive a stable UUID for the asset from its path in the
+     * archive, so that the UUID survives repacking.
+     * \param path
+     * \return
+     */
+    static boost::uuids::uuid uuidFromPath(const std::string &path);
+
+    /**
+     * \brief
+     * \param path The path of the asset in the archive.
+     * \param source The file providing the content.
+     * \param uuid Entries with nil UUID can only be found by path.
+     * \param compress Try compressing the entry with LZ4.
+     */
+    void addFile(
+        const std::string &path,
+        std::filesystem::path source,
+        boost::uuids::uuid uuid = boost::uuids::nil_uuid(),
+        bool compress = true);
+
+    /**
+     * \brief Add all regular files under the directory recursively, using
+     * their relative paths as asset paths and UUIDs derived from them.
+     * \param root
+     * \param compress
+     */
+    void addDirectory(const std::filesystem::path &root, bool compress = true);
+
+    /**
+     * \brief Write the archive. Throws if two entries have the same path or
+     * UUID.
+     * \param output
+     * \return
+     */
+    ArchivePackerStats write(const std::filesystem::path &output) const;
+};
+}
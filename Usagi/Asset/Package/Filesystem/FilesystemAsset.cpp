@@ -4,6 +4,8 @@
 
 #include <Usagi/Core/Logging.hpp>
 #include <Usagi/Runtime/Runtime.hpp>
+#include <Usagi/Utility/MappedFile.hpp>
+#include <Usagi/Utility/TypeCast.hpp>
 
 #include "FilesystemAssetPackage.hpp"
 
@@ -52,3 +54,10 @@ std::unique_ptr<std::istream> usagi::FilesystemAsset::open()
 
     return std::move(in);
 }
+
+usagi::MemoryView usagi::FilesystemAsset::map()
+{
+    LOG(info, "Mapping asset: {}", name());
+
+    return mapFile(package()->rootPath() / std::filesystem::u8path(name()));
+}
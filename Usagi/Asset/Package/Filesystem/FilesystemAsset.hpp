@@ -13,6 +13,7 @@ public:
     FilesystemAsset(Element *parent, std::string name);
 
     std::unique_ptr<std::istream> open() override;
+    MemoryView map() override;
     std::string path() const override;
     std::string parentPath() const override;
 };
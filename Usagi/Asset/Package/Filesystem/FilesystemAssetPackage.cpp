@@ -2,6 +2,7 @@
 
 #include <Usagi/Runtime/Graphics/Shader/SpirvBinary.hpp>
 #include <Usagi/Asset/Asset.hpp>
+#include <Usagi/Utility/TypeCast.hpp>
 
 #include "FilesystemAsset.hpp"
 
@@ -10,7 +11,7 @@ usagi::Asset * usagi::FilesystemAssetPackage::findByUuid(
 {
     const auto iter = mUuidMap.find(uuid);
     if(iter == mUuidMap.end())
-        throw std::runtime_error("Asset not found.");
+        return nullptr;
     return findByFilesystemPath(iter->second);
 }
 
@@ -42,7 +43,7 @@ usagi::Asset * usagi::FilesystemAssetPackage::findByFilesystemPath(
     // not in cache, create a child and return it if the file exists.
     {
         if(!std::filesystem::exists(mRootPath / normalized))
-            throw std::runtime_error("File not found.");
+            return nullptr;
         return addChild<FilesystemAsset>(normalized.u8string());
     }
 }
@@ -55,8 +56,9 @@ bool usagi::FilesystemAssetPackage::acceptChild(Element *child)
 usagi::FilesystemAssetPackage::FilesystemAssetPackage(
     Element *parent,
     std::string name,
-    std::filesystem::path root_path)
-    : AssetPackage { parent, std::move(name) }
+    std::filesystem::path root_path,
+    const int priority)
+    : AssetPackage { parent, std::move(name), priority }
     , mRootPath { std::move(root_path) }
 {
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <filesystem>
+#include <map>
 
 #include <Usagi/Asset/AssetPackage.hpp>
 
@@ -21,7 +22,8 @@ public:
     FilesystemAssetPackage(
         Element *parent,
         std::string name,
-        std::filesystem::path root_path
+        std::filesystem::path root_path,
+        int priority = 0
     );
 
     Asset * findByUuid(const boost::uuids::uuid &uuid) override;
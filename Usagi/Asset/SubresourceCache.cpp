@@ -0,0 +1,158 @@
+﻿#include "SubresourceCache.hpp"
+
+#include <algorithm>
+
+usagi::SubresourceCache::SubresourceCache(const std::size_t budget)
+    : mBudget { budget }
+{
+}
+
+void usagi::SubresourceCache::retain(Entry &entry, std::shared_ptr<void> res)
+{
+    if(entry.strong) return;
+    entry.strong = std::move(res);
+    mRetainedBytes += entry.size;
+    auto &usage = mTypeUsage[entry.key.type];
+    ++usage.count;
+    usage.bytes += entry.size;
+}
+
+void usagi::SubresourceCache::release(Entry &entry)
+{
+    if(!entry.strong) return;
+    mReleased.push_back(std::move(entry.strong));
+    mRetainedBytes -= entry.size;
+    auto &usage = mTypeUsage[entry.key.type];
+    --usage.count;
+    usage.bytes -= entry.size;
+}
+
+void usagi::SubresourceCache::erase(const std::list<Entry>::iterator entry)
+{
+    release(*entry);
+    mIndex.erase(entry->key);
+    mEntries.erase(entry);
+}
+
+void usagi::SubresourceCache::sweep()
+{
+    for(auto i = mEntries.begin(); i != mEntries.end();)
+    {
+        if(!i->strong && i->weak.expired())
+            erase(i++);
+        else
+            ++i;
+    }
+    mSweepThreshold = std::max(MIN_SWEEP_THRESHOLD, mEntries.size() * 2);
+}
+
+void usagi::SubresourceCache::trim()
+{
+    auto i = mEntries.end();
+    while(mRetainedBytes > mBudget && i != mEntries.begin())
+    {
+        --i;
+        if(!i->strong) continue;
+        release(*i);
+        ++mEvictions;
+        // not used by anyone else
+        if(i->weak.use_count() == 1)
+            erase(i++);
+    }
+    // subresources released earlier leave entries behind when their users
+    // drop them, which are otherwise only removed by looking them up again
+    if(mEntries.size() >= mSweepThreshold)
+        sweep();
+}
+
+std::shared_ptr<void> usagi::SubresourceCache::find(const Key &key)
+{
+    std::vector<std::shared_ptr<void>> released;
+    std::lock_guard<std::mutex> lock(mLock);
+
+    const auto iter = mIndex.find(key);
+    if(iter == mIndex.end())
+    {
+        ++mMisses;
+        return { };
+    }
+    const auto entry = iter->second;
+    auto res = entry->weak.lock();
+    if(!res)
+    {
+        erase(entry);
+        ++mMisses;
+        return { };
+    }
+    ++mHits;
+    mEntries.splice(mEntries.begin(), mEntries, entry);
+    // retain it again if it was released before
+    retain(*entry, res);
+    trim();
+    released.swap(mReleased);
+    return res;
+}
+
+void usagi::SubresourceCache::insert(
+    const Key &key,
+    std::shared_ptr<void> res,
+    const std::size_t size)
+{
+    std::vector<std::shared_ptr<void>> released;
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if(const auto iter = mIndex.find(key); iter != mIndex.end())
+        erase(iter->second);
+    mEntries.push_front({ key, res, nullptr, size });
+    mIndex.emplace(key, mEntries.begin());
+    retain(mEntries.front(), std::move(res));
+    trim();
+    released.swap(mReleased);
+}
+
+std::size_t usagi::SubresourceCache::budget() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mBudget;
+}
+
+void usagi::SubresourceCache::setBudget(const std::size_t budget)
+{
+    std::vector<std::shared_ptr<void>> released;
+    std::lock_guard<std::mutex> lock(mLock);
+    mBudget = budget;
+    trim();
+    released.swap(mReleased);
+}
+
+void usagi::SubresourceCache::clear()
+{
+    // destroy the subresources after releasing the lock
+    std::list<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        entries.swap(mEntries);
+        mIndex.clear();
+        mTypeUsage.clear();
+        mRetainedBytes = 0;
+    }
+}
+
+usagi::SubresourceCacheStats usagi::SubresourceCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    SubresourceCacheStats stats;
+    stats.budget_bytes = mBudget;
+    stats.retained_bytes = mRetainedBytes;
+    stats.entries = mEntries.size();
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+    for(auto &&[type, usage] : mTypeUsage)
+    {
+        if(usage.count == 0) continue;
+        stats.types.push_back({ type.name(), usage.count, usage.bytes });
+    }
+    return stats;
+}
@@ -0,0 +1,186 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <Usagi/Core/Storage/ElementSlotMap.hpp>
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Estimates the memory held by a subresource, which is charged to
+ * the budget of the cache. Specialize it for the subresource types owning
+ * memory beyond the object itself.
+ * \tparam T
+ */
+template <typename T>
+struct SubresourceSize
+{
+    std::size_t operator()(const T &res) const
+    {
+        return sizeof(T);
+    }
+};
+
+struct SubresourceCacheStats
+{
+    struct TypeUsage
+    {
+        std::string type_name;
+        std::size_t retained_count = 0;
+        std::size_t retained_bytes = 0;
+    };
+
+    std::size_t budget_bytes = 0;
+    std::size_t retained_bytes = 0;
+    // including the subresources only kept alive by their users
+    std::size_t entries = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    // subresources released by the cache to stay within the budget
+    std::size_t evictions = 0;
+    std::vector<TypeUsage> types;
+
+    double hitRate() const
+    {
+        const auto lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / lookups : 0;
+    }
+};
+
+/**
+ * \brief Cache of the subresources derived from assets, keyed by the asset,
+ * the subresource type, and a variant distinguishing the subresources of the
+ * same type converted with different options. A subresource is found as long as anyone holds
+ * it. In addition, the cache retains strong references to the recently used
+ * subresources within a memory budget so that they survive short periods
+ * without users, such as re-entering a game state. When the budget is
+ * exceeded, the least recently used subresources are released by the cache
+ * and survive only if they are still referenced elsewhere. Thread-safe.
+ */
+class SubresourceCache : Noncopyable
+{
+public:
+    static constexpr std::size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+    static constexpr std::size_t MIN_SWEEP_THRESHOLD = 64;
+
+private:
+    struct Key
+    {
+        ElementHandle asset;
+        std::type_index type;
+        std::uint64_t variant = 0;
+
+        bool operator==(const Key &other) const
+        {
+            return asset == other.asset && type == other.type &&
+                variant == other.variant;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const
+        {
+            return (std::hash<std::uint64_t>()(key.asset.packed()) * 31 +
+                key.type.hash_code()) * 31 +
+                std::hash<std::uint64_t>()(key.variant);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::weak_ptr<void> weak;
+        // null if released by the cache
+        std::shared_ptr<void> strong;
+        std::size_t size = 0;
+    };
+
+    mutable std::mutex mLock;
+    // ordered from the most recently used to the least
+    std::list<Entry> mEntries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mIndex;
+
+    std::size_t mBudget;
+    std::size_t mRetainedBytes = 0;
+    // entries of expired subresources are swept when the number of entries
+    // reaches this, which doubles the live ones after each sweep.
+    std::size_t mSweepThreshold = MIN_SWEEP_THRESHOLD;
+    std::size_t mHits = 0, mMisses = 0, mEvictions = 0;
+
+    struct TypeUsage
+    {
+        std::size_t count = 0;
+        std::size_t bytes = 0;
+    };
+    std::unordered_map<std::type_index, TypeUsage> mTypeUsage;
+
+    // references released with the lock held, dropped after unlocking in
+    // case the destructors of the subresources use the cache
+    std::vector<std::shared_ptr<void>> mReleased;
+
+    void retain(Entry &entry, std::shared_ptr<void> res);
+    void release(Entry &entry);
+    void erase(std::list<Entry>::iterator entry);
+    void sweep();
+    void trim();
+    std::shared_ptr<void> find(const Key &key);
+    void insert(const Key &key, std::shared_ptr<void> res, std::size_t size);
+
+public:
+    explicit SubresourceCache(std::size_t budget = DEFAULT_BUDGET);
+
+    template <typename SubresourceT>
+    std::shared_ptr<SubresourceT> find(
+        const ElementHandle asset,
+        const std::uint64_t variant = 0)
+    {
+        return std::static_pointer_cast<SubresourceT>(
+            find({ asset, typeid(SubresourceT), variant }));
+    }
+
+    /**
+     * \brief Add the subresource as the most recently used one, replacing
+     * the previous subresource of the same type and variant derived from the
+     * asset.
+     * \tparam SubresourceT
+     * \param asset
+     * \param res
+     * \param variant
+     */
+    template <typename SubresourceT>
+    void insert(
+        const ElementHandle asset,
+        std::shared_ptr<SubresourceT> res,
+        const std::uint64_t variant = 0)
+    {
+        const auto size = SubresourceSize<SubresourceT>()(*res);
+        insert({ asset, typeid(SubresourceT), variant }, std::move(res), size);
+    }
+
+    std::size_t budget() const;
+
+    /**
+     * \brief Release the least recently used subresources until the
+     * retained ones fit in the new budget.
+     * \param budget
+     */
+    void setBudget(std::size_t budget);
+
+    /**
+     * \brief Forget all subresources. Those still in use are not found by
+     * later lookups.
+     */
+    void clear();
+
+    SubresourceCacheStats stats() const;
+};
+}
@@ -8,7 +8,9 @@ namespace usagi
 {
 /**
  * \brief Piece of data of an entity.
- * todo: to maximize the utility of data-oriented design, cache-friendliness and data locality should be considered. the components should be stored linearly. component database & id based entity?
+ * Managed components are stored in ComponentDatabase, where components of
+ * the same type are allocated linearly and elements are grouped by the set
+ * of component types they have.
  */
 class Component : Noncopyable
 {
@@ -1,12 +1,15 @@
 ﻿#include "Element.hpp"
 
 #include <cassert>
+#include <iterator>
 
-#include <Usagi/Utility/DummyDeleter.hpp>
+#include <Usagi/Utility/RAIIHelper.hpp>
 
 #include "Component.hpp"
 #include "Logging.hpp"
+#include "Event/EventQueue.hpp"
 #include "Event/Library/Component/ComponentAddedEvent.hpp"
+#include "Event/Library/Component/ComponentsChangedEvent.hpp"
 #include "Event/Library/Component/PreComponentRemovalEvent.hpp"
 #include "Event/Library/Component/PostComponentRemovalEvent.hpp"
 #include "Event/Library/Element/PreElementRemovalEvent.hpp"
@@ -14,7 +17,10 @@
 
 usagi::Element::Element(Element * const parent, std::string name)
     : mParent(parent)
+    , mArena(parent ? parent->mArena : nullptr)
     , mName(std::move(name))
+    , mHandle(ElementSlotMap::global().insert(this))
+    , mEventQueue(parent ? parent->mEventQueue : nullptr)
 {
     // name should not contain slash
     // todo this may conflict with virtual path containing slashed like the case in asset manager
@@ -35,15 +41,83 @@ usagi::Element::~Element()
 
     // destroy children before self so that events from children are able to
     // bubble up
-    mChildren.clear();
+    clearChildren();
 
-    for(auto i = mComponents.begin(); i != mComponents.end();
-        i = eraseComponent(i))
-    {
-    }
+    if(mEventQueue) mEventQueue->discard(this);
+    eraseAllComponents();
 
     LOG(debug, "Destroying\n"
         "    Element {}: {}", static_cast<void*>(this), path());
+
+    ElementSlotMap::global().erase(mHandle);
+}
+
+void usagi::Element::setName(const std::string &name)
+{
+    // an element under construction is indexed when added to the parent
+    const auto index = mParent && mChildOrder
+        ? mParent->mChildNameIndex.get() : nullptr;
+    if(index) mParent->unindexChild(this);
+    mName = name;
+    if(index) index->insert({ mName, this });
+}
+
+void usagi::Element::indexChild(Element *child)
+{
+    child->mChildOrder = ++mNextChildOrder;
+
+    if(mChildNameIndex)
+    {
+        mChildNameIndex->insert({ child->mName, child });
+    }
+    else if(mChildren.size() > CHILD_NAME_INDEX_THRESHOLD)
+    {
+        mChildNameIndex = std::make_unique<ChildNameIndex>();
+        mChildNameIndex->reserve(mChildren.size() * 2);
+        for(auto &&c : mChildren)
+            mChildNameIndex->insert({ c->mName, c.get() });
+    }
+}
+
+void usagi::Element::unindexChild(Element *child)
+{
+    if(!mChildNameIndex) return;
+    const auto range = mChildNameIndex->equal_range(child->mName);
+    for(auto i = range.first; i != range.second; ++i)
+    {
+        if(i->second == child)
+        {
+            mChildNameIndex->erase(i);
+            return;
+        }
+    }
+}
+
+void usagi::Element::clearChildren()
+{
+    mChildNameIndex.reset();
+    mChildren.clear();
+}
+
+usagi::Element * usagi::Element::findChild(const std::string &name) const
+{
+    if(mChildNameIndex)
+    {
+        // pick the earliest added one if the name is used more than once
+        Element *result = nullptr;
+        const auto range = mChildNameIndex->equal_range(name);
+        for(auto i = range.first; i != range.second; ++i)
+        {
+            if(!result || i->second->mChildOrder < result->mChildOrder)
+                result = i->second;
+        }
+        return result;
+    }
+    const auto iter = std::find_if(
+        mChildren.begin(), mChildren.end(),
+        [&](auto &&c) { return c->mName == name; }
+    );
+    return iter == mChildren.end() ? nullptr : iter->get();
 }
 
 std::string usagi::Element::path() const
@@ -57,6 +131,7 @@ void usagi::Element::removeChildByIter(ChildrenArray::iterator iter)
         throw std::runtime_error("Child element not found.");
     auto p = iter->get();
     p->sendEvent<PreElementRemovalEvent>();
+    unindexChild(p);
     mChildren.erase(iter);
     sendEvent<ChildElementRemovedEvent>();
 }
@@ -64,6 +139,9 @@ void usagi::Element::removeChildByIter(ChildrenArray::iterator iter)
 void usagi::Element::removeChild(Element *child)
 {
     if(child == nullptr) return;
+    if(!hasChild(child))
+        throw std::runtime_error("Child element not found.");
+    // the vector is shifted to keep the order of the remaining children
     const auto iter = std::find_if(
         mChildren.begin(), mChildren.end(),
         [=](auto &&c) { return c.get() == child; }
@@ -73,49 +151,139 @@ void usagi::Element::removeChild(Element *child)
 
 void usagi::Element::removeChild(const std::string &name)
 {
-    const auto iter = std::find_if(
-        mChildren.begin(), mChildren.end(),
-        [&](auto &&c) { return c->name() == name; }
-    );
-    removeChildByIter(iter);
+    const auto child = findChild(name);
+    if(!child)
+        throw std::runtime_error("Child element not found.");
+    removeChild(child);
 }
 
 void usagi::Element::addComponent(Component *component)
 {
-    auto &info = component->baseType();
-    insertComponent(info, { component, DummyDeleter() });
+    insertComponent(component->baseType(), { component, nullptr });
 }
 
 void usagi::Element::insertComponent(const std::type_info &type,
-    std::shared_ptr<Component> component)
+    const ComponentSlot slot)
 {
-    auto p = component.get();
-    const auto r = mComponents.insert({ type, std::move(component) });
-    if(!r.second)
+    const auto p = slot.component;
+    const auto id = componentTypeId(type);
+    if(findComponentById(id))
     {
+        // the component was created for this element so don't leak it
+        if(slot.pool) slot.pool->destroy(p);
         LOG(error, "An element can only have one instance of the same type of component.");
         throw std::runtime_error("Conflicted components.");
     }
+    componentDatabase().insert(this, id, slot);
     LOG(debug, "Adding\n"
         "    Component {}: {} to\n"
         "    Element   {}: {}",
         static_cast<void*>(p), p->baseType().name(),
         static_cast<void*>(this), path());
-    sendEvent<ComponentAddedEvent>(type, p);
+    if(queueingEvents())
+        mEventQueue->post<ComponentsChangedEvent>(
+            this, ComponentMask { }.set(id));
+    else
+        sendEvent<ComponentAddedEvent>(type, id, p);
 }
 
-usagi::Element::ComponentMap::iterator usagi::Element::eraseComponent(
-    ComponentMap::iterator i)
+bool usagi::Element::queueingEvents() const
 {
-    const auto comp = i->second.get();
-    const auto &t = comp->baseType();
+    return mEventQueue && mEventQueue->enabled();
+}
+
+void usagi::Element::eraseAllComponents()
+{
+    if(queueingEvents())
+    {
+        // the element is usually being destroyed and cannot wait for the
+        // queue to be flushed, so notify the change at once.
+        const auto changed = componentMask();
+        if(changed.none()) return;
+        while(mArchetype)
+            removeComponentSilently(mArchetype->types().back());
+        sendEvent<ComponentsChangedEvent>(changed);
+        return;
+    }
+    while(mArchetype)
+    {
+        eraseComponent(mArchetype->types().back());
+    }
+}
+
+void usagi::Element::removeComponentSilently(const ComponentTypeId id)
+{
+    const auto comp = findComponentById(id);
+    if(!comp)
+        throw std::runtime_error("Element has no such component.");
     LOG(debug, "Removing\n"
         "    Component {}: {} from\n"
         "    Element   {}: {}",
         static_cast<void*>(comp), comp->baseType().name(),
         static_cast<void*>(this), path());
-    sendEvent<PreComponentRemovalEvent>(t, comp);
-    i = mComponents.erase(i);
-    sendEvent<PostComponentRemovalEvent>(t);
-    return i;
+    sendEvent<PreComponentRemovalEvent>(comp->baseType(), id, comp);
+    const auto slot = componentDatabase().remove(this, id);
+    if(slot.pool) slot.pool->destroy(slot.component);
+}
+
+void usagi::Element::eraseComponent(const ComponentTypeId id)
+{
+    const auto comp = findComponentById(id);
+    if(!comp)
+        throw std::runtime_error("Element has no such component.");
+    const auto &t = comp->baseType();
+    removeComponentSilently(id);
+    // the component is already destroyed, so the subsystems must forget it
+    // before they are updated again. only the additions are deferred.
+    if(queueingEvents())
+        sendEvent<ComponentsChangedEvent>(ComponentMask { }.set(id));
+    else
+        sendEvent<PostComponentRemovalEvent>(t, id);
+}
+
+void usagi::Element::handleEvent(Event &e, const EventTypeId type)
+{
+    const auto bit = eventTypeBit(type);
+    for(auto element = this; element; element = element->parent())
+    {
+        if(element->mEventTypeFilter & bit)
+            element->invokeEventHandlers(e, type);
+        if(e.canceled() || !e.bubbling())
+            break;
+    }
+}
+
+void usagi::Element::invokeEventHandlers(Event &e, const EventTypeId type)
+{
+    // handlers added by the invoked handlers are deferred so that the
+    // vector is not reallocated while its elements are being called
+    RAIIHelper depth_guard {
+        [&]() { ++mEventHandlingDepth; },
+        [&]() {
+            if(--mEventHandlingDepth == 0 && !mPendingEventHandlers.empty())
+            {
+                std::move(
+                    mPendingEventHandlers.begin(),
+                    mPendingEventHandlers.end(),
+                    std::back_inserter(mEventHandlers)
+                );
+                mPendingEventHandlers.clear();
+            }
+        }
+    };
+    for(auto &&h : mEventHandlers)
+    {
+        if(e.canceled()) break;
+        if(h.type == type)
+            h.handler(e);
+    }
+}
+
+void usagi::Element::insertEventHandler(EventHandlerEntry entry)
+{
+    mEventTypeFilter |= eventTypeBit(entry.type);
+    if(mEventHandlingDepth > 0)
+        mPendingEventHandlers.push_back(std::move(entry));
+    else
+        mEventHandlers.push_back(std::move(entry));
 }
@@ -1,25 +1,29 @@
 ﻿#pragma once
 
 #include <algorithm>
-#include <any>
 #include <cassert>
+#include <cstdint>
 #include <functional>
-#include <map>
 #include <memory>
 #include <type_traits>
-#include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
 #include <Usagi/Utility/Noncopyable.hpp>
 
+#include "Event/EventType.hpp"
 #include "Event/Library/Element/ElementCreatedEvent.hpp"
 #include "Event/Library/Element/ChildElementAddedEvent.hpp"
+#include "Storage/ComponentDatabase.hpp"
+#include "Storage/ElementArena.hpp"
+#include "Storage/ElementSlotMap.hpp"
 
 namespace usagi
 {
 class Event;
+class EventQueue;
 class Component;
 
 /**
@@ -32,51 +36,138 @@ class Component;
  */
 class Element : Noncopyable
 {
+    friend class ComponentDatabase;
+    friend class EventQueue;
+
 protected:
     Element *mParent;
-    using ChildrenArray = std::vector<std::shared_ptr<Element>>;
+
+    /**
+     * \brief Returns a child to the pool it was allocated from.
+     */
+    struct ChildDeleter
+    {
+        ElementPoolBase *pool = nullptr;
+
+        void operator()(Element *child) const
+        {
+            pool->destroy(child);
+        }
+    };
+
+    using ChildrenArray = std::vector<std::unique_ptr<Element, ChildDeleter>>;
     ChildrenArray mChildren;
 
+    /**
+     * \brief The arena children and managed components are allocated from.
+     * Inherited from the parent. nullptr means the global arena.
+     */
+    ElementArena *mArena = nullptr;
+
     std::string mName;
+    ElementHandle mHandle;
 
-    using ComponentMap = std::unordered_map<
-        std::type_index, std::shared_ptr<Component>
-    >;
-    ComponentMap mComponents;
+    /**
+     * \brief Children indexed by name, created when the number of children
+     * exceeds CHILD_NAME_INDEX_THRESHOLD. Below that, a linear scan is
+     * faster. Names are not required to be unique, so the child added
+     * first wins, which is tracked by mChildOrder.
+     */
+    using ChildNameIndex = std::unordered_multimap<std::string, Element *>;
+    std::unique_ptr<ChildNameIndex> mChildNameIndex;
+    std::uint64_t mNextChildOrder = 0;
+    std::uint64_t mChildOrder = 0;
+
+    static constexpr std::size_t CHILD_NAME_INDEX_THRESHOLD = 16;
+
+    void indexChild(Element *child);
+    void unindexChild(Element *child);
+    void clearChildren();
+
+    /**
+     * \brief The archetype holding the components of this element. nullptr
+     * if the element has no component. Maintained by ComponentDatabase.
+     */
+    Archetype *mArchetype = nullptr;
+    std::size_t mArchetypeRow = 0;
+
+    static ComponentDatabase & componentDatabase()
+    {
+        return ComponentDatabase::global();
+    }
+
+    ElementArena & arena() const
+    {
+        return mArena ? *mArena : ElementArena::global();
+    }
 
     void insertComponent(
         const std::type_info &type,
-        std::shared_ptr<Component> component
+        ComponentSlot slot
     );
 
-    template <typename CompBaseT>
-    ComponentMap::iterator getComponentIter(const bool throws = true)
+    Component * findComponentById(const ComponentTypeId id) const
     {
-        auto iter = mComponents.find(typeid(CompBaseT));
-        if(iter == mComponents.end() && throws)
-            throw std::runtime_error("Element has no such component.");
-        return iter;
+        return mArchetype
+            ? mArchetype->component(mArchetypeRow, id)
+            : nullptr;
     }
 
-    ComponentMap::iterator eraseComponent(ComponentMap::iterator i);
-
-    std::multimap<std::type_index, std::any> mEventHandlers;
+    /**
+     * \brief Remove the component without sending the events following
+     * its removal.
+     * \param id
+     */
+    void removeComponentSilently(ComponentTypeId id);
+    void eraseComponent(ComponentTypeId id);
+    void eraseAllComponents();
 
-    template <typename EventT, typename... Args>
-    void handleEvent(EventT &e, const std::type_info &type)
+    template <typename CompBaseT, typename CompCastT>
+    static CompCastT * castComponent(Component *comp)
     {
-        // todo handling polymorphic events?
-        const auto range = mEventHandlers.equal_range(type);
-        for(auto i = range.first; i != range.second && !e.canceled(); ++i)
-        {
-            std::any_cast<EventHandler<EventT>&>(i->second)(e);
-        }
-        if(!e.canceled() && e.bubbling() && parent())
-        {
-            parent()->handleEvent(e, type);
-        }
+        if constexpr(std::is_same_v<CompBaseT, CompCastT>)
+            return static_cast<CompCastT*>(comp);
+        else
+            return dynamic_cast<CompCastT*>(comp);
     }
 
+    struct EventHandlerEntry
+    {
+        EventTypeId type;
+        std::function<void(Event &)> handler;
+    };
+
+    /**
+     * \brief Handlers of all event types in the order of their addition.
+     * Elements usually have very few handlers, so a linear scan is cheaper
+     * than a lookup in a node-based map.
+     */
+    std::vector<EventHandlerEntry> mEventHandlers;
+
+    /**
+     * \brief Handlers added while an event is being handled by this
+     * element. Appended to mEventHandlers after the handling finished.
+     */
+    std::vector<EventHandlerEntry> mPendingEventHandlers;
+    std::uint32_t mEventHandlingDepth = 0;
+
+    /**
+     * \brief Union of eventTypeBit() of the types having handlers, used to
+     * skip elements without handlers of an event type while bubbling.
+     */
+    std::uint64_t mEventTypeFilter = 0;
+
+    /**
+     * \brief Queue used for deferred events. Inherited from the parent.
+     */
+    EventQueue *mEventQueue = nullptr;
+
+    bool queueingEvents() const;
+
+    void handleEvent(Event &e, EventTypeId type);
+    void invokeEventHandlers(Event &e, EventTypeId type);
+    void insertEventHandler(EventHandlerEntry entry);
+
     /**
      * \brief Invoked before adding a child. If false is returned, the addition
      * is aborted and a std::logic_error is thrown by addChild().
@@ -98,8 +189,24 @@ public:
     Element(Element &&other) = delete;
     Element & operator=(Element &&other) = delete;
 
+    /**
+     * \brief Set the queue used by this element for deferred events. The
+     * children created afterwards inherit the queue.
+     * \param queue
+     */
+    void setEventQueue(EventQueue *queue) { mEventQueue = queue; }
+    EventQueue * eventQueue() const { return mEventQueue; }
+
+    /**
+     * \brief Set the arena used to allocate the children and managed
+     * components added afterwards. The children created afterwards inherit
+     * the arena. The arena must outlive all objects allocated from it.
+     * \param arena
+     */
+    void setArena(ElementArena *arena) { mArena = arena; }
+
     std::string name() const { return mName; }
-    void setName(const std::string &name) { mName = name; }
+    void setName(const std::string &name);
     std::string path() const;
 
     // Entity Hierarchy
@@ -112,29 +219,29 @@ public:
         // todo enforce unique child name
         static_assert(std::is_base_of_v<Element, ElementType>,
             "ElementType is not derived from Element.");
-        auto c = std::make_unique<ElementType>(
-            this, std::forward<Args>(args)...
-        );
-        assert(c);
+        auto &pool = arena().template elementPool<ElementType>();
+        const auto r = pool.create(this, std::forward<Args>(args)...);
+        assert(r);
+        // owned from here on so that it is returned to the pool if rejected
+        typename ChildrenArray::value_type c { r, { &pool } };
         // ElementCreatedEvent is fired before acceptance test, so it gets
         // a change to pass the test. (todo: is this a good idea?)
-        c->template sendEvent<ElementCreatedEvent>();
-        if(!acceptChild(c.get()))
+        r->template sendEvent<ElementCreatedEvent>();
+        if(!acceptChild(r))
             throw std::logic_error("Child element was rejected by parent.");
-        const auto r = c.get();
         mChildren.push_back(std::move(c));
+        indexChild(r);
         sendEvent<ChildElementAddedEvent>(r);
         return r;
     }
 
-    Element * findChild(const std::string &name) const
-    {
-        const auto iter = std::find_if(
-            childrenBegin(), childrenEnd(),
-            [&](auto &&c) { return c->name() == name; }
-        );
-        return iter == childrenEnd() ? nullptr : iter->get();
-    }
+    /**
+     * \brief Find the first added child with the name. O(1) on average for
+     * elements with many children.
+     * \param name
+     * \return
+     */
+    Element * findChild(const std::string &name) const;
 
     Element * childByName(const std::string &name) const
     {
@@ -153,9 +260,7 @@ public:
     bool hasChild(ChildT *e) const
     {
         static_assert(std::is_base_of_v<Element, ChildT>);
-        return std::any_of(mChildren.begin(), mChildren.end(), [e](auto &&c) {
-            return c.get() == static_cast<Element*>(e);
-        });
+        return e && static_cast<Element*>(e)->mParent == this;
     }
 
     std::size_t childrenCount() const
@@ -166,6 +271,25 @@ public:
     void removeChild(Element *child);
     void removeChild(const std::string &name);
 
+    // Handle
+
+    /**
+     * \brief The handle of the element, valid until the element is
+     * destroyed.
+     * \return
+     */
+    ElementHandle handle() const { return mHandle; }
+
+    /**
+     * \brief Resolve a handle.
+     * \param handle
+     * \return nullptr if the element was destroyed.
+     */
+    static Element * fromHandle(const ElementHandle handle)
+    {
+        return ElementSlotMap::global().resolve(handle);
+    }
+
     // Component
 
     /**
@@ -179,9 +303,9 @@ public:
     template <typename CompT, typename... Args>
     CompT * addComponent(Args &&... args)
     {
-        auto comp = std::make_shared<CompT>(std::forward<Args>(args)...);
-        const auto r = comp.get();
-        insertComponent(r->baseType(), std::move(comp));
+        auto &pool = arena().template componentPool<CompT>();
+        const auto r = pool.create(std::forward<Args>(args)...);
+        insertComponent(r->baseType(), { r, &pool });
         return r;
     }
 
@@ -195,37 +319,38 @@ public:
     template <typename CompBaseT, typename CompCastT = CompBaseT>
     CompCastT * getComponent()
     {
-        const auto iter = getComponentIter<CompBaseT>();
-        if constexpr(std::is_same_v<CompBaseT, CompCastT>)
-            return static_cast<CompCastT*>(iter->second.get());
-        else
-            return dynamic_cast<CompCastT*>(iter->second.get());
+        const auto comp = findComponentById(componentTypeId<CompBaseT>());
+        if(!comp)
+            throw std::runtime_error("Element has no such component.");
+        return castComponent<CompBaseT, CompCastT>(comp);
     }
 
     template <typename CompBaseT, typename CompCastT = CompBaseT>
     CompCastT * findComponent()
     {
-        const auto iter = mComponents.find(typeid(CompBaseT));
-        if(iter == mComponents.end())
-            return nullptr;
-        if constexpr(std::is_same_v<CompBaseT, CompCastT>)
-            return static_cast<CompCastT*>(iter->second.get());
-        else
-            return dynamic_cast<CompCastT*>(iter->second.get());
+        return castComponent<CompBaseT, CompCastT>(
+            findComponentById(componentTypeId<CompBaseT>()));
     }
 
-
     template <typename CompT>
     bool hasComponent()
     {
-        // todo: c++20, use contains()
-        return mComponents.find(typeid(CompT)) != mComponents.end();
+        return mArchetype && mArchetype->has(componentTypeId<CompT>());
+    }
+
+    /**
+     * \brief The set of component types attached to this element.
+     * \return
+     */
+    ComponentMask componentMask() const
+    {
+        return mArchetype ? mArchetype->mask() : ComponentMask { };
     }
 
     template <typename CompBaseT>
     void removeComponent()
     {
-        eraseComponent(getComponentIter<CompBaseT>());
+        eraseComponent(componentTypeId<CompBaseT>());
     }
 
     // Event Handling
@@ -238,13 +363,27 @@ public:
     {
         EventT event { std::forward<Args>(args)... };
         event.setSource(this);
-        handleEvent(event, typeid(event));
+        handleEvent(event, eventTypeId<EventT>());
     }
 
-    template <typename EventBaseT>
-    void addEventListener(EventHandler<EventBaseT> handler)
+    /**
+     * \brief Add a handler of the events of exactly the type EventT sent
+     * by this element or its descendants.
+     * \tparam EventT
+     * \tparam Handler void(EventT &), or taking a base of EventT.
+     * \param handler
+     */
+    template <typename EventT, typename Handler>
+    void addEventListener(Handler handler)
     {
-        mEventHandlers.insert({ typeid(EventBaseT), std::move(handler) });
+        static_assert(std::is_base_of_v<Event, EventT>);
+        static_assert(std::is_invocable_v<Handler &, EventT &>);
+        insertEventHandler({
+            eventTypeId<EventT>(),
+            [handler = std::move(handler)](Event &e) mutable {
+                handler(static_cast<EventT &>(e));
+            }
+        });
     }
 
     template <typename ElementT>
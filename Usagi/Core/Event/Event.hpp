@@ -29,6 +29,7 @@ class Event : Noncopyable
     bool mCanceled : 1;
 
     friend class Element;
+    friend class EventQueue;
 
     void setSource(Element *source) { mSource = source; }
 
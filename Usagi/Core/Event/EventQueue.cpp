@@ -0,0 +1,116 @@
+﻿#include "EventQueue.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <Usagi/Core/Element.hpp>
+#include <Usagi/Utility/Rounding.hpp>
+
+usagi::EventQueue::~EventQueue()
+{
+    for(auto &&r : mRecords)
+        r->event->~Event();
+}
+
+void * usagi::EventQueue::allocate(
+    const std::size_t size,
+    const std::size_t alignment)
+{
+    while(true)
+    {
+        if(mCurrentBlock < mBlocks.size())
+        {
+            auto &block = mBlocks[mCurrentBlock];
+            const auto offset = utility::roundUpUnsigned(
+                mBlockOffset, alignment);
+            if(offset + size <= block.size)
+            {
+                mBlockOffset = offset + size;
+                return block.memory.get() + offset;
+            }
+            ++mCurrentBlock;
+            mBlockOffset = 0;
+            continue;
+        }
+        // the blocks are allocated with operator new[], which aligns to
+        // the fundamental alignment
+        assert(alignment <= alignof(std::max_align_t));
+        const auto block_size = std::max(size, BLOCK_SIZE);
+        mBlocks.push_back({
+            std::make_unique<std::byte[]>(block_size), block_size
+        });
+        mCurrentBlock = mBlocks.size() - 1;
+        mBlockOffset = 0;
+    }
+}
+
+void usagi::EventQueue::resetArena()
+{
+    // release the blocks for oversized events, keep the others for reuse
+    mBlocks.erase(std::remove_if(mBlocks.begin(), mBlocks.end(),
+        [](auto &&b) { return b.size != BLOCK_SIZE; }), mBlocks.end());
+    mCurrentBlock = 0;
+    mBlockOffset = 0;
+}
+
+usagi::EventQueue::Record * usagi::EventQueue::findQueued(
+    Element *source,
+    const EventTypeId type) const
+{
+    const auto iter = mSourceRecords.find(source);
+    if(iter == mSourceRecords.end())
+        return nullptr;
+    for(auto r = iter->second; r; r = r->next_of_source)
+    {
+        if(r->type == type && !r->dispatched)
+            return r;
+    }
+    return nullptr;
+}
+
+void usagi::EventQueue::pushRecord(
+    Element *source,
+    const EventTypeId type,
+    Event *event)
+{
+    const auto record = new (allocate(sizeof(Record), alignof(Record)))
+        Record { source, type, event, false, nullptr };
+    auto &head = mSourceRecords[source];
+    record->next_of_source = head;
+    head = record;
+    mRecords.push_back(record);
+}
+
+void usagi::EventQueue::discard(Element *source)
+{
+    const auto iter = mSourceRecords.find(source);
+    if(iter == mSourceRecords.end())
+        return;
+    for(auto r = iter->second; r; r = r->next_of_source)
+        r->source = nullptr;
+    mSourceRecords.erase(iter);
+}
+
+void usagi::EventQueue::flush()
+{
+    assert(!mFlushing);
+    mFlushing = true;
+
+    // the handlers may post more events, which are appended to the records
+    for(std::size_t i = 0; i < mRecords.size(); ++i)
+    {
+        const auto r = mRecords[i];
+        r->dispatched = true;
+        if(r->source == nullptr) continue;
+        r->event->setSource(r->source);
+        r->source->handleEvent(*r->event, r->type);
+    }
+
+    for(auto &&r : mRecords)
+        r->event->~Event();
+    mRecords.clear();
+    mSourceRecords.clear();
+    resetArena();
+
+    mFlushing = false;
+}
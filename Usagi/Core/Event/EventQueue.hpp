@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "Event.hpp"
+#include "EventType.hpp"
+
+namespace usagi
+{
+class Element;
+
+template <typename EventT, typename = void>
+struct IsMergeableEvent : std::false_type
+{
+};
+
+template <typename EventT>
+struct IsMergeableEvent<EventT, std::void_t<decltype(
+    std::declval<EventT &>().merge(std::declval<const EventT &>())
+)>> : std::true_type
+{
+};
+
+/**
+ * \brief Records events to be sent later in a batch. The events are
+ * constructed in an arena which is reset after each flush, so queueing
+ * an event does not allocate once the arena has grown to the size of the
+ * busiest frame.
+ *
+ * Event types providing a method void merge(const EventT &later) are
+ * coalesced: an event posted while another event of the same type from
+ * the same source is still queued is merged into the queued one instead
+ * of being queued separately.
+ *
+ * Queueing is disabled by default. Elements check enabled() to decide
+ * whether to post events that support deferral or send them immediately.
+ * Not thread-safe, only used on the main thread.
+ */
+class EventQueue : Noncopyable
+{
+    struct Record
+    {
+        // null if the source was destroyed before the flush
+        Element *source;
+        EventTypeId type;
+        Event *event;
+        bool dispatched;
+        // the next record of the same source
+        Record *next_of_source;
+    };
+
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> memory;
+        std::size_t size;
+    };
+
+    std::vector<Block> mBlocks;
+    std::size_t mCurrentBlock = 0;
+    std::size_t mBlockOffset = 0;
+
+    std::vector<Record *> mRecords;
+    std::unordered_map<Element *, Record *> mSourceRecords;
+
+    bool mEnabled = false;
+    bool mFlushing = false;
+
+    void * allocate(std::size_t size, std::size_t alignment);
+    void resetArena();
+    Record * findQueued(Element *source, EventTypeId type) const;
+    void pushRecord(Element *source, EventTypeId type, Event *event);
+
+public:
+    EventQueue() = default;
+    ~EventQueue();
+
+    bool enabled() const { return mEnabled; }
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+
+    bool empty() const { return mRecords.empty(); }
+    std::size_t size() const { return mRecords.size(); }
+
+    /**
+     * \brief Queue an event to be sent by the source element when the
+     * queue is flushed.
+     * \tparam EventT
+     * \tparam Args
+     * \param source
+     * \param args
+     */
+    template <typename EventT, typename... Args>
+    void post(Element *source, Args &&... args)
+    {
+        static_assert(std::is_base_of_v<Event, EventT>);
+
+        const auto type = eventTypeId<EventT>();
+        if constexpr(IsMergeableEvent<EventT>::value)
+        {
+            if(const auto r = findQueued(source, type))
+            {
+                static_cast<EventT *>(r->event)->merge(
+                    EventT { std::forward<Args>(args)... });
+                return;
+            }
+        }
+        const auto event = new (allocate(sizeof(EventT), alignof(EventT)))
+            EventT { std::forward<Args>(args)... };
+        pushRecord(source, type, event);
+    }
+
+    /**
+     * \brief Drop the queued events of the element. Called when the element
+     * is destroyed.
+     * \param source
+     */
+    void discard(Element *source);
+
+    /**
+     * \brief Send all queued events by the order of their first posting.
+     * Events posted by the handlers during the flush are also sent.
+     */
+    void flush();
+};
+}
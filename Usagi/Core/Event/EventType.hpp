@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace usagi
+{
+template <typename EventT>
+struct EventTypeTag
+{
+    // not const, so that identical code folding of the linker cannot merge
+    // the tags of different types into one address.
+    inline static char tag = 0;
+};
+
+/**
+ * \brief Identifier of an event type, which is the address of a variable
+ * instantiated for that type. Available at compile time and compared
+ * without RTTI.
+ */
+using EventTypeId = const void *;
+
+template <typename EventT>
+constexpr EventTypeId eventTypeId()
+{
+    return &EventTypeTag<EventT>::tag;
+}
+
+/**
+ * \brief Map the event type to one bit of a 64-bit filter. Different types
+ * may share the same bit, so a set bit only means that handlers of the
+ * type may exist.
+ * \param id
+ * \return
+ */
+inline std::uint64_t eventTypeBit(const EventTypeId id)
+{
+    // Fibonacci hashing, the top 6 bits select the bit
+    const auto h = static_cast<std::uint64_t>(
+        reinterpret_cast<std::uintptr_t>(id)) * 0x9E3779B97F4A7C15ull;
+    return std::uint64_t { 1 } << (h >> 58);
+}
+}
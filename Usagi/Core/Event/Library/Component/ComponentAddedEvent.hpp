@@ -7,8 +7,11 @@ namespace usagi
 class ComponentAddedEvent : public ComponentEvent
 {
 public:
-    ComponentAddedEvent(const std::type_info &type, Component *component)
-        : ComponentEvent { type, component }
+    ComponentAddedEvent(
+        const std::type_info &type,
+        const ComponentTypeId type_id,
+        Component *component)
+        : ComponentEvent { type, type_id, component }
     {
     }
 };
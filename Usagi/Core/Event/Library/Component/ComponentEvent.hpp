@@ -3,6 +3,7 @@
 #include <typeinfo>
 
 #include <Usagi/Core/Event/Event.hpp>
+#include <Usagi/Core/Storage/ComponentType.hpp>
 
 namespace usagi
 {
@@ -11,13 +12,18 @@ class Component;
 class ComponentEvent : public Event
 {
 public:
-    ComponentEvent(const std::type_info &type, Component *component)
+    ComponentEvent(
+        const std::type_info &type,
+        const ComponentTypeId type_id,
+        Component *component)
         : type { type }
+        , type_id { type_id }
         , component { component }
     {
     }
 
     const std::type_info &type;
+    const ComponentTypeId type_id;
     Component *const component;
 };
 }
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <Usagi/Core/Event/Event.hpp>
+#include <Usagi/Core/Storage/ComponentType.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Sent instead of ComponentAddedEvent and PostComponentRemovalEvent
+ * when event queueing is enabled. All the components added to an element
+ * within a frame are merged into one queued event. Removals are sent at
+ * once since the removed components are destroyed immediately and must not
+ * be kept by the subsystems until the queue is flushed.
+ */
+class ComponentsChangedEvent : public Event
+{
+public:
+    explicit ComponentsChangedEvent(const ComponentMask changed)
+        : changed { changed }
+    {
+    }
+
+    void merge(const ComponentsChangedEvent &later)
+    {
+        changed |= later.changed;
+    }
+
+    /**
+     * \brief The types of the components added or removed.
+     */
+    ComponentMask changed;
+};
+}
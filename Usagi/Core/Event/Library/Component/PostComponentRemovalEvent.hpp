@@ -7,8 +7,10 @@ namespace usagi
 class PostComponentRemovalEvent : public ComponentEvent
 {
 public:
-    explicit PostComponentRemovalEvent(const std::type_info &type)
-        : ComponentEvent { type, nullptr }
+    PostComponentRemovalEvent(
+        const std::type_info &type,
+        const ComponentTypeId type_id)
+        : ComponentEvent { type, type_id, nullptr }
     {
     }
 };
@@ -0,0 +1,217 @@
+﻿#include "JobSystem.hpp"
+
+#include <cassert>
+
+#include <Usagi/Core/Logging.hpp>
+
+namespace
+{
+// set for threads owned by a job system, including the main thread
+thread_local const usagi::JobSystem *gCurrentJobSystem = nullptr;
+thread_local std::size_t gCurrentDequeIndex = 0;
+}
+
+usagi::JobSystem::JobSystem(const std::size_t num_workers)
+{
+    mDeques.reserve(num_workers + 1);
+    for(std::size_t i = 0; i < num_workers + 1; ++i)
+        mDeques.push_back(std::make_unique<WorkStealingDeque<JobEntry>>());
+
+    gCurrentJobSystem = this;
+    gCurrentDequeIndex = 0;
+
+    LOG(info, "Starting job system with {} workers", num_workers);
+    mWorkers.reserve(num_workers);
+    for(std::size_t i = 1; i <= num_workers; ++i)
+        mWorkers.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+usagi::JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepLock);
+        mExit = true;
+    }
+    mWakeCondition.notify_all();
+    for(auto &&w : mWorkers)
+        w.join();
+
+    // discard the jobs never executed
+    for(auto &&d : mDeques)
+        while(const auto e = d->pop()) delete e;
+    for(auto &&e : mSharedJobs) delete e;
+    for(auto &&e : mMainThreadJobs) delete e;
+
+    if(gCurrentJobSystem == this)
+        gCurrentJobSystem = nullptr;
+}
+
+std::size_t usagi::JobSystem::defaultWorkerCount()
+{
+    const auto cores = std::thread::hardware_concurrency();
+    // leave one core for the main thread
+    return cores > 1 ? cores - 1 : 0;
+}
+
+std::size_t usagi::JobSystem::currentThreadIndex() const
+{
+    return gCurrentJobSystem == this ? gCurrentDequeIndex : EXTERNAL_THREAD;
+}
+
+void usagi::JobSystem::submit(Job job, JobCounter *counter)
+{
+    assert(job);
+
+    if(counter) counter->mCount.fetch_add(1, std::memory_order_relaxed);
+    enqueue(new JobEntry { std::move(job), counter });
+}
+
+void usagi::JobSystem::submitMainThread(Job job, JobCounter *counter)
+{
+    assert(job);
+
+    if(counter) counter->mCount.fetch_add(1, std::memory_order_relaxed);
+    const auto entry = new JobEntry { std::move(job), counter };
+    std::lock_guard<std::mutex> lock(mMainThreadLock);
+    mMainThreadJobs.push_back(entry);
+    ++mMainThreadCount;
+}
+
+void usagi::JobSystem::enqueue(JobEntry *entry)
+{
+    const auto index = currentThreadIndex();
+    if(index == EXTERNAL_THREAD)
+    {
+        std::lock_guard<std::mutex> lock(mSharedLock);
+        mSharedJobs.push_back(entry);
+        ++mSharedCount;
+    }
+    else
+    {
+        mDeques[index]->push(entry);
+    }
+    ++mPendingJobs;
+    wakeWorker();
+}
+
+void usagi::JobSystem::wakeWorker()
+{
+    // a worker increments the sleeping count before checking the pending
+    // count with the lock held, so either it sees the new job or we see it
+    // sleeping and notify it after it started waiting.
+    if(mSleepingWorkers > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepLock);
+        }
+        mWakeCondition.notify_one();
+    }
+}
+
+usagi::JobSystem::JobEntry * usagi::JobSystem::popShared(
+    std::mutex &lock,
+    std::deque<JobEntry *> &queue,
+    std::atomic<std::size_t> &count)
+{
+    // avoid taking the lock in the common case of an empty queue
+    if(count == 0) return nullptr;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if(queue.empty()) return nullptr;
+    const auto entry = queue.front();
+    queue.pop_front();
+    --count;
+    return entry;
+}
+
+usagi::JobSystem::JobEntry * usagi::JobSystem::steal(
+    const std::size_t thief_index)
+{
+    // start from the next deque to spread the thieves
+    const auto start = thief_index == EXTERNAL_THREAD ? 0 : thief_index + 1;
+    for(std::size_t i = 0; i < mDeques.size(); ++i)
+    {
+        const auto victim = (start + i) % mDeques.size();
+        if(victim == thief_index) continue;
+        if(const auto entry = mDeques[victim]->steal())
+            return entry;
+    }
+    return nullptr;
+}
+
+usagi::JobSystem::JobEntry * usagi::JobSystem::fetch(
+    const std::size_t deque_index)
+{
+    JobEntry *entry = nullptr;
+    if(deque_index != EXTERNAL_THREAD)
+        entry = mDeques[deque_index]->pop();
+    if(!entry)
+        entry = popShared(mSharedLock, mSharedJobs, mSharedCount);
+    if(!entry)
+        entry = steal(deque_index);
+    if(entry)
+        --mPendingJobs;
+    return entry;
+}
+
+void usagi::JobSystem::execute(JobEntry *entry)
+{
+    entry->job();
+    if(entry->counter)
+        entry->counter->mCount.fetch_sub(1, std::memory_order_release);
+    delete entry;
+}
+
+void usagi::JobSystem::workerMain(const std::size_t deque_index)
+{
+    gCurrentJobSystem = this;
+    gCurrentDequeIndex = deque_index;
+
+    while(true)
+    {
+        if(const auto entry = fetch(deque_index))
+        {
+            execute(entry);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepLock);
+        ++mSleepingWorkers;
+        mWakeCondition.wait(lock, [&]() {
+            return mPendingJobs > 0 || mExit;
+        });
+        --mSleepingWorkers;
+        if(mExit) break;
+    }
+}
+
+void usagi::JobSystem::runMainThreadJobs()
+{
+    assert(isMainThread());
+
+    while(const auto entry = popShared(
+        mMainThreadLock, mMainThreadJobs, mMainThreadCount))
+        execute(entry);
+}
+
+void usagi::JobSystem::waitUntil(const std::function<bool()> &done)
+{
+    const auto deque_index = currentThreadIndex();
+    while(!done())
+    {
+        JobEntry *entry = nullptr;
+        if(deque_index == 0)
+            entry = popShared(mMainThreadLock, mMainThreadJobs,
+                mMainThreadCount);
+        if(!entry)
+            entry = fetch(deque_index);
+        if(entry)
+        {
+            execute(entry);
+        }
+        else
+        {
+            // the remaining jobs are being executed by other threads
+            std::this_thread::yield();
+        }
+    }
+}
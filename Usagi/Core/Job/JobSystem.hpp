@@ -0,0 +1,216 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "WorkStealingDeque.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Counts unfinished jobs submitted with it. Serves as a fence that
+ * is signaled when all the jobs finished. A job can submit more jobs with
+ * the same counter, the counter will not reach zero before they finish.
+ */
+class JobCounter : Noncopyable
+{
+    friend class JobSystem;
+
+    std::atomic<std::size_t> mCount = 0;
+
+public:
+    bool done() const
+    {
+        return mCount.load(std::memory_order_acquire) == 0;
+    }
+};
+
+/**
+ * \brief A pool of worker threads executing short jobs. Each thread has its
+ * own lock-free job deque. A thread pushes and pops jobs at the bottom of
+ * its own deque and steals from the top of the deques of other threads when
+ * it runs out of work.
+ *
+ * The thread creating the job system is regarded as the main thread. It
+ * also owns a deque, but only executes jobs when it waits for them. Jobs
+ * submitted from threads not owned by the job system go to a shared queue.
+ * Jobs that must run on the main thread, such as those using the windowing
+ * system, can be submitted with submitMainThread().
+ *
+ * Jobs must not throw. Use parallelFor() or capture the exception
+ * explicitly if the work may fail.
+ */
+class JobSystem : Noncopyable
+{
+public:
+    using Job = std::function<void()>;
+
+private:
+    struct JobEntry
+    {
+        Job job;
+        JobCounter *counter = nullptr;
+    };
+
+    // index 0 belongs to the main thread, the rest to the workers
+    std::vector<std::unique_ptr<WorkStealingDeque<JobEntry>>> mDeques;
+    std::vector<std::thread> mWorkers;
+
+    // jobs from threads without a deque
+    std::mutex mSharedLock;
+    std::deque<JobEntry *> mSharedJobs;
+    std::atomic<std::size_t> mSharedCount = 0;
+
+    std::mutex mMainThreadLock;
+    std::deque<JobEntry *> mMainThreadJobs;
+    std::atomic<std::size_t> mMainThreadCount = 0;
+
+    // jobs that can be executed by the workers
+    std::atomic<std::size_t> mPendingJobs = 0;
+    std::atomic<std::size_t> mSleepingWorkers = 0;
+    std::atomic<bool> mExit = false;
+    std::mutex mSleepLock;
+    std::condition_variable mWakeCondition;
+
+    void enqueue(JobEntry *entry);
+    void wakeWorker();
+    JobEntry * popShared(std::mutex &lock, std::deque<JobEntry *> &queue,
+        std::atomic<std::size_t> &count);
+    JobEntry * steal(std::size_t thief_index);
+    JobEntry * fetch(std::size_t deque_index);
+    static void execute(JobEntry *entry);
+    void workerMain(std::size_t deque_index);
+
+public:
+    static constexpr std::size_t EXTERNAL_THREAD = static_cast<std::size_t>(-1);
+
+    /**
+     * \brief
+     * \param num_workers Number of worker threads. Can be zero, in which
+     * case all jobs are executed on the main thread while it is waiting.
+     */
+    explicit JobSystem(std::size_t num_workers = defaultWorkerCount());
+    ~JobSystem();
+
+    static std::size_t defaultWorkerCount();
+
+    std::size_t workerCount() const { return mWorkers.size(); }
+
+    /**
+     * \brief Number of threads owned by the job system, including the main
+     * thread.
+     * \return
+     */
+    std::size_t threadCount() const { return mWorkers.size() + 1; }
+
+    /**
+     * \brief Index of the calling thread. The main thread has index 0 and
+     * the workers are numbered from 1 to workerCount(). Other threads get
+     * EXTERNAL_THREAD. Can be used to index per-thread resources.
+     * \return
+     */
+    std::size_t currentThreadIndex() const;
+
+    bool isMainThread() const { return currentThreadIndex() == 0; }
+
+    /**
+     * \brief Submit a job to be executed by any thread.
+     * \param job
+     * \param counter If not null, incremented before the submission and
+     * decremented after the job finished.
+     */
+    void submit(Job job, JobCounter *counter = nullptr);
+
+    /**
+     * \brief Submit a job to be executed by the main thread when it waits
+     * or calls runMainThreadJobs().
+     * \param job
+     * \param counter
+     */
+    void submitMainThread(Job job, JobCounter *counter = nullptr);
+
+    /**
+     * \brief Execute all jobs currently queued for the main thread. Must
+     * be called by the main thread.
+     */
+    void runMainThreadJobs();
+
+    /**
+     * \brief Execute jobs on the calling thread until the predicate is
+     * satisfied. The predicate is checked between jobs, so it should be
+     * cheap.
+     * \param done
+     */
+    void waitUntil(const std::function<bool()> &done);
+
+    /**
+     * \brief Execute jobs on the calling thread until all jobs submitted
+     * with the counter finished.
+     * \param counter
+     */
+    void wait(const JobCounter &counter)
+    {
+        waitUntil([&]() { return counter.done(); });
+    }
+
+    /**
+     * \brief Invoke the function on subranges of [begin, end) in parallel
+     * and wait for them. The range is recursively split in halves until the
+     * subranges are not larger than the grain size, the calling thread
+     * taking part in the execution. If any invocation throws, the first
+     * exception is rethrown after all invocations finished.
+     * \tparam Func void(std::size_t begin, std::size_t end)
+     * \param begin
+     * \param end
+     * \param grain_size
+     * \param func
+     */
+    template <typename Func>
+    void parallelFor(
+        std::size_t begin,
+        std::size_t end,
+        std::size_t grain_size,
+        Func func)
+    {
+        if(begin >= end) return;
+        if(grain_size == 0) grain_size = 1;
+
+        JobCounter counter;
+        std::exception_ptr exception;
+        std::mutex exception_lock;
+        std::function<void(std::size_t, std::size_t)> split =
+            [&](std::size_t b, std::size_t e) {
+            // fork the upper halves and continue with the lower one
+            while(e - b > grain_size)
+            {
+                const auto m = b + (e - b) / 2;
+                submit([&split, m, e]() { split(m, e); }, &counter);
+                e = m;
+            }
+            try
+            {
+                func(b, e);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(exception_lock);
+                if(!exception) exception = std::current_exception();
+            }
+        };
+        split(begin, end);
+        wait(counter);
+
+        if(exception)
+            std::rethrow_exception(exception);
+    }
+};
+}
@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Lock-free work-stealing deque (Chase & Lev, with the memory orders
+ * from Le et al.). The owner thread pushes and pops at the bottom, while
+ * any other thread can steal from the top. The ring buffer grows when full.
+ * Retired buffers are kept until the deque is destroyed because thieves
+ * may still be reading them.
+ * \tparam T Element type, stored by pointer.
+ */
+template <typename T>
+class WorkStealingDeque : Noncopyable
+{
+    struct Buffer
+    {
+        const std::int64_t capacity;
+        const std::unique_ptr<std::atomic<T *>[]> items;
+
+        explicit Buffer(const std::int64_t capacity)
+            : capacity(capacity)
+            , items(std::make_unique<std::atomic<T *>[]>(capacity))
+        {
+            // capacity must be a power of two for the index masks
+            assert((capacity & (capacity - 1)) == 0);
+        }
+
+        T * get(const std::int64_t i) const
+        {
+            return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(const std::int64_t i, T *item)
+        {
+            items[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<std::int64_t> mTop = 0;
+    std::atomic<std::int64_t> mBottom = 0;
+    std::atomic<Buffer *> mBuffer;
+    // only accessed by the owner
+    std::vector<std::unique_ptr<Buffer>> mBuffers;
+
+    Buffer * grow(Buffer *old, const std::int64_t top, const std::int64_t bottom)
+    {
+        auto buffer = std::make_unique<Buffer>(old->capacity * 2);
+        for(auto i = top; i < bottom; ++i)
+            buffer->put(i, old->get(i));
+        const auto ptr = buffer.get();
+        mBuffers.push_back(std::move(buffer));
+        mBuffer.store(ptr, std::memory_order_release);
+        return ptr;
+    }
+
+public:
+    explicit WorkStealingDeque(const std::int64_t capacity = 256)
+    {
+        mBuffers.push_back(std::make_unique<Buffer>(capacity));
+        mBuffer.store(mBuffers.back().get(), std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Approximated size, for heuristics only.
+     * \return
+     */
+    std::size_t sizeApprox() const
+    {
+        const auto b = mBottom.load(std::memory_order_relaxed);
+        const auto t = mTop.load(std::memory_order_relaxed);
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    /**
+     * \brief Only called by the owner.
+     * \param item
+     */
+    void push(T *item)
+    {
+        const auto b = mBottom.load(std::memory_order_relaxed);
+        const auto t = mTop.load(std::memory_order_acquire);
+        auto buffer = mBuffer.load(std::memory_order_relaxed);
+        if(b - t > buffer->capacity - 1)
+            buffer = grow(buffer, t, b);
+        buffer->put(b, item);
+        // publish the item to the thieves
+        mBottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * \brief Only called by the owner.
+     * \return The last pushed item, or nullptr if the deque is empty.
+     */
+    T * pop()
+    {
+        const auto b = mBottom.load(std::memory_order_relaxed) - 1;
+        const auto buffer = mBuffer.load(std::memory_order_relaxed);
+        mBottom.store(b, std::memory_order_seq_cst);
+        auto t = mTop.load(std::memory_order_seq_cst);
+        if(t > b)
+        {
+            // empty
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto item = buffer->get(b);
+        if(t == b)
+        {
+            // the last item, race against thieves
+            if(!mTop.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            mBottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /**
+     * \brief Can be called by any thread.
+     * \return The first pushed item, or nullptr if the deque is empty or
+     * the steal lost a race.
+     */
+    T * steal()
+    {
+        auto t = mTop.load(std::memory_order_seq_cst);
+        const auto b = mBottom.load(std::memory_order_seq_cst);
+        if(t >= b)
+            return nullptr;
+        const auto buffer = mBuffer.load(std::memory_order_acquire);
+        const auto item = buffer->get(t);
+        if(!mTop.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+};
+}
@@ -0,0 +1,42 @@
+﻿#include "Archetype.hpp"
+
+usagi::Archetype::Archetype(const ComponentMask &mask)
+    : mMask(mask)
+{
+    mColumnIndices.fill(NO_COLUMN);
+    for(std::size_t i = 0; i < MAX_COMPONENT_TYPES; ++i)
+    {
+        if(!mask.test(i)) continue;
+        mColumnIndices[i] = static_cast<std::uint8_t>(mTypes.size());
+        mTypes.push_back(static_cast<ComponentTypeId>(i));
+    }
+    mColumns.resize(mTypes.size());
+}
+
+std::size_t usagi::Archetype::pushRow(Element *element)
+{
+    const auto row = mElements.size();
+    mElements.push_back(element);
+    for(auto &&c : mColumns)
+        c.emplace_back();
+    return row;
+}
+
+usagi::Element * usagi::Archetype::swapRemoveRow(const std::size_t row)
+{
+    assert(row < size());
+
+    const auto last = mElements.size() - 1;
+    Element *moved = nullptr;
+    if(row != last)
+    {
+        moved = mElements[last];
+        mElements[row] = moved;
+        for(auto &&c : mColumns)
+            c[row] = c[last];
+    }
+    mElements.pop_back();
+    for(auto &&c : mColumns)
+        c.pop_back();
+    return moved;
+}
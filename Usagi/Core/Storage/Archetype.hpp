@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <array>
+#include <cassert>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "ComponentPool.hpp"
+#include "ComponentType.hpp"
+
+namespace usagi
+{
+class Element;
+class Component;
+
+struct ComponentSlot
+{
+    Component *component = nullptr;
+    /**
+     * \brief The pool owning the component. nullptr if the component is
+     * unmanaged.
+     */
+    ComponentPoolBase *pool = nullptr;
+};
+
+/**
+ * \brief A table of all elements sharing exactly the same set of component
+ * types. Each component type has its own column, so iterating over one type
+ * of component in an archetype walks a contiguous array instead of chasing
+ * per-element maps.
+ */
+class Archetype : Noncopyable
+{
+    friend class ComponentDatabase;
+
+    static constexpr std::uint8_t NO_COLUMN = 0xFF;
+
+    const ComponentMask mMask;
+    std::vector<ComponentTypeId> mTypes;
+    std::array<std::uint8_t, MAX_COMPONENT_TYPES> mColumnIndices;
+    std::vector<Element *> mElements;
+    std::vector<std::vector<ComponentSlot>> mColumns;
+
+    // cached archetype transitions when a type is added or removed
+    std::array<Archetype *, MAX_COMPONENT_TYPES> mAddEdges { };
+    std::array<Archetype *, MAX_COMPONENT_TYPES> mRemoveEdges { };
+
+    std::size_t pushRow(Element *element);
+
+    /**
+     * \brief Remove a row by moving the last row into its place.
+     * \param row
+     * \return The element moved into the erased row, or nullptr if the
+     * erased row was the last one.
+     */
+    Element * swapRemoveRow(std::size_t row);
+
+public:
+    explicit Archetype(const ComponentMask &mask);
+
+    const ComponentMask & mask() const { return mMask; }
+    const std::vector<ComponentTypeId> & types() const { return mTypes; }
+
+    bool has(const ComponentTypeId id) const
+    {
+        return mColumnIndices[id] != NO_COLUMN;
+    }
+
+    std::size_t size() const { return mElements.size(); }
+    const std::vector<Element *> & elements() const { return mElements; }
+
+    const std::vector<ComponentSlot> & column(const ComponentTypeId id) const
+    {
+        assert(has(id));
+        return mColumns[mColumnIndices[id]];
+    }
+
+    ComponentSlot & slot(const std::size_t row, const ComponentTypeId id)
+    {
+        assert(has(id));
+        assert(row < size());
+        return mColumns[mColumnIndices[id]][row];
+    }
+
+    Component * component(const std::size_t row, const ComponentTypeId id)
+        const
+    {
+        assert(row < size());
+        const auto col = mColumnIndices[id];
+        return col == NO_COLUMN ? nullptr : mColumns[col][row].component;
+    }
+};
+}
@@ -0,0 +1,108 @@
+﻿#include "ComponentDatabase.hpp"
+
+#include <stdexcept>
+
+#include <Usagi/Core/Element.hpp>
+
+usagi::ComponentDatabase & usagi::ComponentDatabase::global()
+{
+    static ComponentDatabase database;
+    return database;
+}
+
+usagi::Archetype * usagi::ComponentDatabase::archetype(
+    const ComponentMask &mask)
+{
+    auto &a = mArchetypes[mask];
+    if(!a) a = std::make_unique<Archetype>(mask);
+    return a.get();
+}
+
+usagi::Archetype * usagi::ComponentDatabase::addTransition(
+    Archetype *from,
+    const ComponentTypeId id)
+{
+    if(!from)
+        return archetype(ComponentMask { }.set(id));
+
+    auto &edge = from->mAddEdges[id];
+    if(!edge)
+    {
+        auto mask = from->mask();
+        edge = archetype(mask.set(id));
+    }
+    return edge;
+}
+
+usagi::Archetype * usagi::ComponentDatabase::removeTransition(
+    Archetype *from,
+    const ComponentTypeId id)
+{
+    auto &edge = from->mRemoveEdges[id];
+    if(!edge)
+    {
+        auto mask = from->mask();
+        mask.reset(id);
+        // elements without any component are not tracked by the database
+        if(mask.none()) return nullptr;
+        edge = archetype(mask);
+    }
+    return edge;
+}
+
+std::size_t usagi::ComponentDatabase::moveElement(
+    Element *element,
+    Archetype *to)
+{
+    const auto from = element->mArchetype;
+    const auto old_row = element->mArchetypeRow;
+
+    std::size_t new_row = 0;
+    if(to)
+    {
+        new_row = to->pushRow(element);
+        if(from)
+        {
+            for(auto &&t : to->types())
+            {
+                if(from->has(t))
+                    to->slot(new_row, t) = from->slot(old_row, t);
+            }
+        }
+    }
+    if(from)
+    {
+        if(const auto moved = from->swapRemoveRow(old_row))
+            moved->mArchetypeRow = old_row;
+    }
+    element->mArchetype = to;
+    element->mArchetypeRow = new_row;
+    return new_row;
+}
+
+void usagi::ComponentDatabase::insert(
+    Element *element,
+    const ComponentTypeId id,
+    const ComponentSlot slot)
+{
+    const auto from = element->mArchetype;
+    if(from && from->has(id))
+        throw std::logic_error("Element already has the component type.");
+
+    const auto to = addTransition(from, id);
+    const auto row = moveElement(element, to);
+    to->slot(row, id) = slot;
+}
+
+usagi::ComponentSlot usagi::ComponentDatabase::remove(
+    Element *element,
+    const ComponentTypeId id)
+{
+    const auto from = element->mArchetype;
+    if(!from || !from->has(id))
+        throw std::logic_error("Element does not have the component type.");
+
+    const auto slot = from->slot(element->mArchetypeRow, id);
+    moveElement(element, removeTransition(from, id));
+    return slot;
+}
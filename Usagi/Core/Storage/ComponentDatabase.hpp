@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "Archetype.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Stores the components of elements grouped by archetype. Managed
+ * components are allocated from the per-type chunked pools of an
+ * ElementArena so components of the same type are packed together, while
+ * the archetype tables hold one column per component type for each
+ * distinct combination of types.
+ *
+ * Components are polymorphic and their addresses are exposed to the
+ * systems, so the archetype columns refer to the pooled objects instead of
+ * storing the objects inline. Moving an element between archetypes
+ * therefore never relocates its components.
+ *
+ * Not thread-safe. Element hierarchy and component configurations should
+ * only be modified from one thread at a time.
+ */
+class ComponentDatabase : Noncopyable
+{
+    std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> mArchetypes;
+
+    Archetype * archetype(const ComponentMask &mask);
+    Archetype * addTransition(Archetype *from, ComponentTypeId id);
+    Archetype * removeTransition(Archetype *from, ComponentTypeId id);
+
+    /**
+     * \brief Move the element into another archetype. The slots of the
+     * types shared by both archetypes are carried over.
+     * \param element
+     * \param to nullptr if the element no longer has any component.
+     * \return The row of element in the new archetype.
+     */
+    std::size_t moveElement(Element *element, Archetype *to);
+
+public:
+    /**
+     * \brief The database used by all elements.
+     * \return
+     */
+    static ComponentDatabase & global();
+
+    /**
+     * \brief Attach a component to the element. The element must not
+     * already have a component of the same type.
+     * \param element
+     * \param id
+     * \param slot
+     */
+    void insert(Element *element, ComponentTypeId id, ComponentSlot slot);
+
+    /**
+     * \brief Detach a component from the element. The component is not
+     * destroyed.
+     * \param element
+     * \param id
+     * \return The slot previously holding the component.
+     */
+    ComponentSlot remove(Element *element, ComponentTypeId id);
+
+    /**
+     * \brief Visit each non-empty archetype containing all the required
+     * component types.
+     * \tparam Func void(Archetype *)
+     * \param required
+     * \param func
+     */
+    template <typename Func>
+    void forEachArchetype(const ComponentMask &required, Func func)
+    {
+        for(auto &&a : mArchetypes)
+        {
+            if(a.second->size() && (a.first & required) == required)
+                func(a.second.get());
+        }
+    }
+
+    std::size_t archetypeCount() const { return mArchetypes.size(); }
+};
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include "ObjectPool.hpp"
+
+namespace usagi
+{
+class Component;
+
+using ComponentPoolBase = ObjectPoolBase<Component>;
+
+template <typename CompT>
+using ComponentPool = ObjectPool<CompT, Component>;
+}
@@ -0,0 +1,50 @@
+﻿#include "ComponentType.hpp"
+
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct ComponentTypeRegistry
+{
+    std::mutex lock;
+    std::unordered_map<std::type_index, usagi::ComponentTypeId> ids;
+    std::vector<const std::type_info *> types;
+};
+
+ComponentTypeRegistry & registry()
+{
+    static ComponentTypeRegistry registry;
+    return registry;
+}
+}
+
+usagi::ComponentTypeId usagi::componentTypeId(const std::type_info &type)
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.lock);
+
+    const auto iter = r.ids.find(type);
+    if(iter != r.ids.end())
+        return iter->second;
+
+    if(r.types.size() == MAX_COMPONENT_TYPES)
+        throw std::length_error("Too many component types.");
+    const auto id = static_cast<ComponentTypeId>(r.types.size());
+    r.ids.insert({ type, id });
+    r.types.push_back(&type);
+    return id;
+}
+
+const std::type_info & usagi::componentTypeInfo(const ComponentTypeId id)
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.lock);
+
+    assert(id < r.types.size());
+    return *r.types[id];
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <typeinfo>
+
+namespace usagi
+{
+/**
+ * \brief Dense identifier of a component base type. Ids are assigned on
+ * first use and are only meaningful within the running process.
+ */
+using ComponentTypeId = std::uint8_t;
+
+/**
+ * \brief Maximum number of distinct component base types. Bounded so that
+ * a set of component types fits in a fixed-size bitmask.
+ */
+constexpr std::size_t MAX_COMPONENT_TYPES = 64;
+
+using ComponentMask = std::bitset<MAX_COMPONENT_TYPES>;
+
+/**
+ * \brief Get the id of the component base type. Thread-safe. Throws
+ * std::length_error if MAX_COMPONENT_TYPES is exceeded.
+ * \param type
+ * \return
+ */
+ComponentTypeId componentTypeId(const std::type_info &type);
+
+/**
+ * \brief Get the type info of a component type previously registered by
+ * componentTypeId().
+ * \param id
+ * \return
+ */
+const std::type_info & componentTypeInfo(ComponentTypeId id);
+
+template <typename CompBaseT>
+ComponentTypeId componentTypeId()
+{
+    // cached so that the registry lock is only taken once per type
+    static const ComponentTypeId id = componentTypeId(typeid(CompBaseT));
+    return id;
+}
+
+template <typename... CompBaseT>
+ComponentMask componentMask()
+{
+    ComponentMask mask;
+    (mask.set(componentTypeId<CompBaseT>()), ...);
+    return mask;
+}
+}
@@ -0,0 +1,31 @@
+﻿#include "ElementArena.hpp"
+
+#include <Usagi/Core/Logging.hpp>
+
+usagi::ElementArena::~ElementArena()
+{
+    if(size() != 0)
+        LOG(error, "ElementArena destroyed with {} live objects.", size());
+}
+
+usagi::ElementArena & usagi::ElementArena::global()
+{
+    static ElementArena arena;
+    return arena;
+}
+
+std::size_t usagi::ElementArena::size() const
+{
+    std::size_t size = 0;
+    for(auto &&p : mElementPools) size += p.second->size();
+    for(auto &&p : mComponentPools) size += p.second->size();
+    return size;
+}
+
+std::size_t usagi::ElementArena::reservedBytes() const
+{
+    std::size_t bytes = 0;
+    for(auto &&p : mElementPools) bytes += p.second->reservedBytes();
+    for(auto &&p : mComponentPools) bytes += p.second->reservedBytes();
+    return bytes;
+}
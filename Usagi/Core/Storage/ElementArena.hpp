@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "ComponentPool.hpp"
+
+namespace usagi
+{
+class Element;
+
+using ElementPoolBase = ObjectPoolBase<Element>;
+
+template <typename ElementT>
+using ElementPool = ObjectPool<ElementT, Element>;
+
+/**
+ * \brief Owns the typed pools which elements and managed components are
+ * allocated from. An arena is inherited by the children of the element it
+ * is assigned to, so a whole subtree, such as the one of a game state,
+ * shares its pools. The objects are still destructed one by one when they
+ * are removed, but the chunks backing them are only released when the
+ * arena is destroyed, which happens in one go instead of one heap free per
+ * object.
+ *
+ * The arena must outlive all the objects allocated from it. Not
+ * thread-safe.
+ */
+class ElementArena : Noncopyable
+{
+    std::unordered_map<std::type_index, std::unique_ptr<ElementPoolBase>>
+        mElementPools;
+    std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>>
+        mComponentPools;
+
+public:
+    ~ElementArena();
+
+    /**
+     * \brief The arena used by elements not belonging to any other arena.
+     * \return
+     */
+    static ElementArena & global();
+
+    template <typename ElementT>
+    ElementPool<ElementT> & elementPool()
+    {
+        auto &p = mElementPools[typeid(ElementT)];
+        if(!p) p = std::make_unique<ElementPool<ElementT>>();
+        return static_cast<ElementPool<ElementT>&>(*p);
+    }
+
+    template <typename CompT>
+    ComponentPool<CompT> & componentPool()
+    {
+        auto &p = mComponentPools[typeid(CompT)];
+        if(!p) p = std::make_unique<ComponentPool<CompT>>();
+        return static_cast<ComponentPool<CompT>&>(*p);
+    }
+
+    /**
+     * \brief Number of live elements and components.
+     * \return
+     */
+    std::size_t size() const;
+
+    /**
+     * \brief Bytes of memory held by the pools.
+     * \return
+     */
+    std::size_t reservedBytes() const;
+};
+}
@@ -0,0 +1,47 @@
+﻿#include "ElementSlotMap.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+usagi::ElementSlotMap & usagi::ElementSlotMap::global()
+{
+    static ElementSlotMap slot_map;
+    return slot_map;
+}
+
+usagi::ElementHandle usagi::ElementSlotMap::insert(Element *element)
+{
+    assert(element);
+
+    std::uint32_t index;
+    if(mFreeHead != NO_SLOT)
+    {
+        index = mFreeHead;
+        mFreeHead = mSlots[index].next_free;
+    }
+    else
+    {
+        if(mSlots.size() == NO_SLOT)
+            throw std::length_error("Too many elements.");
+        index = static_cast<std::uint32_t>(mSlots.size());
+        mSlots.emplace_back();
+    }
+    auto &slot = mSlots[index];
+    slot.element = element;
+    slot.next_free = NO_SLOT;
+    ++mSize;
+    return { index, slot.generation };
+}
+
+void usagi::ElementSlotMap::erase(const ElementHandle handle)
+{
+    assert(resolve(handle));
+
+    auto &slot = mSlots[handle.index];
+    slot.element = nullptr;
+    // skip generation 0 on wrap around, which marks invalid handles
+    if(++slot.generation == 0) slot.generation = 1;
+    slot.next_free = mFreeHead;
+    mFreeHead = handle.index;
+    --mSize;
+}
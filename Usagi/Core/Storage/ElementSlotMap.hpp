@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+class Element;
+
+/**
+ * \brief Weak reference to an element. The index locates the slot of the
+ * element in the slot map and the generation tells whether the slot has
+ * been reused since the handle was issued, so a handle to a destroyed
+ * element never resolves to another element.
+ */
+struct ElementHandle
+{
+    std::uint32_t index = 0;
+    // generation 0 is never issued
+    std::uint32_t generation = 0;
+
+    bool valid() const { return generation != 0; }
+    explicit operator bool() const { return valid(); }
+
+    std::uint64_t packed() const
+    {
+        return static_cast<std::uint64_t>(generation) << 32 | index;
+    }
+
+    friend bool operator==(const ElementHandle &a, const ElementHandle &b)
+    {
+        return a.index == b.index && a.generation == b.generation;
+    }
+
+    friend bool operator!=(const ElementHandle &a, const ElementHandle &b)
+    {
+        return !(a == b);
+    }
+};
+
+/**
+ * \brief Issues handles for elements. Freed slots are reused in LIFO order
+ * with their generation incremented.
+ *
+ * Not thread-safe, like the rest of the element hierarchy.
+ */
+class ElementSlotMap : Noncopyable
+{
+    struct Slot
+    {
+        Element *element = nullptr;
+        std::uint32_t generation = 1;
+        // next free slot if this one is free
+        std::uint32_t next_free = NO_SLOT;
+    };
+
+    static constexpr std::uint32_t NO_SLOT = UINT32_MAX;
+
+    std::vector<Slot> mSlots;
+    std::uint32_t mFreeHead = NO_SLOT;
+    std::size_t mSize = 0;
+
+public:
+    /**
+     * \brief The slot map used by all elements.
+     * \return
+     */
+    static ElementSlotMap & global();
+
+    ElementHandle insert(Element *element);
+    void erase(ElementHandle handle);
+
+    Element * resolve(const ElementHandle handle) const
+    {
+        if(handle.index >= mSlots.size()) return nullptr;
+        const auto &slot = mSlots[handle.index];
+        return slot.generation == handle.generation ? slot.element : nullptr;
+    }
+
+    std::size_t size() const { return mSize; }
+
+    /**
+     * \brief Upper bound of the indices of the issued handles. Can be used
+     * to size arrays indexed by handle index.
+     * \return
+     */
+    std::size_t capacity() const { return mSlots.size(); }
+};
+}
+
+namespace std
+{
+template <>
+struct hash<usagi::ElementHandle>
+{
+    std::size_t operator()(const usagi::ElementHandle &h) const noexcept
+    {
+        return hash<std::uint64_t>()(h.packed());
+    }
+};
+}
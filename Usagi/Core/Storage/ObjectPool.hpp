@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Type-erased interface of the pools of objects derived from BaseT.
+ * \tparam BaseT
+ */
+template <typename BaseT>
+class ObjectPoolBase : Noncopyable
+{
+public:
+    virtual ~ObjectPoolBase() = default;
+
+    /**
+     * \brief Destruct an object created from this pool and recycle its
+     * storage.
+     * \param object
+     */
+    virtual void destroy(BaseT *object) = 0;
+
+    /**
+     * \brief Number of live objects.
+     * \return
+     */
+    virtual std::size_t size() const = 0;
+
+    /**
+     * \brief Bytes of memory reserved by the chunks.
+     * \return
+     */
+    virtual std::size_t reservedBytes() const = 0;
+};
+
+/**
+ * \brief Chunked storage for objects of the same concrete type. Objects
+ * are placed contiguously within fixed-size chunks and never move, so the
+ * pointers handed out remain valid until destroy() is called on them.
+ * The chunks are only returned to the heap when the pool is destroyed,
+ * all at once. Not thread-safe.
+ * \tparam T
+ * \tparam BaseT
+ */
+template <typename T, typename BaseT>
+class ObjectPool final : public ObjectPoolBase<BaseT>
+{
+    static_assert(std::is_base_of_v<BaseT, T>);
+
+    union Slot
+    {
+        Slot *next;
+        std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    };
+
+    // aim at 16 KiB per chunk but at least a few objects
+    static constexpr std::size_t CHUNK_CAPACITY =
+        std::max<std::size_t>(16 * 1024 / sizeof(Slot), 8);
+
+    std::vector<std::unique_ptr<Slot[]>> mChunks;
+    Slot *mFreeList = nullptr;
+    std::size_t mLiveCount = 0;
+
+    void allocateChunk()
+    {
+        auto chunk = std::make_unique<Slot[]>(CHUNK_CAPACITY);
+        // link in reverse order so that allocation proceeds from the front
+        for(std::size_t i = CHUNK_CAPACITY; i > 0; --i)
+        {
+            chunk[i - 1].next = mFreeList;
+            mFreeList = &chunk[i - 1];
+        }
+        mChunks.push_back(std::move(chunk));
+    }
+
+public:
+    ~ObjectPool()
+    {
+        // all objects must be released by their owners first
+        assert(mLiveCount == 0);
+    }
+
+    template <typename... Args>
+    T * create(Args &&... args)
+    {
+        if(!mFreeList) allocateChunk();
+        const auto slot = mFreeList;
+        mFreeList = slot->next;
+        try
+        {
+            const auto object = new (&slot->storage) T(
+                std::forward<Args>(args)...);
+            ++mLiveCount;
+            return object;
+        }
+        catch(...)
+        {
+            slot->next = mFreeList;
+            mFreeList = slot;
+            throw;
+        }
+    }
+
+    void destroy(BaseT *object) override
+    {
+        const auto obj = static_cast<T*>(object);
+        obj->~T();
+        const auto slot = reinterpret_cast<Slot*>(obj);
+        slot->next = mFreeList;
+        mFreeList = slot;
+        --mLiveCount;
+    }
+
+    std::size_t size() const override { return mLiveCount; }
+    std::size_t capacity() const { return mChunks.size() * CHUNK_CAPACITY; }
+
+    std::size_t reservedBytes() const override
+    {
+        return mChunks.size() * CHUNK_CAPACITY * sizeof(Slot);
+    }
+};
+}
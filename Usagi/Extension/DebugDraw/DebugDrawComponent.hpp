@@ -8,6 +8,12 @@ namespace usagi
 {
 struct DebugDrawComponent : Component
 {
+    /**
+     * \brief Record the debug shapes into the context. Called during the
+     * update of DebugDrawSystem, which may run concurrently with other
+     * subsystems, so only the component itself should be read.
+     * \param ctx
+     */
     virtual void draw(dd::ContextHandle ctx) = 0;
 
     const std::type_info & baseType() override final
@@ -1,7 +1,6 @@
 ﻿#include "DebugDrawSystem.hpp"
 
-#include <Usagi/Asset/AssetRoot.hpp>
-#include <Usagi/Asset/Converter/SpirvAssetConverter.hpp>
+#include <Usagi/Asset/Helper/Load.hpp>
 #include <Usagi/Game/Game.hpp>
 #include <Usagi/Graphics/RenderTarget/RenderTarget.hpp>
 #include <Usagi/Graphics/RenderTarget/RenderTargetDescriptor.hpp>
@@ -29,17 +28,24 @@ void usagi::DebugDrawSystem::createRenderTarget(
 void usagi::DebugDrawSystem::createPipelines()
 {
     auto gpu = mGame->runtime()->gpu();
-    mCommandPool = gpu->createCommandPool();
-    mVertexBuffer = gpu->createBuffer(GpuBufferUsage::VERTEX);
-
-    createPointLinePipeline();
-    createTextPipeline();
+    mVertexBuffer = gpu->createTransientBuffer(GpuBufferUsage::VERTEX);
+
+    // compile all shaders in parallel
+    const auto shaders = loadShaders(mGame, {
+        { "dd:shaders/pointline.vert", ShaderStage::VERTEX },
+        { "dd:shaders/pointline.frag", ShaderStage::FRAGMENT },
+        { "dd:shaders/text.vert", ShaderStage::VERTEX },
+        { "dd:shaders/text.frag", ShaderStage::FRAGMENT },
+    });
+    createPointLinePipeline(shaders[0], shaders[1]);
+    createTextPipeline(shaders[2], shaders[3]);
 }
 
-void usagi::DebugDrawSystem::createPointLinePipeline()
+void usagi::DebugDrawSystem::createPointLinePipeline(
+    std::shared_ptr<SpirvBinary> vertex_shader,
+    std::shared_ptr<SpirvBinary> fragment_shader)
 {
     auto gpu = mGame->runtime()->gpu();
-    auto assets = mGame->assets();
     auto compiler = gpu->createPipelineCompiler();
 
     // ~~ Point Pipelines ~~
@@ -47,14 +53,8 @@ void usagi::DebugDrawSystem::createPointLinePipeline()
     compiler->setRenderPass(mRenderTarget->renderPass());
     // Shaders
     {
-        compiler->setShader(ShaderStage::VERTEX,
-            assets->res<SpirvAssetConverter>(
-                "dd:shaders/pointline.vert", ShaderStage::VERTEX)
-        );
-        compiler->setShader(ShaderStage::FRAGMENT,
-            assets->res<SpirvAssetConverter>(
-                "dd:shaders/pointline.frag", ShaderStage::FRAGMENT)
-        );
+        compiler->setShader(ShaderStage::VERTEX, std::move(vertex_shader));
+        compiler->setShader(ShaderStage::FRAGMENT, std::move(fragment_shader));
     }
     // Vertex Inputs
     {
@@ -96,23 +96,18 @@ void usagi::DebugDrawSystem::createPointLinePipeline()
     mLineDepthEnabledPipeline = compiler->compile();
 }
 
-void usagi::DebugDrawSystem::createTextPipeline()
+void usagi::DebugDrawSystem::createTextPipeline(
+    std::shared_ptr<SpirvBinary> vertex_shader,
+    std::shared_ptr<SpirvBinary> fragment_shader)
 {
     auto gpu = mGame->runtime()->gpu();
-    auto assets = mGame->assets();
     auto compiler = gpu->createPipelineCompiler();
 
     compiler->setRenderPass(mRenderTarget->renderPass());
     // Shaders
     {
-        compiler->setShader(ShaderStage::VERTEX,
-            assets->res<SpirvAssetConverter>(
-                "dd:shaders/text.vert", ShaderStage::VERTEX)
-        );
-        compiler->setShader(ShaderStage::FRAGMENT,
-            assets->res<SpirvAssetConverter>(
-                "dd:shaders/text.frag", ShaderStage::FRAGMENT)
-        );
+        compiler->setShader(ShaderStage::VERTEX, std::move(vertex_shader));
+        compiler->setShader(ShaderStage::FRAGMENT, std::move(fragment_shader));
     }
     // Vertex Inputs
     {
@@ -170,18 +165,18 @@ usagi::DebugDrawSystem::~DebugDrawSystem()
 
 void usagi::DebugDrawSystem::update(const Clock &clock)
 {
-    for(auto &&e : mRegistry)
-    {
-        std::get<DebugDrawComponent*>(e.second)->draw(mContext);
-    }
+    forEach([&](Element *, DebugDrawComponent &c) {
+        c.draw(mContext);
+    });
 }
 
 std::shared_ptr<usagi::GraphicsCommandList> usagi::DebugDrawSystem::render(
-    const Clock &clock)
+    const Clock &clock,
+    GpuCommandPool *command_pool)
 {
     const auto framebuffer = mRenderTarget->createFramebuffer();
 
-    mCurrentCmdList = mCommandPool->allocateGraphicsCommandList();
+    mCurrentCmdList = command_pool->allocateGraphicsCommandList();
     mCurrentCmdList->beginRecording();
     mCurrentCmdList->beginRendering(mRenderTarget->renderPass(), framebuffer);
     mCurrentCmdList->setViewport(
@@ -17,6 +17,7 @@ class Game;
 class GraphicsPipeline;
 class GpuCommandPool;
 class GpuBuffer;
+class SpirvBinary;
 
 class DebugDrawSystem final
     : public ProjectiveRenderingSystem
@@ -34,12 +35,15 @@ class DebugDrawSystem final
     std::shared_ptr<GraphicsPipeline> mTextPipeline;
     std::shared_ptr<GpuImage> mFontTexture;
     std::shared_ptr<GpuSampler> mFontSampler;
-    std::shared_ptr<GpuCommandPool> mCommandPool;
     std::shared_ptr<GpuBuffer> mVertexBuffer;
     mutable std::shared_ptr<GraphicsCommandList> mCurrentCmdList;
 
-    void createPointLinePipeline();
-    void createTextPipeline();
+    void createPointLinePipeline(
+        std::shared_ptr<SpirvBinary> vertex_shader,
+        std::shared_ptr<SpirvBinary> fragment_shader);
+    void createTextPipeline(
+        std::shared_ptr<SpirvBinary> vertex_shader,
+        std::shared_ptr<SpirvBinary> fragment_shader);
 
 public:
     explicit DebugDrawSystem(Game *game);
@@ -48,7 +52,16 @@ public:
     void createRenderTarget(RenderTargetDescriptor &descriptor) override;
     void createPipelines() override;
     void update(const Clock &clock) override;
-    std::shared_ptr<GraphicsCommandList> render(const Clock &clock) override;
+
+    // the draw commands are recorded into the context of this subsystem
+    ComponentAccess componentAccess() const override
+    {
+        return { componentMask<DebugDrawComponent>(), { } };
+    }
+
+    std::shared_ptr<GraphicsCommandList> render(
+        const Clock &clock,
+        GpuCommandPool *command_pool) override;
 
     const std::type_info & type() override
     {
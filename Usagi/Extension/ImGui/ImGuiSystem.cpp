@@ -1,7 +1,6 @@
 ﻿#include "ImGuiSystem.hpp"
 
-#include <Usagi/Asset/AssetRoot.hpp>
-#include <Usagi/Asset/Converter/SpirvAssetConverter.hpp>
+#include <Usagi/Asset/Helper/Load.hpp>
 #include <Usagi/Core/Clock.hpp>
 #include <Usagi/Core/Logging.hpp>
 #include <Usagi/Game/Game.hpp>
@@ -51,10 +50,8 @@ void usagi::ImGuiSystem::setup()
 
     // resources
     auto gpu = mGame->runtime()->gpu();
-    mVertexBuffer = gpu->createBuffer(GpuBufferUsage::VERTEX);
-    mIndexBuffer = gpu->createBuffer(GpuBufferUsage::INDEX);
-
-    mCommandPool = gpu->createCommandPool();
+    mVertexBuffer = gpu->createTransientBuffer(GpuBufferUsage::VERTEX);
+    mIndexBuffer = gpu->createTransientBuffer(GpuBufferUsage::INDEX);
 
     // fonts
     {
@@ -150,19 +147,16 @@ void usagi::ImGuiSystem::createRenderTarget(
 void usagi::ImGuiSystem::createPipelines()
 {
     auto gpu = mGame->runtime()->gpu();
-    auto assets = mGame->assets();
     auto compiler = gpu->createPipelineCompiler();
 
     // Shaders
     {
-        compiler->setShader(ShaderStage::VERTEX,
-            assets->res<SpirvAssetConverter>(
-                "imgui:shaders/glsl_shader.vert", ShaderStage::VERTEX)
-        );
-        compiler->setShader(ShaderStage::FRAGMENT,
-            assets->res<SpirvAssetConverter>(
-                "imgui:shaders/glsl_shader.frag", ShaderStage::FRAGMENT)
-        );
+        const auto shaders = loadShaders(mGame, {
+            { "imgui:shaders/glsl_shader.vert", ShaderStage::VERTEX },
+            { "imgui:shaders/glsl_shader.frag", ShaderStage::FRAGMENT },
+        });
+        compiler->setShader(ShaderStage::VERTEX, shaders[0]);
+        compiler->setShader(ShaderStage::FRAGMENT, shaders[1]);
     }
     // Vertex Inputs
     {
@@ -317,12 +311,14 @@ void usagi::ImGuiSystem::updateMouse()
 
 void usagi::ImGuiSystem::processElements(const Clock &clock)
 {
-    for(auto &e : mRegistry)
-        std::get<ImGuiComponent*>(e.second)->draw(clock);
+    forEach([&](Element *, ImGuiComponent &c) {
+        c.draw(clock);
+    });
 }
 
 std::shared_ptr<usagi::GraphicsCommandList> usagi::ImGuiSystem::render(
-    const Clock &clock)
+    const Clock &clock,
+    GpuCommandPool *command_pool)
 {
     ImGui::Render();
 
@@ -353,7 +349,7 @@ std::shared_ptr<usagi::GraphicsCommandList> usagi::ImGuiSystem::render(
     }
 
     // Render Command List
-    auto cmd_list = mCommandPool->allocateGraphicsCommandList();
+    auto cmd_list = command_pool->allocateGraphicsCommandList();
     cmd_list->beginRecording();
     cmd_list->beginRendering(
         mRenderTarget->renderPass(),
@@ -49,7 +49,6 @@ class ImGuiSystem final
     void updateMouse();
 
     std::shared_ptr<GraphicsPipeline> mPipeline;
-    std::shared_ptr<GpuCommandPool> mCommandPool;
     std::shared_ptr<RenderPass> mRenderPass;
     std::shared_ptr<GpuBuffer> mVertexBuffer;
     std::shared_ptr<GpuBuffer> mIndexBuffer;
@@ -69,7 +68,9 @@ public:
 
     void createRenderTarget(RenderTargetDescriptor &descriptor) override;
     void createPipelines() override;
-    std::shared_ptr<GraphicsCommandList> render(const Clock &clock) override;
+    std::shared_ptr<GraphicsCommandList> render(
+        const Clock &clock,
+        GpuCommandPool *command_pool) override;
 
     bool onKeyStateChange(const KeyEvent &e) override;
     bool onMouseButtonStateChange(const MouseButtonEvent &e) override;
@@ -0,0 +1,121 @@
+﻿#include "MemoryStatsPanel.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "ImGui.hpp"
+
+namespace
+{
+double toMiB(const std::size_t bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+}
+
+usagi::MemoryStatsPanel::MemoryStatsPanel(
+    GpuDevice *device,
+    SubresourceCache *subresources)
+    : mDevice(device)
+    , mSubresources(subresources)
+{
+}
+
+void usagi::MemoryStatsPanel::operator()(const Clock &clock)
+{
+    drawGpuMemory();
+    if(mSubresources) drawSubresourceCache();
+}
+
+void usagi::MemoryStatsPanel::drawGpuMemory()
+{
+    auto samples = mDevice->memoryPoolStats();
+    // the pools are fixed so the samples are always in the same order
+    if(mLastSamples.size() != samples.size())
+        mLastSamples = samples;
+
+    if(ImGui::Begin("GPU Memory"))
+    {
+        for(std::size_t i = 0; i < samples.size(); ++i)
+        {
+            const auto &s = samples[i].stats;
+            const auto &last = mLastSamples[i].stats;
+            const auto usage = s.managed_bytes
+                ? static_cast<double>(s.used_bytes) / s.managed_bytes : 0.0;
+
+            ImGui::PushID(static_cast<int>(i));
+            if(usage > WARNING_USAGE)
+                ImGui::PushStyleColor(ImGuiCol_PlotHistogram,
+                    ImVec4(0.9f, 0.2f, 0.2f, 1.f));
+            ImGui::Text("%s", samples[i].name.c_str());
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%.2f / %.2f MiB",
+                toMiB(s.used_bytes), toMiB(s.managed_bytes));
+            ImGui::ProgressBar(static_cast<float>(usage),
+                ImVec2(-1, 0), overlay);
+            if(usage > WARNING_USAGE)
+                ImGui::PopStyleColor();
+
+            ImGui::Text("Peak: %.2f MiB", toMiB(s.peak_used_bytes));
+            ImGui::Text("Largest free block: %.2f MiB (fragmentation %.1f%%)",
+                toMiB(s.largest_free_bytes), s.fragmentation() * 100);
+            ImGui::Text("Live allocations: %llu",
+                static_cast<unsigned long long>(s.liveAllocations()));
+            ImGui::Text("Per frame: %llu allocs, %llu frees, %.1f KiB",
+                static_cast<unsigned long long>(
+                    s.total_allocations - last.total_allocations),
+                static_cast<unsigned long long>(
+                    s.total_deallocations - last.total_deallocations),
+                (s.total_allocated_bytes - last.total_allocated_bytes)
+                / 1024.0);
+            ImGui::Separator();
+            ImGui::PopID();
+        }
+    }
+    ImGui::End();
+
+    mLastSamples = std::move(samples);
+}
+
+void usagi::MemoryStatsPanel::drawSubresourceCache()
+{
+    auto stats = mSubresources->stats();
+    const auto &last = mLastCacheStats;
+
+    if(ImGui::Begin("Subresource Cache"))
+    {
+        const auto usage = stats.budget_bytes
+            ? static_cast<double>(stats.retained_bytes) / stats.budget_bytes
+            : 0.0;
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.2f / %.2f MiB",
+            toMiB(stats.retained_bytes), toMiB(stats.budget_bytes));
+        ImGui::ProgressBar(static_cast<float>(std::min(usage, 1.0)),
+            ImVec2(-1, 0), overlay);
+
+        ImGui::Text("Entries: %llu",
+            static_cast<unsigned long long>(stats.entries));
+        ImGui::Text("Hit rate: %.1f%% (%llu hits, %llu misses)",
+            stats.hitRate() * 100,
+            static_cast<unsigned long long>(stats.hits),
+            static_cast<unsigned long long>(stats.misses));
+        ImGui::Text("Evictions: %llu",
+            static_cast<unsigned long long>(stats.evictions));
+        ImGui::Text("Per frame: %llu hits, %llu misses, %llu evictions",
+            static_cast<unsigned long long>(stats.hits - last.hits),
+            static_cast<unsigned long long>(stats.misses - last.misses),
+            static_cast<unsigned long long>(
+                stats.evictions - last.evictions));
+
+        ImGui::Separator();
+        for(auto &&t : stats.types)
+        {
+            ImGui::Text("%s: %llu retained, %.2f MiB", t.type_name.c_str(),
+                static_cast<unsigned long long>(t.retained_count),
+                toMiB(t.retained_bytes));
+        }
+    }
+    ImGui::End();
+
+    mLastCacheStats = std::move(stats);
+}
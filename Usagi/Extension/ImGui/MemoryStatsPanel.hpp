@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <Usagi/Asset/SubresourceCache.hpp>
+#include <Usagi/Runtime/Graphics/GpuDevice.hpp>
+
+namespace usagi
+{
+class Clock;
+
+/**
+ * \brief Draws the statistics of the memory pools of a GPU device in an
+ * ImGui window, including the allocations and deallocations made since
+ * the previous frame, so that pressure on a pool shows up before it
+ * throws std::bad_alloc. If a subresource cache is given, its usage and
+ * hit rate are drawn in another window. Intended to be used with
+ * DelegatedImGuiComponent:
+ *
+ * element->addComponent<DelegatedImGuiComponent>(
+ *     MemoryStatsPanel(gpu, assets->subresources()));
+ */
+class MemoryStatsPanel
+{
+    GpuDevice *mDevice = nullptr;
+    SubresourceCache *mSubresources = nullptr;
+    // the samples of the previous frame for calculating the rates
+    std::vector<GpuMemoryPoolStats> mLastSamples;
+    SubresourceCacheStats mLastCacheStats;
+
+    void drawGpuMemory();
+    void drawSubresourceCache();
+
+public:
+    /**
+     * \brief Pools whose usage exceed this ratio are highlighted.
+     */
+    static constexpr double WARNING_USAGE = 0.9;
+
+    explicit MemoryStatsPanel(
+        GpuDevice *device,
+        SubresourceCache *subresources = nullptr);
+
+    void operator()(const Clock &clock);
+};
+}
@@ -1,7 +1,6 @@
 ﻿#include "NuklearSystem.hpp"
 
-#include <Usagi/Asset/AssetRoot.hpp>
-#include <Usagi/Asset/Converter/SpirvAssetConverter.hpp>
+#include <Usagi/Asset/Helper/Load.hpp>
 #include <Usagi/Core/Clock.hpp>
 #include <Usagi/Core/Logging.hpp>
 #include <Usagi/Game/Game.hpp>
@@ -50,10 +49,8 @@ void usagi::NuklearSystem::setup()
 
     // resources
     auto gpu = mGame->runtime()->gpu();
-    mVertexBuffer = gpu->createBuffer(GpuBufferUsage::VERTEX);
-    mIndexBuffer = gpu->createBuffer(GpuBufferUsage::INDEX);
-
-    mCommandPool = gpu->createCommandPool();
+    mVertexBuffer = gpu->createTransientBuffer(GpuBufferUsage::VERTEX);
+    mIndexBuffer = gpu->createTransientBuffer(GpuBufferUsage::INDEX);
 
     // fonts
     {
@@ -146,19 +143,16 @@ usagi::NuklearSystem::~NuklearSystem()
 void usagi::NuklearSystem::createPipelines()
 {
     auto gpu = mGame->runtime()->gpu();
-    auto assets = mGame->assets();
     auto compiler = gpu->createPipelineCompiler();
 
     // Shaders
     {
-        compiler->setShader(ShaderStage::VERTEX,
-            assets->res<SpirvAssetConverter>(
-                "nuklear:shaders/shader.vert", ShaderStage::VERTEX)
-        );
-        compiler->setShader(ShaderStage::FRAGMENT,
-            assets->res<SpirvAssetConverter>(
-                "nuklear:shaders/shader.frag", ShaderStage::FRAGMENT)
-        );
+        const auto shaders = loadShaders(mGame, {
+            { "nuklear:shaders/shader.vert", ShaderStage::VERTEX },
+            { "nuklear:shaders/shader.frag", ShaderStage::FRAGMENT },
+        });
+        compiler->setShader(ShaderStage::VERTEX, shaders[0]);
+        compiler->setShader(ShaderStage::FRAGMENT, shaders[1]);
     }
     // Input Assembly
     {
@@ -236,12 +230,14 @@ void usagi::NuklearSystem::createRenderTarget(
 
 void usagi::NuklearSystem::processElements(const Clock &clock)
 {
-    for(auto &e : mRegistry)
-        std::get<NuklearComponent*>(e.second)->draw(clock, &mContext);
+    forEach([&](Element *, NuklearComponent &c) {
+        c.draw(clock, &mContext);
+    });
 }
 
 std::shared_ptr<usagi::GraphicsCommandList> usagi::NuklearSystem::render(
-    const Clock &clock)
+    const Clock &clock,
+    GpuCommandPool *command_pool)
 {
     /* fill converting configuration */
     {
@@ -283,7 +279,7 @@ std::shared_ptr<usagi::GraphicsCommandList> usagi::NuklearSystem::render(
     }
 
     // Render Command List
-    auto cmd_list = mCommandPool->allocateGraphicsCommandList();
+    auto cmd_list = command_pool->allocateGraphicsCommandList();
     cmd_list->beginRecording();
     cmd_list->beginRendering(
         mRenderTarget->renderPass(),
@@ -50,7 +50,6 @@ class NuklearSystem final
     void processElements(const Clock &clock);
 
     std::shared_ptr<GraphicsPipeline> mPipeline;
-    std::shared_ptr<GpuCommandPool> mCommandPool;
     std::shared_ptr<GpuBuffer> mVertexBuffer;
     std::shared_ptr<GpuBuffer> mIndexBuffer;
     std::shared_ptr<GpuImage> mFontTexture;
@@ -77,7 +76,9 @@ public:
 
     void createRenderTarget(RenderTargetDescriptor &descriptor) override;
     void createPipelines() override;
-    std::shared_ptr<GraphicsCommandList> render(const Clock &clock) override;
+    std::shared_ptr<GraphicsCommandList> render(
+        const Clock &clock,
+        GpuCommandPool *command_pool) override;
 
     const std::type_info & type() override
     {
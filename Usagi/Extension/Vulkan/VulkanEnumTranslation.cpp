@@ -9,6 +9,7 @@
 #include <Usagi/Runtime/Graphics/RenderPassCreateInfo.hpp>
 #include <Usagi/Runtime/Graphics/GpuImageViewCreateInfo.hpp>
 #include <Usagi/Runtime/Graphics/GpuSamplerCreateInfo.hpp>
+#include <Usagi/Runtime/Graphics/Shader/ShaderReflection.hpp>
 #include <Usagi/Runtime/Graphics/Shader/ShaderStage.hpp>
 
 using namespace usagi;
@@ -29,6 +30,27 @@ vk::ShaderStageFlagBits translate(ShaderStage stage)
     }
 }
 
+vk::DescriptorType translate(const ShaderResourceType type)
+{
+    switch(type)
+    {
+        case ShaderResourceType::SAMPLED_IMAGE:
+            return vk::DescriptorType::eSampledImage;
+        case ShaderResourceType::SAMPLER:
+            return vk::DescriptorType::eSampler;
+        case ShaderResourceType::COMBINED_IMAGE_SAMPLER:
+            return vk::DescriptorType::eCombinedImageSampler;
+        case ShaderResourceType::UNIFORM_BUFFER:
+            return vk::DescriptorType::eUniformBuffer;
+        case ShaderResourceType::STORAGE_BUFFER:
+            return vk::DescriptorType::eStorageBuffer;
+        case ShaderResourceType::INPUT_ATTACHMENT:
+            return vk::DescriptorType::eInputAttachment;
+        default:
+            throw std::runtime_error("Invalid shader resource type");
+    }
+}
+
 GpuBufferFormat from(vk::Format format)
 {
     switch(format)
@@ -312,13 +334,17 @@ vk::ComponentSwizzle translate(const GpuImageComponentSwizzle swizzle)
 }
 }
 
-USAGI_ENUM_TRANSLATION_NS(usagi::vulkan, GpuBufferFormat, vk::Format, 14,
+USAGI_ENUM_TRANSLATION_NS(usagi::vulkan, GpuBufferFormat, vk::Format, 18,
     (
         GpuBufferFormat::R8_UNORM,
         GpuBufferFormat::R8G8_UNORM,
         GpuBufferFormat::R8G8B8_UNORM,
         GpuBufferFormat::R8G8B8A8_UNORM,
+        GpuBufferFormat::R8G8B8A8_SRGB,
         GpuBufferFormat::B8G8R8A8_UNORM,
+        GpuBufferFormat::R16_SFLOAT,
+        GpuBufferFormat::R16G16_SFLOAT,
+        GpuBufferFormat::R16G16B16A16_SFLOAT,
         GpuBufferFormat::R32_SFLOAT,
         GpuBufferFormat::R32G32_SFLOAT,
         GpuBufferFormat::R32G32B32_SFLOAT,
@@ -334,7 +360,11 @@ USAGI_ENUM_TRANSLATION_NS(usagi::vulkan, GpuBufferFormat, vk::Format, 14,
         vk::Format::eR8G8Unorm,
         vk::Format::eR8G8B8Unorm,
         vk::Format::eR8G8B8A8Unorm,
+        vk::Format::eR8G8B8A8Srgb,
         vk::Format::eB8G8R8A8Unorm,
+        vk::Format::eR16Sfloat,
+        vk::Format::eR16G16Sfloat,
+        vk::Format::eR16G16B16A16Sfloat,
         vk::Format::eR32Sfloat,
         vk::Format::eR32G32Sfloat,
         vk::Format::eR32G32B32Sfloat,
@@ -25,11 +25,13 @@ enum class PolygonMode;
 enum class BlendingOperation;
 enum class BlendingFactor;
 enum class ShaderStage;
+enum class ShaderResourceType;
 enum class CompareOp;
 
 namespace vulkan
 {
 vk::ShaderStageFlagBits translate(ShaderStage stage);
+vk::DescriptorType translate(ShaderResourceType type);
 vk::VertexInputRate translate(VertexInputRate rate);
 vk::PrimitiveTopology translate(PrimitiveTopology topology);
 vk::CullModeFlags translate(FaceCullingMode face_culling_mode);
@@ -6,6 +6,8 @@
 #include <Usagi/Runtime/Graphics/GpuImageView.hpp>
 #include <Usagi/Runtime/Graphics/GpuSamplerCreateInfo.hpp>
 #include <Usagi/Runtime/Memory/BitmapMemoryAllocator.hpp>
+#include <Usagi/Runtime/Memory/FrameRingAllocator.hpp>
+#include <Usagi/Runtime/Memory/SlabMemoryAllocator.hpp>
 #include <Usagi/Utility/Flag.hpp>
 #include <Usagi/Utility/TypeCast.hpp>
 
@@ -21,6 +23,7 @@
 #include "VulkanEnumTranslation.hpp"
 #include "VulkanGraphicsPipelineCompiler.hpp"
 #include "VulkanHelper.hpp"
+#include "VulkanPipelineCache.hpp"
 #include "VulkanRenderPass.hpp"
 
 using namespace usagi::vulkan;
@@ -287,7 +290,7 @@ void usagi::VulkanGpuDevice::createDeviceAndQueues()
 
 void usagi::VulkanGpuDevice::createMemoryPools()
 {
-    mDynamicBufferPool = std::make_unique<BitmapBufferPool>(
+    mDynamicBufferPool = std::make_unique<SlabBufferPool>(
         this,
         1024 * 1024 * 512, // 512MiB  todo from config
         vk::MemoryPropertyFlagBits::eHostVisible |
@@ -297,10 +300,31 @@ void usagi::VulkanGpuDevice::createMemoryPools()
         vk::BufferUsageFlagBits::eIndexBuffer |
         vk::BufferUsageFlagBits::eUniformBuffer,
         [](const vk::MemoryRequirements &req) {
-            return std::make_unique<BitmapMemoryAllocator>(
+            return std::make_unique<SlabMemoryAllocator>(
                 nullptr,
                 req.size,
-                32 * 1024 /* 32 KiB */ // todo config
+                // covers minUniformBufferOffsetAlignment, which is at most
+                // 256 bytes per the spec
+                256
+            );
+        }
+    );
+
+    mTransientBufferPool = std::make_unique<RingBufferPool>(
+        this,
+        1024 * 1024 * 64, // 64MiB  todo from config
+        vk::MemoryPropertyFlagBits::eHostVisible |
+        vk::MemoryPropertyFlagBits::eHostCoherent,
+        vk::BufferUsageFlagBits::eVertexBuffer |
+        vk::BufferUsageFlagBits::eIndexBuffer |
+        vk::BufferUsageFlagBits::eUniformBuffer,
+        [](const vk::MemoryRequirements &req) {
+            return std::make_unique<FrameRingAllocator>(
+                nullptr,
+                // keep the size a multiple of the alignment
+                req.size / 256 * 256,
+                // covers minUniformBufferOffsetAlignment
+                256
             );
         }
     );
@@ -345,6 +369,8 @@ usagi::VulkanGpuDevice::VulkanGpuDevice()
     selectPhysicalDevice();
     createDeviceAndQueues();
     createMemoryPools();
+    mPipelineCache = std::make_unique<VulkanPipelineCache>(
+        this, "./.cache/vulkan_pipeline_cache.bin");
     createFallbackTexture();
 }
 
@@ -353,6 +379,7 @@ usagi::VulkanGpuDevice::~VulkanGpuDevice()
     // Wait till all operations are completed so it is safe to release the
     // resources.
     mDevice->waitIdle();
+    mPipelineCache->save();
 }
 
 std::unique_ptr<usagi::GraphicsPipelineCompiler> usagi::VulkanGpuDevice::
@@ -399,6 +426,13 @@ std::shared_ptr<usagi::GpuBuffer> usagi::VulkanGpuDevice::createBuffer(
     return std::make_shared<VulkanGpuBuffer>(mDynamicBufferPool.get(), usage);
 }
 
+std::shared_ptr<usagi::GpuBuffer> usagi::VulkanGpuDevice::
+    createTransientBuffer(GpuBufferUsage usage)
+{
+    return std::make_shared<VulkanGpuBuffer>(
+        mTransientBufferPool.get(), usage);
+}
+
 std::shared_ptr<usagi::GpuImage> usagi::VulkanGpuDevice::createImage(
     const GpuImageCreateInfo &info)
 {
@@ -456,9 +490,18 @@ void usagi::VulkanGpuDevice::submitGraphicsJobs(
     BatchResourceList batch_resources;
     batch_resources.fence = mDevice->createFenceUnique(vk::FenceCreateInfo { });
 
+    // the uploads precede the jobs in the same submission so that the
+    // images are ready when the jobs sample them
+    std::vector<vk::CommandBuffer> vk_cmds;
+    vk_cmds.reserve(vk_jobs.size() + 1);
+    batch_resources.upload_commands = recordPendingUploads(batch_resources);
+    if(batch_resources.upload_commands)
+        vk_cmds.push_back(batch_resources.upload_commands.get());
+    vk_cmds.insert(vk_cmds.end(), vk_jobs.begin(), vk_jobs.end());
+
     vk::SubmitInfo info;
-    info.setCommandBufferCount(static_cast<uint32_t>(vk_jobs.size()));
-    info.setPCommandBuffers(vk_jobs.data());
+    info.setCommandBufferCount(static_cast<uint32_t>(vk_cmds.size()));
+    info.setPCommandBuffers(vk_cmds.data());
     info.setWaitSemaphoreCount(static_cast<uint32_t>(vk_wait_sems.size()));
     info.setPWaitSemaphores(vk_wait_sems.data());
     info.setSignalSemaphoreCount(static_cast<uint32_t>(vk_signal_sems.size()));
@@ -478,17 +521,36 @@ void usagi::VulkanGpuDevice::submitGraphicsJobs(
     cast_append(wait_semaphores);
     cast_append(signal_semaphores);
 
+    // the transient allocations recorded in the jobs precede the mark
+    batch_resources.transient_mark =
+        mTransientBufferPool->allocator()->closeFrame();
+
     mGraphicsQueue.submit({ info }, batch_resources.fence.get());
 
     mBatchResourceLists.push_back(std::move(batch_resources));
 }
 
+std::vector<usagi::GpuMemoryPoolStats>
+usagi::VulkanGpuDevice::memoryPoolStats() const
+{
+    return {
+        { "Dynamic Buffers", mDynamicBufferPool->stats() },
+        { "Transient Buffers", mTransientBufferPool->stats() },
+        { "Device Images", mDeviceImagePool->stats() },
+    };
+}
+
 void usagi::VulkanGpuDevice::reclaimResources()
 {
     for(auto i = mBatchResourceLists.begin(); i != mBatchResourceLists.end();)
     {
         if(mDevice->getFenceStatus(i->fence.get()) == vk::Result::eSuccess)
+        {
+            // a signaled fence implies that all previous submissions to
+            // the queue are finished, so the ring can be retired up to it
+            mTransientBufferPool->allocator()->retire(i->transient_mark);
             i = mBatchResourceLists.erase(i);
+        }
         else
             ++i;
     }
@@ -509,6 +571,11 @@ vk::Queue usagi::VulkanGpuDevice::presentQueue() const
     return mGraphicsQueue;
 }
 
+usagi::VulkanPipelineCache * usagi::VulkanGpuDevice::pipelineCache() const
+{
+    return mPipelineCache.get();
+}
+
 vk::Device usagi::VulkanGpuDevice::device() const
 {
     return mDevice.get();
@@ -529,6 +596,21 @@ void usagi::VulkanGpuDevice::copyBufferToImage(
     const std::shared_ptr<VulkanBufferAllocation> &buffer,
     VulkanGpuImage *image)
 {
+    std::lock_guard<std::mutex> lock(mUploadLock);
+    mPendingUploads.push_back({ buffer, image->shared_from_this() });
+}
+
+vk::UniqueCommandBuffer usagi::VulkanGpuDevice::recordPendingUploads(
+    BatchResourceList &batch_resources)
+{
+    std::vector<PendingUpload> uploads;
+    {
+        std::lock_guard<std::mutex> lock(mUploadLock);
+        uploads.swap(mPendingUploads);
+    }
+    if(uploads.empty())
+        return { };
+
     vk::UniqueCommandBuffer cmd;
     {
         vk::CommandBufferAllocateInfo info;
@@ -549,9 +631,14 @@ void usagi::VulkanGpuDevice::copyBufferToImage(
     range.setLayerCount(1);
     range.setBaseMipLevel(0);
     range.setLevelCount(1);
+
+    // transition all images with a single barrier on each side of the copies
+    std::vector<vk::ImageMemoryBarrier> barriers;
+    barriers.reserve(uploads.size());
+    for(auto &&u : uploads)
     {
         vk::ImageMemoryBarrier barrier;
-        barrier.setImage(image->image());
+        barrier.setImage(u.image->image());
         barrier.setOldLayout(vk::ImageLayout::eUndefined);
         barrier.setNewLayout(vk::ImageLayout::eTransferDstOptimal);
         barrier.setSrcQueueFamilyIndex(mGraphicsQueueFamilyIndex);
@@ -559,47 +646,42 @@ void usagi::VulkanGpuDevice::copyBufferToImage(
         barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferRead);
         barrier.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
         barrier.setSubresourceRange(range);
-        cmd->pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eTransfer,
-            { }, { }, { }, { barrier });
+        barriers.push_back(barrier);
     }
+    cmd->pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eTransfer,
+        { }, { }, { }, barriers);
+    for(auto &&u : uploads)
     {
         vk::BufferImageCopy copy;
-        const auto size = image->size();
+        const auto size = u.image->size();
         copy.setImageExtent({ size.x(), size.y(), 1 });
-        copy.setBufferOffset(buffer->offset());
+        copy.setBufferOffset(u.buffer->offset());
         copy.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
         copy.imageSubresource.setLayerCount(1);
-        copy.imageSubresource.setBaseArrayLayer(0);
-        copy.imageSubresource.setMipLevel(0);
         cmd->copyBufferToImage(
-            buffer->pool()->buffer(), image->image(),
+            u.buffer->pool()->buffer(), u.image->image(),
             vk::ImageLayout::eTransferDstOptimal, { copy });
     }
+    for(auto &&b : barriers)
     {
-        vk::ImageMemoryBarrier barrier;
-        barrier.setImage(image->image());
-        barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
-        barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
-        barrier.setSrcQueueFamilyIndex(mGraphicsQueueFamilyIndex);
-        barrier.setDstQueueFamilyIndex(mGraphicsQueueFamilyIndex);
-        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
-        barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
-        barrier.setSubresourceRange(range);
-        cmd->pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            { }, { }, { }, { barrier });
+        b.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
+        b.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+        b.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+        b.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
     }
+    cmd->pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        { }, { }, { }, barriers);
     cmd->end();
+
+    // keep the staging buffers and the images until the batch finished
+    for(auto &&u : uploads)
     {
-        vk::SubmitInfo info;
-        const auto cmd_handle = cmd.get();
-        info.setCommandBufferCount(1);
-        info.setPCommandBuffers(&cmd_handle);
-        mGraphicsQueue.submit({ info }, { });
+        batch_resources.resources.push_back(std::move(u.buffer));
+        batch_resources.resources.push_back(std::move(u.image));
     }
-    // todo batch uploads & manage dependencies
-    mDevice->waitIdle();
+    return cmd;
 }
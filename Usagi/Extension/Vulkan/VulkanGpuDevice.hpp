@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <deque>
+#include <mutex>
 
 #include <vulkan/vulkan.hpp>
 
@@ -11,8 +12,11 @@
 namespace usagi
 {
 class BitmapMemoryAllocator;
+class SlabMemoryAllocator;
+class FrameRingAllocator;
 class VulkanMemoryPool;
 class VulkanBatchResource;
+class VulkanPipelineCache;
 
 class VulkanGpuDevice : public GpuDevice
 {
@@ -50,11 +54,18 @@ class VulkanGpuDevice : public GpuDevice
 
     // Memory Management
 
-    using BitmapBufferPool = VulkanBufferMemoryPool<BitmapMemoryAllocator>;
+    using SlabBufferPool = VulkanBufferMemoryPool<SlabMemoryAllocator>;
     /**
      * \brief Used for per-frame updated buffers and resource staging.
      */
-    std::unique_ptr<BitmapBufferPool> mDynamicBufferPool;
+    std::unique_ptr<SlabBufferPool> mDynamicBufferPool;
+
+    using RingBufferPool = VulkanBufferMemoryPool<FrameRingAllocator>;
+    /**
+     * \brief Used for buffers rewritten every frame. The allocations made
+     * before each submission are retired together when its fence signals.
+     */
+    std::unique_ptr<RingBufferPool> mTransientBufferPool;
 
     using BitmapImagePool = VulkanImageMemoryPool<BitmapMemoryAllocator>;
     /**
@@ -66,6 +77,22 @@ class VulkanGpuDevice : public GpuDevice
 
     void createMemoryPools();
 
+    // Pipeline States
+
+    std::unique_ptr<VulkanPipelineCache> mPipelineCache;
+
+    // Transfer Stage
+
+    struct PendingUpload
+    {
+        std::shared_ptr<VulkanBufferAllocation> buffer;
+        std::shared_ptr<VulkanGpuImage> image;
+    };
+    // image uploads may be requested by any thread, such as the asset
+    // loading jobs, and are recorded in batch with the next submission.
+    std::mutex mUploadLock;
+    std::vector<PendingUpload> mPendingUploads;
+
     std::shared_ptr<GpuImage> mFallbackTexture;
     void createFallbackTexture();
 
@@ -75,11 +102,23 @@ class VulkanGpuDevice : public GpuDevice
     {
         vk::UniqueFence fence;
         std::vector<std::shared_ptr<VulkanBatchResource>> resources;
+        vk::UniqueCommandBuffer upload_commands;
+        // end of the transient allocations used by the batch
+        std::size_t transient_mark = 0;
     };
     // must be the first to be destructed in dtor since it may refer to other
     // members.
     std::deque<BatchResourceList> mBatchResourceLists;
 
+    /**
+     * \brief Record the pending uploads into a command buffer and add the
+     * resources used by them to the batch.
+     * \param batch_resources
+     * \return The command buffer, or null if there is no pending upload.
+     */
+    vk::UniqueCommandBuffer recordPendingUploads(
+        BatchResourceList &batch_resources);
+
 public:
     VulkanGpuDevice();
     ~VulkanGpuDevice();
@@ -94,6 +133,8 @@ public:
         std::vector<std::shared_ptr<GpuImageView>> views) override;
     std::shared_ptr<GpuSemaphore> createSemaphore() override;
     std::shared_ptr<GpuBuffer> createBuffer(GpuBufferUsage usage) override;
+    std::shared_ptr<GpuBuffer> createTransientBuffer(GpuBufferUsage usage)
+        override;
     std::shared_ptr<GpuImage> createImage(const GpuImageCreateInfo &info)
         override;
     std::shared_ptr<GpuSampler> createSampler(const GpuSamplerCreateInfo &info)
@@ -107,6 +148,7 @@ public:
         std::initializer_list<std::shared_ptr<GpuSemaphore>> signal_semaphores
     ) override;
 
+    std::vector<GpuMemoryPoolStats> memoryPoolStats() const override;
     void reclaimResources() override;
     void waitIdle() override;
 
@@ -115,9 +157,17 @@ public:
     uint32_t graphicsQueueFamily() const;
 
     vk::Queue presentQueue() const;
+    VulkanPipelineCache * pipelineCache() const;
 
     std::shared_ptr<VulkanBufferAllocation> allocateStageBuffer(
         std::size_t size);
+    /**
+     * \brief Queue a copy from the staging buffer to the image. Thread-safe.
+     * The copies are executed before the jobs of the next call to
+     * submitGraphicsJobs().
+     * \param buffer
+     * \param image
+     */
     void copyBufferToImage(
         const std::shared_ptr<VulkanBufferAllocation> &buffer,
         VulkanGpuImage *image);
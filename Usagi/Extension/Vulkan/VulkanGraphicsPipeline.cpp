@@ -18,7 +18,7 @@ vk::DescriptorSetLayout usagi::VulkanGraphicsPipeline::descriptorSetLayout(
         LOG(error, "Nonexisting descriptor set id = {}", set_id);
         throw std::logic_error("Referenced invalid resource.");
     }
-    return mLayouts.find(set_id)->second.get();
+    return i->second->get();
 }
 
 vk::DescriptorType usagi::VulkanGraphicsPipeline::descriptorType(
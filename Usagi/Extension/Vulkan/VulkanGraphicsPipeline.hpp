@@ -25,8 +25,9 @@ class VulkanGraphicsPipeline
 public:
     using DescriptorSetLayoutBindingMap =
         std::map<std::uint32_t, std::vector<vk::DescriptorSetLayoutBinding>>;
-    using DescriptorSetLayoutMap =
-        std::map<std::uint32_t, vk::UniqueDescriptorSetLayout>;
+    // the layouts are shared by pipelines with the same bindings
+    using DescriptorSetLayoutMap = std::map<std::uint32_t,
+        std::shared_ptr<vk::UniqueDescriptorSetLayout>>;
     using PushConstantFieldMap =
         std::map<ShaderStage, std::map<std::string, VulkanPushConstantField>>;
 
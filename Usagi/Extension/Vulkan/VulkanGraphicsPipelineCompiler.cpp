@@ -1,17 +1,19 @@
 ﻿#include "VulkanGraphicsPipelineCompiler.hpp"
 
 #include <cstdint>
+#include <type_traits>
 
 #include <Usagi/Runtime/Graphics/Shader/SpirvBinary.hpp>
 #include <Usagi/Utility/TypeCast.hpp>
+#include <Usagi/Utility/Hash.hpp>
 #include <Usagi/Core/Logging.hpp>
 
 #include "VulkanGpuDevice.hpp"
 #include "VulkanEnumTranslation.hpp"
 #include "VulkanRenderPass.hpp"
 #include "VulkanGraphicsPipeline.hpp"
+#include "VulkanPipelineCache.hpp"
 
-using namespace spirv_cross;
 using namespace usagi::vulkan;
 
 vk::UniqueShaderModule usagi::VulkanGraphicsPipelineCompiler::
@@ -92,6 +94,109 @@ void usagi::VulkanGraphicsPipelineCompiler::setRenderPass(
     mPipelineCreateInfo.setRenderPass(mRenderPass->renderPass());
 }
 
+namespace
+{
+class PipelineKeyWriter
+{
+    std::string mKey;
+
+public:
+    template <typename T>
+    void write(const T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        mKey.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void write(const std::string &string)
+    {
+        write(string.size());
+        mKey += string;
+    }
+
+    std::string key() { return std::move(mKey); }
+};
+}
+
+std::string usagi::VulkanGraphicsPipelineCompiler::pipelineKey() const
+{
+    // the fields are written one by one instead of copying the create info
+    // structures, which contain pointers and padding.
+    PipelineKeyWriter w;
+
+    w.write(mShaders.size());
+    for(auto &&shader : mShaders)
+    {
+        auto &bytecodes = shader.second.binary->bytecodes();
+        w.write(shader.first);
+        w.write(shader.second.entry_point);
+        w.write(sha256({
+            reinterpret_cast<const char*>(bytecodes.data()),
+            bytecodes.size() * sizeof(SpirvBinary::Bytecode)
+        }));
+    }
+
+    w.write(mVertexInputBindings.size());
+    for(auto &&b : mVertexInputBindings)
+    {
+        w.write(b.binding);
+        w.write(b.stride);
+        w.write(b.inputRate);
+    }
+    w.write(mVertexAttributeLocationArray.size());
+    for(auto &&a : mVertexAttributeLocationArray)
+    {
+        w.write(a.location);
+        w.write(a.binding);
+        w.write(a.format);
+        w.write(a.offset);
+    }
+
+    w.write(mInputAssemblyStateCreateInfo.topology);
+    w.write(mInputAssemblyStateCreateInfo.primitiveRestartEnable);
+
+    auto &rs = mRasterizationStateCreateInfo;
+    w.write(rs.depthClampEnable);
+    w.write(rs.rasterizerDiscardEnable);
+    w.write(rs.polygonMode);
+    w.write(static_cast<VkCullModeFlags>(rs.cullMode));
+    w.write(rs.frontFace);
+    w.write(rs.depthBiasEnable);
+    w.write(rs.depthBiasConstantFactor);
+    w.write(rs.depthBiasClamp);
+    w.write(rs.depthBiasSlopeFactor);
+    w.write(rs.lineWidth);
+
+    w.write(mMultisampleStateCreateInfo.rasterizationSamples);
+    w.write(mMultisampleStateCreateInfo.minSampleShading);
+
+    auto &ds = mDepthStencilStateCreateInfo;
+    w.write(ds.depthTestEnable);
+    w.write(ds.depthWriteEnable);
+    w.write(ds.depthCompareOp);
+    w.write(ds.depthBoundsTestEnable);
+    w.write(ds.stencilTestEnable);
+
+    auto &cb = mColorBlendAttachmentState;
+    w.write(cb.blendEnable);
+    w.write(cb.srcColorBlendFactor);
+    w.write(cb.dstColorBlendFactor);
+    w.write(cb.colorBlendOp);
+    w.write(cb.srcAlphaBlendFactor);
+    w.write(cb.dstAlphaBlendFactor);
+    w.write(cb.alphaBlendOp);
+    w.write(static_cast<VkColorComponentFlags>(cb.colorWriteMask));
+
+    w.write(mDynamicStates.size());
+    for(auto &&s : mDynamicStates)
+        w.write(s);
+
+    // pipelines can be shared by compatible render passes
+    w.write(mRenderPass->compatibilityKey());
+
+    return w.key();
+}
+
 struct usagi::VulkanGraphicsPipelineCompiler::Context
 {
     // Descriptor Set Layouts
@@ -117,10 +222,8 @@ struct usagi::VulkanGraphicsPipelineCompiler::ReflectionHelper
     Context &ctx;
     VulkanGraphicsPipelineCompiler *p = nullptr;
     const ShaderMap::value_type &shader;
-    const Compiler & compiler;
-    ShaderResources resources;
+    const ShaderReflection &reflection;
     std::size_t push_constant_offset = 0;
-    std::size_t push_constant_size = 0;
     VulkanGraphicsPipeline::PushConstantFieldMap::value_type::second_type &
         push_constant_fields;
 
@@ -131,62 +234,43 @@ struct usagi::VulkanGraphicsPipelineCompiler::ReflectionHelper
         : ctx { ctx }
         , p { pipeline_compiler }
         , shader { shader }
-        , compiler { shader.second.binary->reflectionCompiler() }
-        , resources { compiler.get_shader_resources() }
+        , reflection { shader.second.binary->reflection() }
         , push_constant_fields { ctx.push_constant_field_map[shader.first] }
     {
     }
 
     void reflectPushConstantField(
-        const Resource &resource, const SPIRType &type, unsigned i)
+        const ShaderPushConstantField &member, const bool first)
     {
-        const auto &member_name =
-            compiler.get_member_name(type.self, i);
-        const auto member_offset =
-            compiler.type_struct_member_offset(type, i);
-        const auto member_size =
-            compiler.get_declared_struct_member_size(type, i);
-
         // if first member is named padding, it is considered as offset hint
         // and is ignored.
-        if(i == 0 && member_name == "padding")
+        if(first && member.name == "padding")
         {
-            push_constant_offset = member_size;
+            push_constant_offset = member.size;
             return;
         }
 
         LOG(info, "{}: offset={}, size={}",
-            member_name, member_offset, member_size);
+            member.name, member.offset, member.size);
 
         VulkanPushConstantField field;
-        field.size = static_cast<uint32_t>(member_size);
-        field.offset = static_cast<uint32_t>(member_offset);
+        field.size = member.size;
+        field.offset = member.offset;
 
         // add to reflection record
         // todo: if multiple constant buffers are allowed in the
         // future, member name may not uniquely identify the fields.
         // use struct_name.field_name instead?
-        push_constant_fields[member_name] = field;
-    }
-
-    std::size_t reflectPushConstantBuffer(
-        const Resource &resource)
-    {
-        const auto &type = compiler.get_type(resource.base_type_id);
-        const auto size = compiler.get_declared_struct_size(type);
-
-        const auto member_count = type.member_types.size();
-        for(unsigned i = 0; i < member_count; i++)
-            reflectPushConstantField(resource, type, i);
-
-        return size;
+        push_constant_fields[member.name] = field;
     }
 
     void reflectPushConstantRanges()
     {
-        for(const auto &resource : resources.push_constant_buffers)
-            push_constant_size += reflectPushConstantBuffer(resource);
+        const auto &fields = reflection.push_constant_fields;
+        for(std::size_t i = 0; i < fields.size(); ++i)
+            reflectPushConstantField(fields[i], i == 0);
 
+        const std::size_t push_constant_size = reflection.push_constant_size;
         if(push_constant_size == 0) return;
 
         vk::PushConstantRange range;
@@ -207,82 +291,62 @@ struct usagi::VulkanGraphicsPipelineCompiler::ReflectionHelper
     {
         LOG(info, "Vertex input attribtues:");
 
-        for(auto &&resource : resources.stage_inputs)
+        for(auto &&input : reflection.inputs)
         {
-            const auto location = compiler.get_decoration(
-                resource.id, spv::DecorationLocation);
-
-            LOG(info, "{}: location={}", resource.name, location);
+            LOG(info, "{}: location={}", input.name, input.location);
 
             // normalize to location-based indexing
-            const auto it = p->mVertexAttributeNameMap.find(resource.name);
+            const auto it = p->mVertexAttributeNameMap.find(input.name);
             if(it != p->mVertexAttributeNameMap.end())
             {
-                it->second.location = location;
+                it->second.location = input.location;
                 p->mVertexAttributeLocationArray.push_back(it->second);
                 p->mVertexAttributeNameMap.erase(it);
             }
         }
     }
 
-    void addResource(std::vector<Resource>::value_type &resource,
-        const vk::DescriptorType resource_type) const
+    void addResource(const ShaderResourceBinding &resource) const
     {
         // todo: ensure different stages uses different set indices
-        const auto set = compiler.get_decoration(
-            resource.id, spv::DecorationDescriptorSet);
-        const auto binding = compiler.get_decoration(
-            resource.id, spv::DecorationBinding);
-        const auto &type = compiler.get_type(resource.type_id);
-
         vk::DescriptorSetLayoutBinding layout_binding;
         layout_binding.setStageFlags(translate(shader.first));
-        layout_binding.setBinding(binding);
-        layout_binding.setDescriptorCount(type.vecsize);
-        layout_binding.setDescriptorType(resource_type);
+        layout_binding.setBinding(resource.binding);
+        layout_binding.setDescriptorCount(resource.count);
+        layout_binding.setDescriptorType(translate(resource.type));
 
-        ctx.desc_set_layout_bindings[set].push_back(layout_binding);
+        ctx.desc_set_layout_bindings[resource.set].push_back(layout_binding);
     }
 
-    void ignoreResource(std::vector<Resource>::value_type &resource,
-        const vk::DescriptorType resource_type) const
+    void ignoreResource(const ShaderResourceBinding &resource) const
     {
-        const auto set = compiler.get_decoration(
-            resource.id, spv::DecorationDescriptorSet);
-        const auto binding = compiler.get_decoration(
-            resource.id, spv::DecorationBinding);
-
-        LOG(warn, "{type} {name} (set={},binding={}) is ignored.",
-            to_string(resource_type), resource.name, set, binding);
+        LOG(warn, "{} {} (set={},binding={}) is ignored.",
+            to_string(translate(resource.type)), resource.name,
+            resource.set, resource.binding);
     }
 
     void reflectDescriptorSets()
     {
         LOG(info, "Descriptor set layouts:");
 
-        // todo: deal with others resource types
-
-        for(auto &&resource : resources.storage_buffers)
-            ignoreResource(resource, vk::DescriptorType::eStorageBuffer);
-
-        // sampler2D is not supported in HLSL so not included here.
-        // don't use them in shaders.
-        for(auto &&resource : resources.sampled_images)
-            ignoreResource(resource, vk::DescriptorType::eSampledImage);
-
-        for(auto &&resource : resources.separate_images)
-            addResource(resource, vk::DescriptorType::eSampledImage);
-
-        for(auto &&resource : resources.separate_samplers)
-            addResource(resource, vk::DescriptorType::eSampler);
-
-        for(auto &&resource : resources.uniform_buffers)
-            addResource(resource, vk::DescriptorType::eUniformBuffer);
-
-        // note that only one subpass is used to maintain compatibility
-        // for shader cross-compiling
-        for(auto &&resource : resources.subpass_inputs)
-            addResource(resource, vk::DescriptorType::eInputAttachment);
+        for(auto &&resource : reflection.resources)
+        {
+            switch(resource.type)
+            {
+                // todo: deal with others resource types
+                case ShaderResourceType::STORAGE_BUFFER:
+                // sampler2D is not supported in HLSL so not included here.
+                // don't use them in shaders.
+                case ShaderResourceType::COMBINED_IMAGE_SAMPLER:
+                    ignoreResource(resource);
+                    break;
+                // note that only one subpass is used to maintain
+                // compatibility for shader cross-compiling
+                default:
+                    addResource(resource);
+                    break;
+            }
+        }
     }
 
     // todo auto get render targets?
@@ -301,7 +365,12 @@ std::shared_ptr<usagi::GraphicsPipeline>
 {
     LOG(info, "Compiling graphics pipeline...");
 
-    setupShaderStages();
+    if(!mRenderPass)
+    {
+        LOG(error, "Render pass is not set.");
+        throw std::runtime_error("Render pass is not set.");
+    }
+
     setupDynamicStates();
 
     LOG(info, "Generating pipeline layout...");
@@ -322,19 +391,50 @@ std::shared_ptr<usagi::GraphicsPipeline>
         helper.reflectDescriptorSets();
     }
 
+    auto cache = mDevice->pipelineCache();
+    const auto key = pipelineKey();
+    std::shared_ptr<VulkanGraphicsPipeline> wrapped_pipeline =
+        cache->findPipeline(key);
+    if(wrapped_pipeline)
+    {
+        LOG(info, "Reusing the cached pipeline of the same state");
+    }
+    else
+    {
+        wrapped_pipeline = cache->addPipeline(key, createPipeline(ctx));
+    }
+
+    if(!mParentPipeline)
+    {
+        mParentPipeline = wrapped_pipeline;
+        // if more pipelines are created using this compiler, they will be
+        // the children of the first one. they may also serve as parents
+        // when they are reused from the cache by other compilers.
+        mPipelineCreateInfo.setFlags(
+            vk::PipelineCreateFlagBits::eAllowDerivatives |
+            vk::PipelineCreateFlagBits::eDerivative);
+        mPipelineCreateInfo.setBasePipelineHandle(mParentPipeline->pipeline());
+        mPipelineCreateInfo.setBasePipelineIndex(-1);
+    }
+
+    return std::move(wrapped_pipeline);
+}
+
+std::shared_ptr<usagi::VulkanGraphicsPipeline>
+    usagi::VulkanGraphicsPipelineCompiler::createPipeline(Context &ctx)
+{
+    setupShaderStages();
+
+    auto cache = mDevice->pipelineCache();
+
     vk::UniquePipelineLayout compatible_pipeline_layout;
     {
         vk::PipelineLayoutCreateInfo info;
 
         for(auto &&layout : ctx.desc_set_layout_bindings)
         {
-            vk::DescriptorSetLayoutCreateInfo layout_info;
-            layout_info.setBindingCount(
-                static_cast<uint32_t>(layout.second.size()));
-            layout_info.setPBindings(layout.second.data());
-            auto l = mDevice->device().createDescriptorSetLayoutUnique(
-                layout_info);
-            ctx.desc_set_layout_array.push_back(l.get());
+            auto l = cache->descriptorSetLayout(layout.second);
+            ctx.desc_set_layout_array.push_back(l->get());
             ctx.desc_set_layouts[layout.first] = std::move(l);
         }
         info.setSetLayoutCount(
@@ -353,8 +453,8 @@ std::shared_ptr<usagi::GraphicsPipeline>
     setupVertexInput();
 
     auto pipeline = mDevice->device().createGraphicsPipelineUnique(
-        { }, mPipelineCreateInfo);
-    auto wrapped_pipeline = std::make_shared<VulkanGraphicsPipeline>(
+        cache->pipelineCache(), mPipelineCreateInfo);
+    return std::make_shared<VulkanGraphicsPipeline>(
         std::move(pipeline),
         std::move(compatible_pipeline_layout),
         mRenderPass,
@@ -362,18 +462,6 @@ std::shared_ptr<usagi::GraphicsPipeline>
         std::move(ctx.desc_set_layouts),
         std::move(ctx.push_constant_field_map)
     );
-
-    if(!mParentPipeline)
-    {
-        mParentPipeline = wrapped_pipeline;
-        // if more pipelines are created using this compiler, they will be
-        // the children of the first one
-        mPipelineCreateInfo.setFlags(vk::PipelineCreateFlagBits::eDerivative);
-        mPipelineCreateInfo.setBasePipelineHandle(mParentPipeline->pipeline());
-        mPipelineCreateInfo.setBasePipelineIndex(-1);
-    }
-
-    return std::move(wrapped_pipeline);
 }
 
 usagi::VulkanGraphicsPipelineCompiler::VulkanGraphicsPipelineCompiler(
@@ -45,6 +45,15 @@ class VulkanGraphicsPipelineCompiler final : public GraphicsPipelineCompiler
     struct Context;
     struct ReflectionHelper;
 
+    /**
+     * \brief Create the pipeline and its layout from the reflected shader
+     * interface, sharing the descriptor set layouts through the pipeline
+     * cache of the device.
+     * \param ctx
+     * \return
+     */
+    std::shared_ptr<VulkanGraphicsPipeline> createPipeline(Context &ctx);
+
     using VertexInputBindingArray = std::vector<
         vk::VertexInputBindingDescription>;
     VertexInputBindingArray mVertexInputBindings;
@@ -62,6 +71,14 @@ class VulkanGraphicsPipelineCompiler final : public GraphicsPipelineCompiler
     void setupVertexInput();
     void setupDynamicStates();
 
+    /**
+     * \brief Serialize all the states affecting the compiled pipeline,
+     * which identifies it in the pipeline cache of the device. Vertex
+     * attributes must have been resolved to locations.
+     * \return
+     */
+    std::string pipelineKey() const;
+
     // Pipeline derivatives support
     std::shared_ptr<VulkanGraphicsPipeline> mParentPipeline;
 
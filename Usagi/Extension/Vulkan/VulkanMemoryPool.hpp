@@ -4,6 +4,7 @@
 
 #include <Usagi/Utility/Noncopyable.hpp>
 #include <Usagi/Runtime/Graphics/GpuImageCreateInfo.hpp>
+#include <Usagi/Runtime/Memory/AllocatorStats.hpp>
 
 #include "VulkanBufferAllocation.hpp"
 #include "VulkanPooledImage.hpp"
@@ -50,6 +51,7 @@ public:
     virtual ~VulkanMemoryPool();
 
     virtual void deallocate(std::size_t offset) = 0;
+    virtual AllocatorStats stats() const = 0;
 
     VulkanGpuDevice * device() const { return mDevice; }
     vk::DeviceMemory memory() const { return mMemory.get(); }
@@ -117,6 +119,10 @@ public:
     {
         mAllocator->deallocate(reinterpret_cast<void*>(offset));
     }
+
+    AllocatorStats stats() const override { return mAllocator->stats(); }
+
+    Allocator * allocator() const { return mAllocator.get(); }
 };
 
 template <typename Allocator>
@@ -173,5 +179,7 @@ public:
     {
         mAllocator->deallocate(reinterpret_cast<void*>(offset));
     }
+
+    AllocatorStats stats() const override { return mAllocator->stats(); }
 };
 }
@@ -0,0 +1,176 @@
+﻿#include "VulkanPipelineCache.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <Usagi/Core/Logging.hpp>
+#include <Usagi/Utility/MappedFile.hpp>
+
+#include "VulkanGpuDevice.hpp"
+#include "VulkanGraphicsPipeline.hpp"
+
+usagi::VulkanPipelineCache::VulkanPipelineCache(
+    VulkanGpuDevice *device,
+    std::optional<std::filesystem::path> cache_file)
+    : mDevice { device }
+    , mCacheFile { std::move(cache_file) }
+{
+    const auto data = readCacheFile();
+    vk::PipelineCacheCreateInfo info;
+    info.setInitialDataSize(data.size());
+    info.setPInitialData(data.data());
+    mPipelineCache = mDevice->device().createPipelineCacheUnique(info);
+}
+
+std::vector<char> usagi::VulkanPipelineCache::readCacheFile() const
+{
+    if(!mCacheFile || !exists(*mCacheFile))
+        return { };
+
+    MemoryView content;
+    try
+    {
+        content = mapFile(*mCacheFile);
+    }
+    catch(const std::exception &e)
+    {
+        LOG(warn, "Could not read the pipeline cache: {}", e.what());
+        return { };
+    }
+
+    // some drivers do not validate the data, so check that it was written
+    // by the same driver and device before passing it in.
+    struct Header
+    {
+        std::uint32_t size;
+        std::uint32_t version;
+        std::uint32_t vendor_id;
+        std::uint32_t device_id;
+        std::uint8_t uuid[VK_UUID_SIZE];
+    } header;
+    if(content.size() < sizeof(header))
+        return { };
+    std::memcpy(&header, content.data(), sizeof(header));
+
+    const auto properties = mDevice->physicalDevice().getProperties();
+    if(header.size < sizeof(header) ||
+        header.version != static_cast<std::uint32_t>(
+            vk::PipelineCacheHeaderVersion::eOne) ||
+        header.vendor_id != properties.vendorID ||
+        header.device_id != properties.deviceID ||
+        std::memcmp(header.uuid, properties.pipelineCacheUUID.data(),
+            VK_UUID_SIZE) != 0)
+    {
+        LOG(info, "Discarding the pipeline cache of another device or driver");
+        return { };
+    }
+
+    LOG(info, "Loaded {} bytes of pipeline cache", content.size());
+    const auto begin = static_cast<const char*>(content.data());
+    return { begin, begin + content.size() };
+}
+
+template <typename Map>
+void usagi::VulkanPipelineCache::removeExpired(Map &map)
+{
+    for(auto i = map.begin(); i != map.end();)
+    {
+        if(i->second.expired())
+            i = map.erase(i);
+        else
+            ++i;
+    }
+}
+
+std::shared_ptr<usagi::VulkanGraphicsPipeline>
+    usagi::VulkanPipelineCache::findPipeline(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    const auto i = mPipelines.find(key);
+    if(i == mPipelines.end())
+        return { };
+    return i->second.lock();
+}
+
+std::shared_ptr<usagi::VulkanGraphicsPipeline>
+    usagi::VulkanPipelineCache::addPipeline(
+        const std::string &key,
+        std::shared_ptr<VulkanGraphicsPipeline> pipeline)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto &entry = mPipelines[key];
+    if(auto existing = entry.lock())
+        return existing;
+    entry = pipeline;
+    removeExpired(mPipelines);
+    return pipeline;
+}
+
+std::shared_ptr<vk::UniqueDescriptorSetLayout>
+    usagi::VulkanPipelineCache::descriptorSetLayout(
+        const std::vector<vk::DescriptorSetLayoutBinding> &bindings)
+{
+    // immutable samplers are not used
+    std::string key;
+    key.reserve(bindings.size() * 4 * sizeof(std::uint32_t));
+    const auto append = [&](const std::uint32_t value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    for(auto &&b : bindings)
+    {
+        append(b.binding);
+        append(static_cast<std::uint32_t>(b.descriptorType));
+        append(b.descriptorCount);
+        append(static_cast<VkShaderStageFlags>(b.stageFlags));
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto &entry = mDescriptorSetLayouts[key];
+    if(auto existing = entry.lock())
+        return existing;
+
+    vk::DescriptorSetLayoutCreateInfo info;
+    info.setBindingCount(static_cast<uint32_t>(bindings.size()));
+    info.setPBindings(bindings.data());
+    auto layout = std::make_shared<vk::UniqueDescriptorSetLayout>(
+        mDevice->device().createDescriptorSetLayoutUnique(info));
+    entry = layout;
+    removeExpired(mDescriptorSetLayouts);
+    return layout;
+}
+
+void usagi::VulkanPipelineCache::save() const
+{
+    if(!mCacheFile) return;
+
+    const auto data = mDevice->device().getPipelineCacheData(
+        mPipelineCache.get());
+
+    std::error_code ec;
+    create_directories(mCacheFile->parent_path(), ec);
+    // written to a temporary file first to not leave a truncated cache if
+    // the program is killed in the middle
+    auto temp_file = *mCacheFile;
+    temp_file += ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if(!out)
+        {
+            LOG(warn, "Could not write the pipeline cache: {}",
+                temp_file.u8string());
+            return;
+        }
+    }
+    std::filesystem::rename(temp_file, *mCacheFile, ec);
+    if(ec)
+    {
+        LOG(warn, "Could not save the pipeline cache: {}", ec.message());
+        std::filesystem::remove(temp_file, ec);
+        return;
+    }
+    LOG(info, "Saved {} bytes of pipeline cache", data.size());
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
+{
+class VulkanGpuDevice;
+class VulkanGraphicsPipeline;
+
+/**
+ * \brief Device-level cache of pipeline state objects. Pipelines compiled
+ * from identical states are shared by all pipeline compilers, as are the
+ * descriptor set layouts with identical bindings. Only weak references are
+ * kept so the objects are released when no longer used. The driver's
+ * VkPipelineCache is persisted in a file to speed up compiling the same
+ * pipelines in later runs. Thread-safe.
+ */
+class VulkanPipelineCache : Noncopyable
+{
+    VulkanGpuDevice *mDevice = nullptr;
+    std::optional<std::filesystem::path> mCacheFile;
+    vk::UniquePipelineCache mPipelineCache;
+
+    std::mutex mLock;
+    std::unordered_map<std::string, std::weak_ptr<VulkanGraphicsPipeline>>
+        mPipelines;
+    std::unordered_map<std::string,
+        std::weak_ptr<vk::UniqueDescriptorSetLayout>> mDescriptorSetLayouts;
+
+    /**
+     * \brief Read the cache file if it was written by the same driver and
+     * device.
+     * \return Empty if the data is missing or incompatible.
+     */
+    std::vector<char> readCacheFile() const;
+
+    template <typename Map>
+    static void removeExpired(Map &map);
+
+public:
+    /**
+     * \brief
+     * \param device
+     * \param cache_file If specified, the driver cache is initialized from
+     * the file and saved to it by save().
+     */
+    VulkanPipelineCache(
+        VulkanGpuDevice *device,
+        std::optional<std::filesystem::path> cache_file);
+
+    vk::PipelineCache pipelineCache() const { return mPipelineCache.get(); }
+
+    /**
+     * \brief
+     * \param key The full state used to compile the pipeline.
+     * \return The pipeline previously compiled from the state if it is still
+     * alive, or null.
+     */
+    std::shared_ptr<VulkanGraphicsPipeline> findPipeline(
+        const std::string &key);
+
+    /**
+     * \brief Make the pipeline available to compilations of the same state.
+     * \param key
+     * \param pipeline
+     * \return The pipeline in the cache, which is a different one if another
+     * thread added the same state first.
+     */
+    std::shared_ptr<VulkanGraphicsPipeline> addPipeline(
+        const std::string &key,
+        std::shared_ptr<VulkanGraphicsPipeline> pipeline);
+
+    /**
+     * \brief Get a descriptor set layout with the bindings, which is created
+     * if there is no such layout alive.
+     * \param bindings
+     * \return
+     */
+    std::shared_ptr<vk::UniqueDescriptorSetLayout> descriptorSetLayout(
+        const std::vector<vk::DescriptorSetLayoutBinding> &bindings);
+
+    /**
+     * \brief Write the driver cache into the cache file. Pipelines should not
+     * be compiled concurrently.
+     */
+    void save() const;
+};
+}
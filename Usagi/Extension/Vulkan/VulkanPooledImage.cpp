@@ -24,11 +24,20 @@ usagi::VulkanPooledImage::~VulkanPooledImage()
 }
 
 void usagi::VulkanPooledImage::upload(const void *data, const std::size_t size)
+{
+    upload(size, [&](void *staging) {
+        memcpy(staging, data, size);
+    });
+}
+
+void usagi::VulkanPooledImage::upload(
+    const std::size_t size,
+    const std::function<void(void *staging)> &write)
 {
     assert(size <= mBufferSize);
 
     auto device = mPool->device();
     const auto buffer = device->allocateStageBuffer(size);
-    memcpy(buffer->mappedAddress(), data, size);
+    write(buffer->mappedAddress());
     device->copyBufferToImage(buffer, this);
 }
@@ -26,6 +26,9 @@ public:
     ~VulkanPooledImage();
 
     void upload(const void *data, std::size_t size) override;
+    void upload(
+        std::size_t size,
+        const std::function<void(void *staging)> &write) override;
 
     vk::Image image() const override { return mImage.get(); }
     std::size_t offset() const { return mBufferOffset; }
@@ -68,5 +68,22 @@ usagi::VulkanRenderPass::VulkanRenderPass(
     vk_info.setSubpassCount(1);
     vk_info.setPSubpasses(&subpass);
 
+    // layouts and load/store operations do not affect compatibility
+    const auto append_key = [&](const std::uint32_t value) {
+        mCompatibilityKey.append(
+            reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    append_key(static_cast<std::uint32_t>(attachment_descriptions.size()));
+    for(auto &&d : attachment_descriptions)
+    {
+        append_key(static_cast<std::uint32_t>(d.format));
+        append_key(static_cast<std::uint32_t>(d.samples));
+    }
+    append_key(static_cast<std::uint32_t>(color_refs.size()));
+    for(auto &&r : color_refs)
+        append_key(r.attachment);
+    append_key(subpass.pDepthStencilAttachment
+        ? ds_ref.attachment : VK_ATTACHMENT_UNUSED);
+
     mRenderPass = device->device().createRenderPassUnique(vk_info);
 }
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <string>
+
 #include <vulkan/vulkan.hpp>
 
 #include <Usagi/Runtime/Graphics/RenderPass.hpp>
@@ -13,6 +15,7 @@ class VulkanRenderPass : public RenderPass
 {
     vk::UniqueRenderPass mRenderPass;
     std::vector<vk::ClearValue> mClearValues;
+    std::string mCompatibilityKey;
 
 public:
     VulkanRenderPass(VulkanGpuDevice *device, const RenderPassCreateInfo &info);
@@ -23,5 +26,17 @@ public:
     {
         return mClearValues;
     }
+
+    /**
+     * \brief Identifies the render passes compatible with this one, which
+     * share the formats and sample counts of the attachments and how the
+     * subpass references them. Pipelines created for one of them can be used
+     * with the others.
+     * \return
+     */
+    const std::string & compatibilityKey() const
+    {
+        return mCompatibilityKey;
+    }
 };
 }
@@ -23,5 +23,12 @@ public:
     {
         throw std::runtime_error("Operation not supported.");
     }
+
+    void upload(
+        std::size_t size,
+        const std::function<void(void *staging)> &write) override
+    {
+        throw std::runtime_error("Operation not supported.");
+    }
 };
 }
@@ -1,11 +1,9 @@
 ﻿#pragma once
 
-#include <tuple>
-#include <map>
-
 #include <Usagi/Core/Element.hpp>
 #include <Usagi/Core/Logging.hpp>
 
+#include "ElementRegistry.hpp"
 #include "System.hpp"
 
 namespace usagi
@@ -14,27 +12,51 @@ template <typename... RequiredComponents>
 class CollectionSystem : virtual public System
 {
 protected:
-    using ComponentVector = std::tuple<RequiredComponents *...>;
-    using Registry = std::map<Element *, ComponentVector>;
+    using Registry = ElementRegistry<RequiredComponents...>;
     Registry mRegistry;
 
+    static const ComponentMask & requiredComponents()
+    {
+        static const auto mask = componentMask<RequiredComponents...>();
+        return mask;
+    }
+
+    /**
+     * \brief Invoke the function on each element having all the required
+     * components.
+     * \tparam Func void(Element *, RequiredComponents &...)
+     * \param func
+     */
+    template <typename Func>
+    void forEach(Func &&func)
+    {
+        mRegistry.forEach(std::forward<Func>(func));
+    }
+
 public:
+    ComponentMask componentSignature() const override
+    {
+        return requiredComponents();
+    }
+
     void onElementComponentChanged(Element *element) override
     {
-        const ComponentVector vec = {
-            element->findComponent<RequiredComponents>()...
-        };
+        const auto &required = requiredComponents();
         const auto processable =
-            (... && (std::get<RequiredComponents*>(vec) != nullptr));
+            (element->componentMask() & required) == required;
         if(processable)
         {
-            LOG(debug, "Registering\n"
-                "    Element {}: {} at\n"
-                "    System  {}: {}",
-                static_cast<void*>(element), element->path(),
-                static_cast<void*>(this), typeid(*this).name()
-            );
-            mRegistry.insert_or_assign(element, std::move(vec));
+            const auto inserted = mRegistry.insertOrAssign(
+                element, element->getComponent<RequiredComponents>()...);
+            if(inserted)
+            {
+                LOG(debug, "Registering\n"
+                    "    Element {}: {} at\n"
+                    "    System  {}: {}",
+                    static_cast<void*>(element), element->path(),
+                    static_cast<void*>(this), typeid(*this).name()
+                );
+            }
         }
         else
         {
@@ -0,0 +1,159 @@
+﻿#pragma once
+
+#include <cassert>
+#include <tuple>
+#include <vector>
+
+#include <Usagi/Core/Element.hpp>
+
+namespace usagi
+{
+/**
+ * \brief A sparse set of elements along with pointers to their components.
+ * Elements and each type of component pointers are kept in their own dense
+ * arrays, so iteration is linear. The sparse array maps the slot index of
+ * element handles to the positions in the dense arrays. Insertion and
+ * removal are O(1); removal moves the last entry into the vacated position,
+ * so the iteration order is not stable. Entries are matched by the handles of
+ * the elements, so an entry left behind by a destroyed element is never
+ * confused with a new element reusing its slot or its address.
+ * \tparam Components
+ */
+template <typename... Components>
+class ElementRegistry
+{
+    static constexpr std::size_t NO_ENTRY = static_cast<std::size_t>(-1);
+
+    std::vector<Element *> mElements;
+    // the handles are compared instead of the pointers since the elements
+    // of stale entries may have been freed
+    std::vector<ElementHandle> mHandles;
+    std::tuple<std::vector<Components *>...> mComponents;
+    std::vector<std::size_t> mSparse;
+
+    std::size_t findSlot(const std::uint32_t slot) const
+    {
+        return slot < mSparse.size() ? mSparse[slot] : NO_ENTRY;
+    }
+
+    std::size_t find(const Element *element) const
+    {
+        const auto handle = element->handle();
+        const auto i = findSlot(handle.index);
+        // a slot may have been reused by another element after the
+        // previous one was destroyed without being erased
+        return i != NO_ENTRY && mHandles[i] == handle ? i : NO_ENTRY;
+    }
+
+    void eraseAt(const std::size_t i)
+    {
+        const auto last = mElements.size() - 1;
+        mSparse[mHandles[i].index] = NO_ENTRY;
+        if(i != last)
+        {
+            mElements[i] = mElements[last];
+            mHandles[i] = mHandles[last];
+            mSparse[mHandles[i].index] = i;
+            ((std::get<std::vector<Components *>>(mComponents)[i] =
+                std::get<std::vector<Components *>>(mComponents)[last]), ...);
+        }
+        mElements.pop_back();
+        mHandles.pop_back();
+        (std::get<std::vector<Components *>>(mComponents).pop_back(), ...);
+    }
+
+    template <typename Func, std::size_t... I>
+    void invoke(Func &func, const std::size_t i, std::index_sequence<I...>)
+    {
+        func(mElements[i], *std::get<I>(mComponents)[i]...);
+    }
+
+public:
+    std::size_t size() const { return mElements.size(); }
+    bool empty() const { return mElements.empty(); }
+
+    bool contains(Element *element) const
+    {
+        return find(element) != NO_ENTRY;
+    }
+
+    /**
+     * \brief Insert the element or update the pointers to its components.
+     * \param element
+     * \param components
+     * \return true if the element was newly inserted.
+     */
+    bool insertOrAssign(Element *element, Components *... components)
+    {
+        const auto i = find(element);
+        if(i != NO_ENTRY)
+        {
+            ((std::get<std::vector<Components *>>(mComponents)[i]
+                = components), ...);
+            return false;
+        }
+        const auto handle = element->handle();
+        // drop the stale entry of the previous element in the slot
+        if(const auto stale = findSlot(handle.index); stale != NO_ENTRY)
+            eraseAt(stale);
+        if(handle.index >= mSparse.size())
+            mSparse.resize(handle.index + 1, NO_ENTRY);
+        mSparse[handle.index] = mElements.size();
+        mElements.push_back(element);
+        mHandles.push_back(handle);
+        (std::get<std::vector<Components *>>(mComponents)
+            .push_back(components), ...);
+        return true;
+    }
+
+    bool erase(Element *element)
+    {
+        const auto i = find(element);
+        if(i == NO_ENTRY)
+            return false;
+        eraseAt(i);
+        return true;
+    }
+
+    void clear()
+    {
+        mElements.clear();
+        mHandles.clear();
+        (std::get<std::vector<Components *>>(mComponents).clear(), ...);
+        mSparse.clear();
+    }
+
+    Element * element(const std::size_t i) const
+    {
+        assert(i < size());
+        return mElements[i];
+    }
+
+    template <typename Component>
+    Component * component(const std::size_t i) const
+    {
+        assert(i < size());
+        return std::get<std::vector<Component *>>(mComponents)[i];
+    }
+
+    const std::vector<Element *> & elements() const { return mElements; }
+
+    template <typename Component>
+    const std::vector<Component *> & components() const
+    {
+        return std::get<std::vector<Component *>>(mComponents);
+    }
+
+    /**
+     * \brief Invoke the function on each registered element.
+     * \tparam Func void(Element *, Components &...)
+     * \param func
+     */
+    template <typename Func>
+    void forEach(Func func)
+    {
+        for(std::size_t i = 0; i < mElements.size(); ++i)
+            invoke(func, i, std::index_sequence_for<Components...> { });
+    }
+};
+}
@@ -11,7 +11,9 @@
 usagi::Game::Game(std::shared_ptr<Runtime> runtime)
     : mRuntime(std::move(runtime))
 {
-    mAssetRoot = mRootElement.addChild<AssetRoot>("Assets");
+    mRootElement.setEventQueue(&mEventQueue);
+    mRootElement.setArena(&mElementArena);
+    mAssetRoot = mRootElement.addChild<AssetRoot>("Assets", &mJobSystem);
     mStateManager = mRootElement.addChild<GameStateManager>("States", this);
 
     mRuntime->initWindow();
@@ -37,6 +39,8 @@ void usagi::Game::updateClock()
 
 void usagi::Game::performDeferredActions()
 {
+    // deliver the events deferred during this frame
+    mEventQueue.flush();
     for(auto &&a : mDeferredActions)
     {
         a();
@@ -48,6 +52,7 @@ void usagi::Game::frame()
 {
     processInput();
     mStateManager->update(mMasterClock);
+    mJobSystem.runMainThreadJobs();
     performDeferredActions();
     updateClock();
 }
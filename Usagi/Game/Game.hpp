@@ -6,6 +6,8 @@
 
 #include <Usagi/Core/Clock.hpp>
 #include <Usagi/Core/Element.hpp>
+#include <Usagi/Core/Event/EventQueue.hpp>
+#include <Usagi/Core/Job/JobSystem.hpp>
 #include <Usagi/Utility/Noncopyable.hpp>
 
 namespace usagi
@@ -19,6 +21,10 @@ class Game : Noncopyable
 protected:
     // Multiple Game may use the same runtime & asset provider
     std::shared_ptr<Runtime> mRuntime;
+    // Declared before the elements so that it outlives them
+    JobSystem mJobSystem;
+    EventQueue mEventQueue;
+    ElementArena mElementArena;
     Element mRootElement { nullptr };
     AssetRoot *mAssetRoot = nullptr;
     GameStateManager *mStateManager = nullptr;
@@ -40,6 +46,16 @@ public:
     void addDeferredAction(DeferredAction action);
 
     Runtime * runtime() const { return mRuntime.get(); }
+    JobSystem * jobs() { return &mJobSystem; }
+
+    /**
+     * \brief Queue of the events deferred by the elements of this game,
+     * flushed at the end of each frame. Disabled by default. Enabling it
+     * allows bulk creation and destruction of elements without notifying
+     * the subsystems for every component.
+     * \return
+     */
+    EventQueue * events() { return &mEventQueue; }
     AssetRoot * assets() const { return mAssetRoot; }
     GameStateManager * states() const { return mStateManager; }
 
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include <Usagi/Core/Event/Library/Component/ComponentAddedEvent.hpp>
+#include <Usagi/Core/Event/Library/Component/ComponentsChangedEvent.hpp>
 #include <Usagi/Core/Event/Library/Component/PreComponentRemovalEvent.hpp>
 #include <Usagi/Core/Event/Library/Component/PostComponentRemovalEvent.hpp>
 
@@ -11,19 +12,39 @@
 usagi::GameState::GameState(Element *parent, std::string name)
     : Element(parent, std::move(name))
 {
-    const auto system_listener = [&](auto &&e) {
-        for(auto &&s : mSystems)
+    setArena(&mElementArena);
+
+    const auto system_listener = [&](ComponentEvent &e) {
+        for(auto &&s : mComponentObservers[e.type_id])
         {
-            s.subsystem->onElementComponentChanged(e.source());
+            s->onElementComponentChanged(e.source());
         }
     };
 
-    // add listeners at root entity to allow each subsystem to examine
-    // entities with updated component configurations.
-    // todo: directly pass the events to the subsystems?
+    // add listeners at root entity to allow the subsystems interested in
+    // the component type to examine entities with updated component
+    // configurations.
     addEventListener<ComponentAddedEvent>(system_listener);
     //mRootElement.addEventListener<PreComponentRemovalEvent>(system_listener);
     addEventListener<PostComponentRemovalEvent>(system_listener);
+    // changes sent when queueing is enabled: coalesced additions flushed
+    // from the queue, and removals sent immediately. each subsystem is
+    // notified at most once per event.
+    addEventListener<ComponentsChangedEvent>([&](ComponentsChangedEvent &e) {
+        for(auto &&s : mSystems)
+        {
+            if((s.signature & e.changed).any())
+                s.subsystem->onElementComponentChanged(e.source());
+        }
+    });
+}
+
+usagi::GameState::~GameState()
+{
+    // destroy the children and components while the subsystems and the
+    // component change listeners are still alive.
+    clearChildren();
+    eraseAllComponents();
 }
 
 std::vector<usagi::SystemInfo>::iterator
@@ -43,6 +64,7 @@ void usagi::GameState::setSystemEnabled(
     if(iter == mSystems.end())
         throw std::runtime_error("No such subsystem");
     iter->enabled = enabled;
+    mSchedulerDirty = true;
 }
 
 usagi::System * usagi::GameState::addSystemPtr(
@@ -59,7 +81,16 @@ usagi::System * usagi::GameState::addSystemPtr(
         throw std::runtime_error("System name already used.");
     }
     const auto ptr = info.subsystem.get();
+    info.signature = ptr->componentSignature();
     mSystems.push_back(std::move(info));
+    mSchedulerDirty = true;
+
+    const auto &signature = mSystems.back().signature;
+    for(std::size_t i = 0; i < MAX_COMPONENT_TYPES; ++i)
+    {
+        if(signature.test(i))
+            mComponentObservers[i].push_back(ptr);
+    }
     subsystemFilter(ptr);
     return ptr;
 }
@@ -76,9 +107,15 @@ void usagi::GameState::disableSystem(const std::string &subsystem_name)
 
 void usagi::GameState::update(const Clock &clock)
 {
-    for(auto &&s : mSystems)
+    if(mSchedulerDirty)
     {
-        if(s.enabled)
-            s.subsystem->update(clock);
+        mScheduler.clear();
+        for(auto &&s : mSystems)
+        {
+            if(s.enabled)
+                mScheduler.addSystem(s.subsystem.get());
+        }
+        mSchedulerDirty = false;
     }
+    mScheduler.update(clock, mJobSystem);
 }
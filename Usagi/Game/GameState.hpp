@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <array>
 #include <string>
 #include <memory>
 #include <vector>
@@ -9,13 +10,17 @@
 #include <Usagi/Utility/TypeCast.hpp>
 
 #include "System.hpp"
+#include "SystemScheduler.hpp"
 
 namespace usagi
 {
+class JobSystem;
+
 struct SystemInfo
 {
     std::string name;
     std::unique_ptr<System> subsystem;
+    ComponentMask signature;
     bool enabled = true;
 };
 
@@ -24,6 +29,14 @@ class GameState : public Element
     friend class GameStateManager;
 
 protected:
+    /**
+     * \brief Backs the elements and components created within this state.
+     * Declared first so that it is destroyed after all other members. When
+     * the state is popped, its pools are released at once instead of
+     * returning each object to the heap.
+     */
+    ElementArena mElementArena;
+
     /**
      * \brief Maintain a linked list of states. A state can use this to
      * access state below its own position on the state stack.
@@ -33,6 +46,25 @@ protected:
     std::vector<SystemInfo> mSystems;
     Clock mClock;
 
+    /**
+     * \brief Subsystems to be notified of component changes, indexed by
+     * component type id. Built from the component signatures of the
+     * subsystems in the order of their registration.
+     */
+    std::array<std::vector<System *>, MAX_COMPONENT_TYPES> mComponentObservers;
+
+    /**
+     * \brief Dependency graph of the enabled subsystems. Rebuilt before the
+     * next update when subsystems are added, enabled, or disabled.
+     */
+    SystemScheduler mScheduler;
+    bool mSchedulerDirty = true;
+
+    /**
+     * \brief Set by the state manager when the state is pushed.
+     */
+    JobSystem *mJobSystem = nullptr;
+
     std::vector<SystemInfo>::iterator findSystemByName(
         const std::string &subsystem_name);
 
@@ -48,6 +80,7 @@ protected:
 
 public:
     GameState(Element *parent, std::string name);
+    ~GameState();
 
     template <typename SystemT>
     SystemT * addSystem(
@@ -73,8 +106,9 @@ public:
     void disableSystem(const std::string &subsystem_name);
 
     /**
-     * \brief Invoke update methods on each enabled subsystem by the order
-     * of their registration.
+     * \brief Invoke update methods on each enabled subsystem. Subsystems
+     * with conflicting component accesses are updated by the order of their
+     * registration, while the others may be updated concurrently.
      * \param clock
      */
     virtual void update(const Clock &clock);
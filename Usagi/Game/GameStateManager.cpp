@@ -40,6 +40,7 @@ void usagi::GameStateManager::pushState(GameState *state, bool pause_below)
         LOG(info, "pushState: {}", state->name());
         // chain the states
         state->mPreviousState = mTopState;
+        state->mJobSystem = mGame->jobs();
         if(mTopState && pause_below)
             mTopState->pause();
         // push state
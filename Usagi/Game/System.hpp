@@ -2,6 +2,7 @@
 
 #include <typeinfo>
 
+#include <Usagi/Core/Storage/ComponentType.hpp>
 #include <Usagi/Utility/Noncopyable.hpp>
 
 namespace usagi
@@ -9,6 +10,36 @@ namespace usagi
 class Clock;
 class Element;
 
+/**
+ * \brief The component types read and written by System::update(). Used by
+ * the system scheduler to find the subsystems that can be updated
+ * concurrently.
+ */
+struct ComponentAccess
+{
+    ComponentMask read;
+    ComponentMask write;
+
+    /**
+     * \brief The update may access anything, so it conflicts with every
+     * other one, including those not accessing any component.
+     */
+    bool exclusive = false;
+
+    /**
+     * \brief Two accesses conflict if either one is exclusive or writes a
+     * component type accessed by the other.
+     * \param other
+     * \return
+     */
+    bool conflictsWith(const ComponentAccess &other) const
+    {
+        return exclusive || other.exclusive ||
+            (write & (other.read | other.write)).any() ||
+            (other.write & read).any();
+    }
+};
+
 class System : Noncopyable
 {
 public:
@@ -21,13 +52,38 @@ public:
     virtual void update(const Clock &clock) = 0;
 
     /**
-     * \brief Called every time when a component is added or removed.
-     * The subsystem can inspect the element to decide to record it or
-     * remove it from the record.
+     * \brief Called every time when a component of a type in the signature
+     * is added or removed. The subsystem can inspect the element to decide
+     * to record it or remove it from the record.
      * \param element
      */
     virtual void onElementComponentChanged(Element *element) = 0;
 
+    /**
+     * \brief The set of component types this subsystem is interested in.
+     * Changes of other component types are not dispatched to the subsystem.
+     * Includes all types by default.
+     * \return
+     */
+    virtual ComponentMask componentSignature() const
+    {
+        return ComponentMask { }.set();
+    }
+
+    /**
+     * \brief The component types accessed by update(). Subsystems whose
+     * accesses do not conflict may be updated concurrently on different
+     * threads, so update() must not touch anything outside the declared
+     * components or its own members, nor modify the element hierarchy.
+     * The update is exclusive by default. Subsystems invoking user
+     * callbacks during update should keep the default.
+     * \return
+     */
+    virtual ComponentAccess componentAccess() const
+    {
+        return { { }, { }, true };
+    }
+
     virtual const std::type_info & type() = 0;
 };
 }
@@ -0,0 +1,115 @@
+﻿#include "SystemScheduler.hpp"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <Usagi/Core/Job/JobSystem.hpp>
+
+void usagi::SystemScheduler::clear()
+{
+    mNodes.clear();
+    mBatchBegin = 0;
+}
+
+void usagi::SystemScheduler::addSystem(System *system)
+{
+    Node node;
+    node.system = system;
+    node.access = system->componentAccess();
+
+    const auto index = mNodes.size();
+    if(node.access.exclusive)
+    {
+        // ordered against the other subsystems by the batches
+        mBatchBegin = index + 1;
+    }
+    else
+    {
+        for(auto i = mBatchBegin; i < index; ++i)
+        {
+            if(mNodes[i].access.conflictsWith(node.access))
+            {
+                mNodes[i].successors.push_back(index);
+                ++node.num_predecessors;
+            }
+        }
+    }
+    mNodes.push_back(std::move(node));
+}
+
+void usagi::SystemScheduler::update(const Clock &clock, JobSystem *jobs)
+{
+    const auto num_nodes = mNodes.size();
+    std::size_t begin = 0;
+    for(std::size_t i = 0; i < num_nodes; ++i)
+    {
+        if(!mNodes[i].access.exclusive) continue;
+        updateBatch(clock, jobs, begin, i);
+        mNodes[i].system->update(clock);
+        begin = i + 1;
+    }
+    updateBatch(clock, jobs, begin, num_nodes);
+}
+
+void usagi::SystemScheduler::updateBatch(
+    const Clock &clock,
+    JobSystem *jobs,
+    const std::size_t begin,
+    const std::size_t end)
+{
+    if(jobs == nullptr || jobs->workerCount() == 0 || end - begin < 2)
+    {
+        for(auto i = begin; i < end; ++i)
+            mNodes[i].system->update(clock);
+        return;
+    }
+
+    const auto remaining =
+        std::make_unique<std::atomic<std::size_t>[]>(end - begin);
+    for(auto i = begin; i < end; ++i)
+        remaining[i - begin] = mNodes[i].num_predecessors;
+
+    // successors are submitted before their predecessor finishes, so the
+    // counter does not reach zero before all subsystems are updated
+    JobCounter counter;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+    std::mutex exception_lock;
+
+    std::function<void(std::size_t)> run = [&](const std::size_t i) {
+        if(!failed)
+        {
+            try
+            {
+                mNodes[i].system->update(clock);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(exception_lock);
+                if(!exception) exception = std::current_exception();
+                failed = true;
+            }
+        }
+        for(auto &&s : mNodes[i].successors)
+        {
+            if(--remaining[s - begin] == 0)
+                jobs->submit([&run, s]() { run(s); }, &counter);
+        }
+    };
+
+    // the thread owning the queue takes the jobs from its back, so the
+    // independent subsystems are submitted in reverse order to start the
+    // first added one first.
+    for(auto i = end; i-- > begin;)
+    {
+        if(mNodes[i].num_predecessors == 0)
+            jobs->submit([&run, i]() { run(i); }, &counter);
+    }
+    jobs->wait(counter);
+
+    if(exception)
+        std::rethrow_exception(exception);
+}
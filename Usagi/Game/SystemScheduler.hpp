@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "System.hpp"
+
+namespace usagi
+{
+class JobSystem;
+
+/**
+ * \brief Updates a set of subsystems following the dependencies implied by
+ * their component accesses. A subsystem depends on every subsystem added
+ * before it whose access conflicts with its own, so conflicting subsystems
+ * are always updated in the order of their addition while the others may
+ * be updated concurrently.
+ *
+ * Exclusive subsystems conflict with all others and divide the subsystems
+ * into batches. They are updated on the calling thread between the batches,
+ * and only the batches of the other subsystems are submitted as jobs.
+ */
+class SystemScheduler
+{
+    struct Node
+    {
+        System *system = nullptr;
+        ComponentAccess access;
+        // within the batch
+        std::vector<std::size_t> successors;
+        std::size_t num_predecessors = 0;
+    };
+
+    std::vector<Node> mNodes;
+    // the first node of the batch the next non-exclusive node joins
+    std::size_t mBatchBegin = 0;
+
+    void updateBatch(
+        const Clock &clock,
+        JobSystem *jobs,
+        std::size_t begin,
+        std::size_t end);
+
+public:
+    void clear();
+
+    /**
+     * \brief Add a subsystem after the previously added ones.
+     * \param system
+     */
+    void addSystem(System *system);
+
+    std::size_t size() const { return mNodes.size(); }
+
+    /**
+     * \brief Update all subsystems. Returns when all updates finished.
+     * If any update throws, the updates not yet started are skipped and
+     * the first exception is rethrown.
+     * \param clock
+     * \param jobs If null or has no worker, the subsystems are updated
+     * serially on the calling thread.
+     */
+    void update(const Clock &clock, JobSystem *jobs);
+};
+}
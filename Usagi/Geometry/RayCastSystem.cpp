@@ -9,14 +9,13 @@ std::optional<usagi::Intersection> usagi::RayCastSystem::intersect(
 {
     Intersection x;
     // todo make it more efficient
-    for(auto e : mRegistry)
-    {
-        if(std::get<ShapeComponent*>(e.second)->shape->intersect(ray, x))
+    forEach([&](Element *e, ShapeComponent &shape, RayCastComponent &) {
+        if(shape.shape->intersect(ray, x))
         {
             ray.t_range.max = x.distance;
-            x.element = e.first;
+            x.element = e;
         }
-    }
+    });
 
     if(x.shape)
         return x;
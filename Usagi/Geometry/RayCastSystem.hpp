@@ -23,6 +23,7 @@ class RayCastSystem final
 {
 public:
     void update(const Clock &clock) override { }
+    ComponentAccess componentAccess() const override { return { }; }
 
     /**
      * \brief
@@ -7,11 +7,14 @@
 #include <Usagi/Graphics/RenderTarget/Source/ImageRenderTargetSource.hpp>
 #include <Usagi/Graphics/RenderTarget/Source/SwapchainRenderTargetSource.hpp>
 #include <Usagi/Runtime/Graphics/Enum/GraphicsPipelineStage.hpp>
+#include <Usagi/Runtime/Graphics/GpuCommandPool.hpp>
 #include <Usagi/Runtime/Graphics/GpuDevice.hpp>
 #include <Usagi/Runtime/Graphics/Swapchain.hpp>
 #include <Usagi/Runtime/Runtime.hpp>
 #include <Usagi/Runtime/Window/Window.hpp>
 
+#include "RenderableSystem.hpp"
+
 void usagi::GraphicalGame::createMainWindow(
     const std::string &window_title,
     const Vector2i &window_position,
@@ -91,8 +94,12 @@ usagi::GraphicalGame::GraphicalGame(std::shared_ptr<Runtime> runtime)
 {
     mRuntime->initGpu();
 
-    mPreRender = std::make_unique<ImageTransitionSystem>(mRuntime->gpu());
-    mPostRender = std::make_unique<ImageTransitionSystem>(mRuntime->gpu());
+    mPreRender = std::make_unique<ImageTransitionSystem>();
+    mPostRender = std::make_unique<ImageTransitionSystem>();
+
+    mCommandPools.resize(mJobSystem.threadCount());
+    for(auto &&p : mCommandPools)
+        p = mRuntime->gpu()->createCommandPool();
 }
 
 void usagi::GraphicalGame::submitGraphicsJobs(
@@ -110,9 +117,9 @@ void usagi::GraphicalGame::frame()
     const auto wait_semaphores = { mMainWindow.swapchain->acquireNextImage() };
 
     // update states & gather render jobs
-    mPendingJobs.push_back(mPreRender->render(mMasterClock));
+    mPendingJobs.push_back(mPreRender->render(mMasterClock, commandPool()));
     mStateManager->update(mMasterClock);
-    mPendingJobs.push_back(mPostRender->render(mMasterClock));
+    mPendingJobs.push_back(mPostRender->render(mMasterClock, commandPool()));
     // remove empty lists
     mPendingJobs.erase(std::remove(
         mPendingJobs.begin(), mPendingJobs.end(), nullptr), mPendingJobs.end());
@@ -140,11 +147,39 @@ void usagi::GraphicalGame::frame()
     // collect unused resources from previous frames
     gpu_device->reclaimResources();
 
+    mJobSystem.runMainThreadJobs();
     performDeferredActions();
 
     updateClock();
 }
 
+void usagi::GraphicalGame::recordGraphicsJobs(
+    const std::vector<RenderableSystem *> &systems,
+    const Clock &clock)
+{
+    assert(mJobSystem.isMainThread());
+
+    // each subsystem writes to its own slot, so the submission order does
+    // not depend on the order in which the recordings finish.
+    mRecordedLists.resize(systems.size());
+    mJobSystem.parallelFor(0, systems.size(), 1,
+        [&](const std::size_t begin, const std::size_t end) {
+            for(auto i = begin; i < end; ++i)
+                mRecordedLists[i] = systems[i]->render(clock, commandPool());
+        }
+    );
+    submitGraphicsJobs(mRecordedLists);
+}
+
+usagi::GpuCommandPool * usagi::GraphicalGame::commandPool()
+{
+    const auto index = mJobSystem.currentThreadIndex();
+    if(index == JobSystem::EXTERNAL_THREAD)
+        throw std::logic_error(
+            "Command pools are only available to job system threads.");
+    return mCommandPools[index].get();
+}
+
 usagi::GpuDevice * usagi::GraphicalGame::gpu() const
 {
     return mRuntime->gpu();
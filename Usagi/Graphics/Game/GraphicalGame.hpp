@@ -10,6 +10,9 @@
 
 namespace usagi
 {
+class GpuCommandPool;
+class RenderableSystem;
+
 /**
  * \brief Provides the following functionalities:
  *
@@ -27,6 +30,13 @@ protected:
     std::unique_ptr<ImageTransitionSystem> mPreRender;
     std::unique_ptr<ImageTransitionSystem> mPostRender;
     std::vector<std::shared_ptr<GraphicsCommandList>> mPendingJobs;
+    /**
+     * \brief One command pool per thread of the job system, indexed by
+     * the thread index. Vulkan command pools are externally synchronized,
+     * so each recording thread uses its own.
+     */
+    std::vector<std::shared_ptr<GpuCommandPool>> mCommandPools;
+    std::vector<std::shared_ptr<GraphicsCommandList>> mRecordedLists;
 
     void createMainWindow(
         const std::string &window_title,
@@ -47,6 +57,26 @@ public:
      */
     void submitGraphicsJobs(
         std::vector<std::shared_ptr<GraphicsCommandList>> &jobs);
+
+    /**
+     * \brief Invoke render() of the subsystems concurrently on the job
+     * system and submit the recorded command lists by the order of the
+     * subsystems in the vector. Returns after all recordings finished.
+     * Must be called from the main thread.
+     * \param systems
+     * \param clock
+     */
+    void recordGraphicsJobs(
+        const std::vector<RenderableSystem *> &systems,
+        const Clock &clock);
+
+    /**
+     * \brief Get the command pool of the calling thread, which must be
+     * owned by the job system.
+     * \return
+     */
+    GpuCommandPool * commandPool();
+
     GpuDevice * gpu() const override;
     void onWindowResizeEnd(const WindowSizeEvent &e) override;
 
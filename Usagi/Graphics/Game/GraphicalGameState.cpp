@@ -1,7 +1,5 @@
 ﻿#include "GraphicalGameState.hpp"
 
-#include <execution>
-
 #include <Usagi/Graphics/RenderTarget/RenderTargetDescriptor.hpp>
 
 #include "RenderableSystem.hpp"
@@ -16,7 +14,7 @@ void usagi::GraphicalGameState::subsystemFilter(System *subsystem)
         // in the later process.
         sys->createRenderTarget(desc);
         sys->createPipelines();
-        mRenderableSystems.push_back({ mRenderableSystems.size(), sys });
+        mRenderableSystems.push_back(sys);
     }
 }
 
@@ -39,14 +37,5 @@ void usagi::GraphicalGameState::update(const Clock &clock)
     // set camera for each subsystem??
 
     // record command lists in parallel
-    mCommandLists.resize(mRenderableSystems.size());
-    std::for_each(
-        std::execution::par,
-        mRenderableSystems.begin(),
-        mRenderableSystems.end(),
-        [&](const IndexedRenderable &i) {
-            mCommandLists[i.first] = i.second->render(mClock);
-        }
-    );
-    mGame->submitGraphicsJobs(mCommandLists);
+    mGame->recordGraphicsJobs(mRenderableSystems, mClock);
 }
@@ -4,7 +4,6 @@
 
 namespace usagi
 {
-class GraphicsCommandList;
 class GraphicalGame;
 class RenderableSystem;
 
@@ -13,9 +12,7 @@ class GraphicalGameState : public GameState
 protected:
     GraphicalGame *mGame;
 
-    using IndexedRenderable = std::pair<std::size_t, RenderableSystem*>;
-    std::vector<IndexedRenderable> mRenderableSystems;
-    std::vector<std::shared_ptr<GraphicsCommandList>> mCommandLists;
+    std::vector<RenderableSystem *> mRenderableSystems;
 
     void subsystemFilter(System *subsystem) override;
 
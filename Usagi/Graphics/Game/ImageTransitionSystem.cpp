@@ -3,7 +3,6 @@
 #include <Usagi/Graphics/RenderTarget/RenderTarget.hpp>
 #include <Usagi/Graphics/RenderTarget/RenderTargetDescriptor.hpp>
 #include <Usagi/Runtime/Graphics/GpuCommandPool.hpp>
-#include <Usagi/Runtime/Graphics/GpuDevice.hpp>
 #include <Usagi/Runtime/Graphics/GraphicsCommandList.hpp>
 
 void usagi::ImageTransitionSystem::update(const Clock &clock)
@@ -16,11 +15,6 @@ void usagi::ImageTransitionSystem::createRenderTarget(
     mRenderTarget = descriptor.finish();
 }
 
-usagi::ImageTransitionSystem::ImageTransitionSystem(GpuDevice *gpu)
-{
-    mCommandPool = gpu->createCommandPool();
-}
-
 void usagi::ImageTransitionSystem::onElementComponentChanged(
     Element *element)
 {
@@ -31,11 +25,13 @@ void usagi::ImageTransitionSystem::createPipelines()
 }
 
 std::shared_ptr<usagi::GraphicsCommandList>
-usagi::ImageTransitionSystem::render(const Clock &clock)
+usagi::ImageTransitionSystem::render(
+    const Clock &clock,
+    GpuCommandPool *command_pool)
 {
     if(!mRenderTarget) return { };
 
-    auto cmd = mCommandPool->allocateGraphicsCommandList();
+    auto cmd = command_pool->allocateGraphicsCommandList();
     cmd->beginRecording();
     cmd->beginRendering(
         mRenderTarget->renderPass(),
@@ -4,22 +4,28 @@
 
 namespace usagi
 {
-class GpuDevice;
-class GpuCommandPool;
-
 class ImageTransitionSystem final
     : public RenderableSystem
 {
-    std::shared_ptr<GpuCommandPool> mCommandPool;
-
 public:
-    explicit ImageTransitionSystem(GpuDevice *gpu);
-
     void onElementComponentChanged(Element *element) override;
+
+    ComponentMask componentSignature() const override
+    {
+        return { };
+    }
+
+    ComponentAccess componentAccess() const override
+    {
+        return { };
+    }
+
     void update(const Clock &clock) override;
     void createRenderTarget(RenderTargetDescriptor &descriptor) override;
     void createPipelines() override;
-    std::shared_ptr<GraphicsCommandList> render(const Clock &clock) override;
+    std::shared_ptr<GraphicsCommandList> render(
+        const Clock &clock,
+        GpuCommandPool *command_pool) override;
 
     const std::type_info & type() override
     {
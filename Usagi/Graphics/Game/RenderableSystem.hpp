@@ -10,6 +10,7 @@ class RenderTargetDescriptor;
 class RenderTarget;
 class Framebuffer;
 class GraphicsCommandList;
+class GpuCommandPool;
 
 /**
  * \brief System that uses GPU to draw.
@@ -37,7 +38,11 @@ public:
      * Secondary command lists can be used if the subsystem internally records
      * the command list in parallel.
      * \param clock
+     * \param command_pool The command pool of the calling thread. It is
+     * only valid during this call and must not be used by other threads.
      */
-    virtual std::shared_ptr<GraphicsCommandList> render(const Clock &clock) = 0;
+    virtual std::shared_ptr<GraphicsCommandList> render(
+        const Clock &clock,
+        GpuCommandPool *command_pool) = 0;
 };
 }
@@ -9,6 +9,11 @@ usagi::InputSystem::InputSystem(InputMapping *input_mapping)
 {
 }
 
+usagi::ComponentMask usagi::InputSystem::componentSignature() const
+{
+    return componentMask<InputComponent>();
+}
+
 void usagi::InputSystem::onElementComponentChanged(Element *element)
 {
     if(const auto comp = element->findComponent<InputComponent>())
@@ -15,8 +15,10 @@ public:
     explicit InputSystem(InputMapping *input_mapping);
 
     void onElementComponentChanged(Element *element) override;
+    ComponentMask componentSignature() const override;
 
     void update(const Clock &clock) override { }
+    ComponentAccess componentAccess() const override { return { }; }
 
     const std::type_info & type() override
     {
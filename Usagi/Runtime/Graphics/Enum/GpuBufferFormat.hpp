@@ -8,9 +8,14 @@ enum class GpuBufferFormat
     R8G8_UNORM,
     R8G8B8_UNORM,
     R8G8B8A8_UNORM,
+    R8G8B8A8_SRGB,
 
     B8G8R8A8_UNORM,
 
+    R16_SFLOAT,
+    R16G16_SFLOAT,
+    R16G16B16A16_SFLOAT,
+
     R32_SFLOAT,
     R32G32_SFLOAT,
     R32G32B32_SFLOAT,
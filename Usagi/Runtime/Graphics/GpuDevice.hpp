@@ -1,10 +1,12 @@
 ﻿#pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <Usagi/Utility/Noncopyable.hpp>
 #include <Usagi/Core/Math.hpp>
+#include <Usagi/Runtime/Memory/AllocatorStats.hpp>
 
 #include "Enum/GpuBufferUsage.hpp"
 
@@ -27,6 +29,12 @@ class GpuSemaphore;
 class RenderPass;
 enum class GraphicsPipelineStage;
 
+struct GpuMemoryPoolStats
+{
+    std::string name;
+    AllocatorStats stats;
+};
+
 class GpuDevice : Noncopyable
 {
 public:
@@ -51,6 +59,16 @@ public:
      * \return
      */
     virtual std::shared_ptr<GpuBuffer> createBuffer(GpuBufferUsage usage) = 0;
+
+    /**
+     * \brief Create a buffer for data rewritten every frame. Each
+     * allocation is only valid until the end of the frame it is made in,
+     * after which it is reclaimed in bulk when the device finished the
+     * frame. Reallocating it every frame is cheap.
+     * \return
+     */
+    virtual std::shared_ptr<GpuBuffer> createTransientBuffer(
+        GpuBufferUsage usage) = 0;
     virtual std::shared_ptr<GpuSampler> createSampler(
         const GpuSamplerCreateInfo &info) = 0;
 
@@ -61,6 +79,13 @@ public:
         std::initializer_list<std::shared_ptr<GpuSemaphore>> signal_semaphores
     ) = 0;
 
+    /**
+     * \brief Sample the allocators of the memory pools managed by the
+     * device.
+     * \return
+     */
+    virtual std::vector<GpuMemoryPoolStats> memoryPoolStats() const = 0;
+
     /**
      * \brief Release resources used by previous jobs.
      */
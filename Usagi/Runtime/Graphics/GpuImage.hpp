@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <functional>
 #include <memory>
 
 #include <Usagi/Utility/Noncopyable.hpp>
@@ -39,5 +40,16 @@ public:
      * \param size
      */
     virtual void upload(const void *data, std::size_t size) = 0;
+
+    /**
+     * \brief Upload image data produced directly into the staging memory,
+     * which saves a copy when the data is converted from another format.
+     * \param size
+     * \param write Called once with the staging memory of the given size,
+     * which may be write-combined and should only be written sequentially.
+     */
+    virtual void upload(
+        std::size_t size,
+        const std::function<void(void *staging)> &write) = 0;
 };
 }
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <optional>
+#include <string>
+
+#include <Usagi/Utility/MemoryView.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Resolves the #include directives of GLSL sources. Sources using it
+ * must enable the GL_GOOGLE_include_directive extension. May be called from
+ * any thread compiling shaders.
+ */
+class GlslIncluder
+{
+public:
+    virtual ~GlslIncluder() = default;
+
+    struct Include
+    {
+        /**
+         * \brief Uniquely identifies the included file. It is passed back as
+         * the includer name when resolving the includes of the file, and
+         * must resolve to the same file as a non-relative include.
+         */
+        std::string name;
+        MemoryView content;
+    };
+
+    /**
+     * \brief
+     * \param header_name The name in the directive.
+     * \param includer_name The name of the file containing the directive,
+     * which is empty for the main source if it has no name.
+     * \param relative Whether the name is quoted instead of enclosed in angle
+     * brackets, in which case it is looked up relative to the includer first.
+     * \return Empty if the file is not found.
+     */
+    virtual std::optional<Include> include(
+        const std::string &header_name,
+        const std::string &includer_name,
+        bool relative) = 0;
+};
+}
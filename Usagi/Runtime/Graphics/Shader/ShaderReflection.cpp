@@ -0,0 +1,154 @@
+﻿#include "ShaderReflection.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+/*
+ * Serialized as a sequence of little-endian uint32 values and strings, each
+ * string being its length followed by the characters:
+ *
+ *  MAGIC, VERSION, push_constant_size,
+ *  input count, { location, name }...
+ *  resource count, { type, set, binding, count, name }...
+ *  field count, { offset, size, name }...
+ */
+
+namespace
+{
+constexpr std::uint32_t MAGIC = 0x46525355; // "USRF"
+constexpr std::uint32_t VERSION = 1;
+
+class Writer
+{
+    std::string mData;
+
+public:
+    void write(const std::uint32_t value)
+    {
+        char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        mData.append(bytes, sizeof(bytes));
+    }
+
+    void write(const std::string &string)
+    {
+        write(static_cast<std::uint32_t>(string.size()));
+        mData += string;
+    }
+
+    std::string data() { return std::move(mData); }
+};
+
+class Reader
+{
+    std::string_view mData;
+
+    void check(const std::size_t size) const
+    {
+        if(mData.size() < size)
+            throw std::runtime_error("Invalid shader reflection data.");
+    }
+
+public:
+    explicit Reader(const std::string_view data)
+        : mData { data }
+    {
+    }
+
+    std::uint32_t readUint()
+    {
+        std::uint32_t value;
+        check(sizeof(value));
+        std::memcpy(&value, mData.data(), sizeof(value));
+        mData.remove_prefix(sizeof(value));
+        return value;
+    }
+
+    std::string readString()
+    {
+        const auto size = readUint();
+        check(size);
+        std::string string { mData.substr(0, size) };
+        mData.remove_prefix(size);
+        return string;
+    }
+
+    // guards against huge allocations when the data is corrupted. each
+    // element takes at least 4 bytes.
+    std::uint32_t readCount()
+    {
+        const auto count = readUint();
+        check(count * std::size_t(4));
+        return count;
+    }
+
+    bool finished() const { return mData.empty(); }
+};
+}
+
+std::string usagi::ShaderReflection::serialize() const
+{
+    Writer writer;
+    writer.write(MAGIC);
+    writer.write(VERSION);
+    writer.write(push_constant_size);
+    writer.write(static_cast<std::uint32_t>(inputs.size()));
+    for(auto &&i : inputs)
+    {
+        writer.write(i.location);
+        writer.write(i.name);
+    }
+    writer.write(static_cast<std::uint32_t>(resources.size()));
+    for(auto &&r : resources)
+    {
+        writer.write(static_cast<std::uint32_t>(r.type));
+        writer.write(r.set);
+        writer.write(r.binding);
+        writer.write(r.count);
+        writer.write(r.name);
+    }
+    writer.write(static_cast<std::uint32_t>(push_constant_fields.size()));
+    for(auto &&f : push_constant_fields)
+    {
+        writer.write(f.offset);
+        writer.write(f.size);
+        writer.write(f.name);
+    }
+    return writer.data();
+}
+
+usagi::ShaderReflection usagi::ShaderReflection::deserialize(
+    const std::string_view data)
+{
+    Reader reader { data };
+    if(reader.readUint() != MAGIC || reader.readUint() != VERSION)
+        throw std::runtime_error("Invalid shader reflection data.");
+
+    ShaderReflection reflection;
+    reflection.push_constant_size = reader.readUint();
+    reflection.inputs.resize(reader.readCount());
+    for(auto &&i : reflection.inputs)
+    {
+        i.location = reader.readUint();
+        i.name = reader.readString();
+    }
+    reflection.resources.resize(reader.readCount());
+    for(auto &&r : reflection.resources)
+    {
+        r.type = static_cast<ShaderResourceType>(reader.readUint());
+        r.set = reader.readUint();
+        r.binding = reader.readUint();
+        r.count = reader.readUint();
+        r.name = reader.readString();
+    }
+    reflection.push_constant_fields.resize(reader.readCount());
+    for(auto &&f : reflection.push_constant_fields)
+    {
+        f.offset = reader.readUint();
+        f.size = reader.readUint();
+        f.name = reader.readString();
+    }
+    if(!reader.finished())
+        throw std::runtime_error("Invalid shader reflection data.");
+    return reflection;
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace usagi
+{
+enum class ShaderResourceType : std::uint32_t
+{
+    SAMPLED_IMAGE,
+    SAMPLER,
+    // sampler2D etc.
+    COMBINED_IMAGE_SAMPLER,
+    UNIFORM_BUFFER,
+    STORAGE_BUFFER,
+    INPUT_ATTACHMENT,
+};
+
+struct ShaderStageInput
+{
+    std::string name;
+    std::uint32_t location = 0;
+};
+
+struct ShaderResourceBinding
+{
+    std::string name;
+    ShaderResourceType type = ShaderResourceType::UNIFORM_BUFFER;
+    std::uint32_t set = 0;
+    std::uint32_t binding = 0;
+    std::uint32_t count = 1;
+};
+
+struct ShaderPushConstantField
+{
+    std::string name;
+    std::uint32_t offset = 0;
+    std::uint32_t size = 0;
+};
+
+/**
+ * \brief The interface of a shader needed to create pipelines. Extracted
+ * from the SPIR-V binary once and serialized along with it, so that loading
+ * a cached shader does not require parsing the binary again.
+ */
+struct ShaderReflection
+{
+    std::vector<ShaderStageInput> inputs;
+    std::vector<ShaderResourceBinding> resources;
+    // members of all push constant blocks in declaration order
+    std::vector<ShaderPushConstantField> push_constant_fields;
+    // total declared size of the push constant blocks
+    std::uint32_t push_constant_size = 0;
+
+    std::string serialize() const;
+
+    /**
+     * \brief
+     * \param data
+     * \return Throws if the data is not a serialized reflection of the
+     * current version.
+     */
+    static ShaderReflection deserialize(std::string_view data);
+};
+}
@@ -1,8 +1,11 @@
 ﻿#include "SpirvBinary.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <cstring>
+#include <thread>
 
+#include <SPIRV-Cross/spirv_cross.hpp>
 #include <glslang/glslang/Public/ShaderLang.h>
 #include <glslang/StandAlone/ResourceLimits.h>
 #include <glslang/glslang/Public/ShaderLang.h>
@@ -12,13 +15,16 @@
 #include <Usagi/Utility/RAIIHelper.hpp>
 #include <Usagi/Utility/File.hpp>
 #include <Usagi/Utility/Hash.hpp>
+#include <Usagi/Utility/MappedFile.hpp>
 #include <Usagi/Utility/Stream.hpp>
 
 // See https://www.khronos.org/registry/spir-v/papers/WhitePaper.html for
 // SPIR-V format.
-usagi::SpirvBinary::SpirvBinary(std::vector<std::uint32_t> bytecodes)
+usagi::SpirvBinary::SpirvBinary(
+    std::vector<std::uint32_t> bytecodes,
+    std::optional<ShaderReflection> reflection)
     : mBytecodes { std::move(bytecodes) }
-    , mReflectionCompiler { mBytecodes }
+    , mReflection { std::move(reflection) }
 {
     // check header magic code
     if(mBytecodes.empty() || mBytecodes.front() != 0x07230203)
@@ -26,6 +32,94 @@ usagi::SpirvBinary::SpirvBinary(std::vector<std::uint32_t> bytecodes)
             "Not valid SPIR-V binary: header magic code does not match.");
 }
 
+usagi::SpirvBinary::~SpirvBinary() = default;
+
+const spirv_cross::Compiler & usagi::SpirvBinary::reflectionCompiler() const
+{
+    std::call_once(mReflectionCompilerCreated, [this]() {
+        mReflectionCompiler =
+            std::make_unique<spirv_cross::Compiler>(mBytecodes);
+    });
+    return *mReflectionCompiler;
+}
+
+namespace
+{
+using namespace spirv_cross;
+
+usagi::ShaderReflection extractReflection(const Compiler &compiler)
+{
+    using namespace usagi;
+
+    ShaderReflection reflection;
+    const auto resources = compiler.get_shader_resources();
+
+    for(auto &&resource : resources.stage_inputs)
+    {
+        reflection.inputs.push_back({
+            resource.name,
+            compiler.get_decoration(resource.id, spv::DecorationLocation)
+        });
+    }
+
+    for(auto &&resource : resources.push_constant_buffers)
+    {
+        const auto &type = compiler.get_type(resource.base_type_id);
+        const auto member_count = type.member_types.size();
+        for(unsigned i = 0; i < member_count; ++i)
+        {
+            reflection.push_constant_fields.push_back({
+                compiler.get_member_name(type.self, i),
+                compiler.type_struct_member_offset(type, i),
+                static_cast<std::uint32_t>(
+                    compiler.get_declared_struct_member_size(type, i))
+            });
+        }
+        reflection.push_constant_size += static_cast<std::uint32_t>(
+            compiler.get_declared_struct_size(type));
+    }
+
+    const auto add_resources = [&](
+        const auto &list,
+        const ShaderResourceType resource_type)
+    {
+        for(auto &&resource : list)
+        {
+            reflection.resources.push_back({
+                resource.name,
+                resource_type,
+                compiler.get_decoration(
+                    resource.id, spv::DecorationDescriptorSet),
+                compiler.get_decoration(resource.id, spv::DecorationBinding),
+                compiler.get_type(resource.type_id).vecsize
+            });
+        }
+    };
+    add_resources(resources.separate_images,
+        ShaderResourceType::SAMPLED_IMAGE);
+    add_resources(resources.separate_samplers, ShaderResourceType::SAMPLER);
+    add_resources(resources.sampled_images,
+        ShaderResourceType::COMBINED_IMAGE_SAMPLER);
+    add_resources(resources.uniform_buffers,
+        ShaderResourceType::UNIFORM_BUFFER);
+    add_resources(resources.storage_buffers,
+        ShaderResourceType::STORAGE_BUFFER);
+    add_resources(resources.subpass_inputs,
+        ShaderResourceType::INPUT_ATTACHMENT);
+
+    return reflection;
+}
+}
+
+const usagi::ShaderReflection & usagi::SpirvBinary::reflection() const
+{
+    std::call_once(mReflectionExtracted, [this]() {
+        if(!mReflection)
+            mReflection = extractReflection(reflectionCompiler());
+    });
+    return mReflection.value();
+}
+
 namespace fs = std::filesystem;
 
 void usagi::SpirvBinary::dumpBytecodeBitstream(std::ostream &output)
@@ -64,20 +158,28 @@ std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromStream(
             glsl_source_stream.exceptions(old_exceptions);
         });
 
-    auto dump = readStreamAsString(glsl_source_stream);
-    if(dump.size() % sizeof(Bytecode) != 0)
+    const auto dump = readStreamAsString(glsl_source_stream);
+    return fromMemory({ nullptr, dump.data(), dump.size() });
+}
+
+std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromMemory(
+    const MemoryView &binary)
+{
+    if(binary.size() % sizeof(Bytecode) != 0)
         throw std::runtime_error(
             "Not valid SPIR-V binary. File size is not a multiple of 4.");
 
     std::vector<Bytecode> content;
-    content.resize(dump.size() / 4);
-    std::memcpy(content.data(), dump.data(), dump.size());
+    content.resize(binary.size() / sizeof(Bytecode));
+    std::memcpy(content.data(), binary.data(), binary.size());
 
     return std::make_shared<SpirvBinary>(std::move(content));
 }
 
 namespace
 {
+using namespace glslang;
+
 EShLanguage translate(const usagi::ShaderStage stage)
 {
     switch(stage)
@@ -87,28 +189,249 @@ EShLanguage translate(const usagi::ShaderStage stage)
         default: throw std::runtime_error("Invalid shader stage.");
     }
 }
+
+// default Vulkan version
+constexpr auto CLIENT_INPUT_SEMANTICS_VERSION = 100;
+constexpr auto VULKAN_CLIENT_VERSION = EShTargetVulkan_1_0;
+constexpr auto TARGET_VERSION = EShTargetSpv_1_0;
+constexpr auto DEFAULT_VERSION = 110; // defaults to desktop version
+constexpr auto MESSAGES = EShMsgDefault;
+constexpr auto GENERATE_DEBUG_INFO = true;
+constexpr auto DISABLE_OPTIMIZER = false;
+constexpr auto OPTIMIZE_SIZE = false;
+// bump when the way of compiling changes in a way not covered by the
+// settings above, such as the resource limits or the includer.
+constexpr auto CACHE_REVISION = 1;
+
+/**
+ * \brief glslang must be initialized once per process before compiling
+ * shaders on any thread. Finalized on exit.
+ */
+void initializeGlslang()
+{
+    static const usagi::RAIIHelper glslang_process {
+        []() { InitializeProcess(); },
+        []() { FinalizeProcess(); }
+    };
+}
+
+/**
+ * \brief Everything determining the compiled bytecode except the included
+ * files is hashed so that changing the stage, the target environment, the
+ * compiler options or the compiler itself does not return a stale binary.
+ * The source name is included since relative includes are resolved from it.
+ */
+std::string cacheKey(
+    const std::string_view glsl_source_code,
+    const usagi::ShaderStage stage,
+    const std::string &source_name)
+{
+    std::string key = fmt::format(
+        "rev={};glslang={};generator={};stage={};client={};target={};"
+        "version={};messages={};debug={};opt={};size={};",
+        CACHE_REVISION,
+        GetGlslVersionString(),
+        GetSpirvGeneratorVersion(),
+        to_string(stage),
+        static_cast<int>(VULKAN_CLIENT_VERSION),
+        static_cast<int>(TARGET_VERSION),
+        DEFAULT_VERSION,
+        static_cast<int>(MESSAGES),
+        GENERATE_DEBUG_INFO,
+        !DISABLE_OPTIMIZER,
+        OPTIMIZE_SIZE
+    );
+    key += source_name;
+    key += '\n';
+    key += glsl_source_code;
+    return usagi::sha256(key);
+}
+
+/**
+ * \brief The address of the binary compiled from the source identified by
+ * the key and the given content of its included files.
+ */
+std::string inputsKey(
+    const std::string &key,
+    const std::vector<usagi::GlslIncluder::Include> &includes)
+{
+    if(includes.empty()) return key;
+
+    std::string inputs = key;
+    for(auto &&i : includes)
+    {
+        inputs += '\n';
+        inputs += i.name;
+        inputs += '\n';
+        inputs += usagi::sha256(i.content.asStringView());
+    }
+    return usagi::sha256(inputs);
+}
+
+/**
+ * \brief Read the names of the files included by a source when it was last
+ * compiled.
+ * \return Empty if the source included nothing.
+ */
+std::vector<std::string> readDependencies(const std::filesystem::path &path)
+{
+    std::vector<std::string> dependencies;
+    std::ifstream in(path);
+    std::string name;
+    while(std::getline(in, name))
+    {
+        if(!name.empty())
+            dependencies.push_back(std::move(name));
+    }
+    return dependencies;
+}
+
+/**
+ * \brief Written to a temporary file first so that other threads or
+ * processes compiling the same shader never see a partially written file.
+ */
+void writeCacheFile(
+    const std::filesystem::path &path,
+    const std::string_view content)
+{
+    auto temp_file = path;
+    temp_file += fmt::format(".{}.tmp",
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), content.size());
+        if(!out)
+        {
+            LOG(warn, "Could not write the shader cache: {}",
+                temp_file.u8string());
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_file, path, ec);
+    if(ec)
+    {
+        LOG(warn, "Could not save the shader cache: {}", ec.message());
+        std::filesystem::remove(temp_file, ec);
+    }
+}
+
+/**
+ * \brief Resolves the includes with GlslIncluder and records the included
+ * files in the order they are first included.
+ */
+class IncluderAdaptor : public TShader::Includer
+{
+    usagi::GlslIncluder *mIncluder = nullptr;
+    std::vector<usagi::GlslIncluder::Include> mIncludes;
+
+    IncludeResult * include(
+        const char *header_name,
+        const char *includer_name,
+        const bool relative)
+    {
+        if(!mIncluder) return nullptr;
+
+        auto include = mIncluder->include(
+            header_name, includer_name ? includer_name : "", relative);
+        if(!include) return nullptr;
+
+        const auto iter = std::find_if(mIncludes.begin(), mIncludes.end(),
+            [&](auto &&i) { return i.name == include->name; });
+        // the recorded view keeps the content alive during compilation
+        const auto &recorded = iter == mIncludes.end()
+            ? mIncludes.emplace_back(std::move(include.value()))
+            : *iter;
+        return new IncludeResult(
+            recorded.name,
+            reinterpret_cast<const char*>(recorded.content.data()),
+            recorded.content.size(),
+            nullptr
+        );
+    }
+
+public:
+    explicit IncluderAdaptor(usagi::GlslIncluder *includer)
+        : mIncluder { includer }
+    {
+    }
+
+    IncludeResult * includeSystem(
+        const char *header_name,
+        const char *includer_name,
+        std::size_t inclusion_depth) override
+    {
+        return include(header_name, includer_name, false);
+    }
+
+    IncludeResult * includeLocal(
+        const char *header_name,
+        const char *includer_name,
+        std::size_t inclusion_depth) override
+    {
+        return include(header_name, includer_name, true);
+    }
+
+    void releaseInclude(IncludeResult *result) override
+    {
+        delete result;
+    }
+
+    const std::vector<usagi::GlslIncluder::Include> & includes() const
+    {
+        return mIncludes;
+    }
+};
 }
 
 // refer to glslangValidator source code
 std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceString(
-    const std::string &glsl_source_code,
+    const std::string_view glsl_source_code,
     const ShaderStage stage,
-    const std::optional<std::filesystem::path> & cache_folder)
+    const std::optional<std::filesystem::path> & cache_folder,
+    GlslIncluder *includer,
+    const std::string &source_name)
 {
-    LOG(info, "Compiling {} shader...", to_string(stage));
+    LOG(info, "Compiling {} shader {}...", to_string(stage), source_name);
 
-    std::filesystem::path cache_file;
+    std::string key;
     if(cache_folder)
     {
-        cache_file = cache_folder.value();
-        create_directories(cache_file);
-        cache_file /= sha256(glsl_source_code);
-        cache_file += ".spv";
+        create_directories(cache_folder.value());
+        key = cacheKey(glsl_source_code, stage, source_name);
 
         // try loading from cache
         try
         {
+            auto dependencies = readDependencies(
+                cache_folder.value() / (key + ".deps"));
+            std::vector<GlslIncluder::Include> includes;
+            for(auto &&d : dependencies)
+            {
+                auto include = includer
+                    ? includer->include(d, { }, false)
+                    : std::nullopt;
+                if(!include)
+                    throw std::runtime_error("Included file not found.");
+                includes.push_back(std::move(include.value()));
+            }
+            const auto cache_file = cache_folder.value() /
+                (inputsKey(key, includes) + ".spv");
             auto cache = fromFile(cache_file);
+            cache->mDependencies = std::move(dependencies);
+            // if the reflection is not cached, it is extracted on use
+            try
+            {
+                auto reflection = cache_file;
+                reflection.replace_extension(".refl");
+                cache->mReflection = ShaderReflection::deserialize(
+                    mapFile(reflection).asStringView());
+            }
+            catch(const std::exception &e)
+            {
+                LOG(warn, "Could not load the shader reflection: {}",
+                    e.what());
+            }
             LOG(info, "Shader loaded from cache {}", cache_file);
             return std::move(cache);
         }
@@ -124,23 +447,11 @@ std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceString(
         }
     }
 
-    using namespace glslang;
     using namespace spv;
 
-    // default Vulkan version
-    const auto client_input_semantics_version = 100;
-    const auto vulkan_client_version = EShTargetVulkan_1_0;
-    // doesn't influence anything yet, but maps to OpenGL 4.50
-    const auto opengl_client_version = EShTargetOpenGL_450;
-    const auto target_version = EShTargetSpv_1_0;
-    const auto default_version = 110; // defaults to desktop version
     const auto glslang_stage = translate(stage);
-    const auto messages = EShMsgDefault;
 
-    RAIIHelper glslang_process {
-        []() { InitializeProcess(); },
-        []() { FinalizeProcess(); }
-    };
+    initializeGlslang();
     // shader must be released after program because the program may reference
     // the shaders.
     TShader shader(glslang_stage);
@@ -149,16 +460,17 @@ std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceString(
 
     const char *strings[] = { glsl_source_code.data() };
     const int sizes[] = { static_cast<int>(glsl_source_code.size()) };
-    shader.setStringsWithLengths(strings, sizes, 1);
+    const char *names[] = { source_name.c_str() };
+    shader.setStringsWithLengthsAndNames(strings, sizes, names, 1);
 
     shader.setEnvInput(EShSourceGlsl, glslang_stage, EShClientVulkan,
-        client_input_semantics_version);
-    shader.setEnvClient(EShClientVulkan, vulkan_client_version);
-    shader.setEnvTarget(EShTargetSpv, target_version);
+        CLIENT_INPUT_SEMANTICS_VERSION);
+    shader.setEnvClient(EShClientVulkan, VULKAN_CLIENT_VERSION);
+    shader.setEnvTarget(EShTargetSpv, TARGET_VERSION);
 
-    TShader::ForbidIncluder includer;
-    const auto compilation_suceeded =
-        shader.parse(&resources, default_version, false, messages, includer);
+    IncluderAdaptor includer_adaptor { includer };
+    const auto compilation_suceeded = shader.parse(&resources,
+        DEFAULT_VERSION, false, MESSAGES, includer_adaptor);
 
     if(shader.getInfoLog()[0])
         LOG(info, "Compiler output:\n{}", shader.getInfoLog());
@@ -167,7 +479,7 @@ std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceString(
 
     program.addShader(&shader);
 
-    const auto link_succeeded = program.link(messages) && program.mapIO();
+    const auto link_succeeded = program.link(MESSAGES) && program.mapIO();
 
     if(program.getInfoLog()[0])
         LOG(info, "Linker output:\n{}", program.getInfoLog());
@@ -186,23 +498,44 @@ std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceString(
     std::string warnings_errors;
     SpvBuildLogger logger;
     SpvOptions spv_options;
-    spv_options.generateDebugInfo = true;
-    spv_options.disableOptimizer = false;
-    spv_options.optimizeSize = false;
+    spv_options.generateDebugInfo = GENERATE_DEBUG_INFO;
+    spv_options.disableOptimizer = DISABLE_OPTIMIZER;
+    spv_options.optimizeSize = OPTIMIZE_SIZE;
 
     GlslangToSpv(*program.getIntermediate(glslang_stage), spirv, &logger,
         &spv_options);
     // LOG(info, "Disassembly:");
     // Disassemble(std::cout, spirv);
 
-    // save bytecode to cache
+    const auto &includes = includer_adaptor.includes();
+    auto binary = std::make_shared<SpirvBinary>(std::move(spirv));
+    for(auto &&i : includes)
+        binary->mDependencies.push_back(i.name);
+
+    // save bytecode and reflection to cache, along with the list of included
+    // files used to find them next time.
     if(cache_folder)
     {
-        LOG(info, "Saving snader cache to {}", cache_file);
-        dumpBinary(cache_file, spirv.data(), spirv.size() * sizeof(Bytecode));
+        auto cache_file = cache_folder.value() /
+            (inputsKey(key, includes) + ".spv");
+        LOG(info, "Saving shader cache to {}", cache_file);
+        const auto &bytecodes = binary->bytecodes();
+        writeCacheFile(cache_file, std::string_view(
+            reinterpret_cast<const char*>(bytecodes.data()),
+            bytecodes.size() * sizeof(Bytecode)));
+        writeCacheFile(cache_file.replace_extension(".refl"),
+            binary->reflection().serialize());
+        if(!includes.empty())
+        {
+            std::string dependencies;
+            for(auto &&i : includes)
+                dependencies.append(i.name).append("\n");
+            writeCacheFile(
+                cache_folder.value() / (key + ".deps"), dependencies);
+        }
     }
 
-    return std::make_shared<SpirvBinary>(std::move(spirv));
+    return binary;
 }
 
 std::shared_ptr<usagi::SpirvBinary> usagi::SpirvBinary::fromGlslSourceFile(
@@ -3,11 +3,21 @@
 #include <vector>
 #include <filesystem>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string_view>
 
-#include <SPIRV-Cross/spirv_cross.hpp>
+#include <Usagi/Utility/MemoryView.hpp>
 
 #include "ShaderStage.hpp"
+#include "GlslIncluder.hpp"
+#include "ShaderReflection.hpp"
+
+namespace spirv_cross
+{
+class Compiler;
+}
 
 namespace usagi
 {
@@ -23,7 +33,11 @@ public:
 
 private:
     std::vector<Bytecode> mBytecodes;
-    spirv_cross::Compiler mReflectionCompiler;
+
+    mutable std::once_flag mReflectionCompilerCreated;
+    mutable std::unique_ptr<spirv_cross::Compiler> mReflectionCompiler;
+    mutable std::once_flag mReflectionExtracted;
+    mutable std::optional<ShaderReflection> mReflection;
 
     struct ConstantFieldInfo
     {
@@ -33,25 +47,84 @@ private:
 
     std::map<std::string, ConstantFieldInfo> mConstantFieldInfoMap;
 
+    // names of the files transitively included by the source
+    std::vector<std::string> mDependencies;
+
 public:
-    explicit SpirvBinary(std::vector<Bytecode> bytecodes);
+    /**
+     * \brief
+     * \param bytecodes
+     * \param reflection The reflection previously extracted from the same
+     * bytecodes, such as loaded from the cache. If not given, it is
+     * extracted when first requested.
+     */
+    explicit SpirvBinary(
+        std::vector<Bytecode> bytecodes,
+        std::optional<ShaderReflection> reflection = { });
+    ~SpirvBinary();
 
     const std::vector<Bytecode> & bytecodes() const { return mBytecodes; }
     void dumpBytecodeBitstream(std::ostream &output);
 
-    const spirv_cross::Compiler & reflectionCompiler() const
+    /**
+     * \brief The names of all files included by the GLSL source, directly or
+     * indirectly, as resolved by the includer. The binary must be recompiled
+     * when any of them changes.
+     * \return
+     */
+    const std::vector<std::string> & dependencies() const
     {
-        return mReflectionCompiler;
+        return mDependencies;
     }
 
+    /**
+     * \brief The SPIRV-Cross compiler parsing the binary, created on first
+     * use since parsing is costly. Only needed by tools inspecting details
+     * not covered by reflection(). Thread-safe.
+     * \return
+     */
+    const spirv_cross::Compiler & reflectionCompiler() const;
+
+    /**
+     * \brief The interface of the shader used to create pipelines. Unless it
+     * was given on construction, it is extracted with the reflection compiler
+     * on first use. Thread-safe.
+     * \return
+     */
+    const ShaderReflection & reflection() const;
+
     static std::shared_ptr<SpirvBinary> fromFile(
         const std::filesystem::path &binary_path);
     static std::shared_ptr<SpirvBinary> fromStream(
         std::istream &glsl_source_stream);
+    /**
+     * \brief Load SPIR-V bytecode from memory, such as a mapped file. The
+     * bytecode is copied only once into the aligned storage of the binary.
+     * \param binary
+     * \return
+     */
+    static std::shared_ptr<SpirvBinary> fromMemory(const MemoryView &binary);
+    /**
+     * \brief Compile GLSL source code into SPIR-V.
+     * \param glsl_source_code
+     * \param stage
+     * \param cache_folder If specified, the binary is cached under the
+     * folder and addressed by the content of the source, the included files
+     * and the compiler settings. The included files of each source are
+     * recorded so that the cached binary is reused until any of them
+     * changes.
+     * \param includer Resolves #include directives. Including is an error
+     * if it is null.
+     * \param source_name The name of the source passed to the includer to
+     * resolve relative includes.
+     * \return
+     */
     static std::shared_ptr<SpirvBinary> fromGlslSourceString(
-        const std::string &glsl_source_code,
+        std::string_view glsl_source_code,
         ShaderStage stage,
-        const std::optional<std::filesystem::path> & cache_folder = { });
+        const std::optional<std::filesystem::path> & cache_folder = { },
+        GlslIncluder *includer = nullptr,
+        const std::string &source_name = { });
     static std::shared_ptr<SpirvBinary> fromGlslSourceFile(
         const std::filesystem::path &glsl_source_path,
         ShaderStage stage,
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace usagi
+{
+/**
+ * \brief A sample of the state of an allocator. The totals are cumulative
+ * so that rates can be computed from the difference of two samples.
+ */
+struct AllocatorStats
+{
+    std::size_t managed_bytes = 0;
+    std::size_t used_bytes = 0;
+    std::size_t peak_used_bytes = 0;
+    // the largest allocation that could currently succeed, ignoring
+    // alignment
+    std::size_t largest_free_bytes = 0;
+
+    std::uint64_t total_allocations = 0;
+    std::uint64_t total_deallocations = 0;
+    // including the rounding by the allocator
+    std::uint64_t total_allocated_bytes = 0;
+
+    std::size_t freeBytes() const { return managed_bytes - used_bytes; }
+
+    std::uint64_t liveAllocations() const
+    {
+        return total_allocations - total_deallocations;
+    }
+
+    /**
+     * \brief 0 if the free memory is one contiguous block, approaching 1
+     * as it is split into smaller pieces.
+     * \return
+     */
+    double fragmentation() const
+    {
+        const auto free = freeBytes();
+        return free ? 1.0 - static_cast<double>(largest_free_bytes) / free
+            : 0.0;
+    }
+};
+}
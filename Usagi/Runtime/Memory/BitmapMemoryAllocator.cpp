@@ -1,7 +1,11 @@
 ﻿#include "BitmapMemoryAllocator.hpp"
 
 #include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
 
+#include <Usagi/Utility/BitHack.hpp>
 #include <Usagi/Utility/Rounding.hpp>
 
 namespace usagi
@@ -12,19 +16,34 @@ std::size_t BitmapMemoryAllocator::getAddressBlock(
     assert(address >= mBase);
     const auto rel = address - mBase;
     const auto block = rel / mBlockSize;
-    assert(block < mBitmap.size());
+    assert(block < mBlockCount);
     return block;
 }
 
+BitmapMemoryAllocator::Word BitmapMemoryAllocator::wordMask(
+    const std::size_t word,
+    const std::size_t first_block,
+    const std::size_t last_block)
+{
+    auto mask = ~Word(0);
+    if(word == first_block / WORD_BITS)
+        mask &= ~Word(0) << first_block % WORD_BITS;
+    if(word == last_block / WORD_BITS)
+        mask &= ~Word(0) >> (WORD_BITS - 1 - last_block % WORD_BITS);
+    return mask;
+}
+
 BitmapMemoryAllocator::BitmapMemoryAllocator(void *base,
     const std::size_t total_size,
     const std::size_t block_size)
     : mBase { reinterpret_cast<std::size_t>(base) }
     , mTotalSize { total_size }
     , mBlockSize { block_size }
+    , mBlockCount { block_size ? total_size / block_size : 0 }
+    , mWordCount { utility::calculateSpanningPages(mBlockCount, WORD_BITS) }
+    , mFreeBlocks { mBlockCount }
+    , mMinFreeBlocks { mBlockCount }
 {
-    static_assert(sizeof(char) == 1);
-
     if(!block_size)
         throw std::invalid_argument(
             "block size must be positive");
@@ -32,78 +51,239 @@ BitmapMemoryAllocator::BitmapMemoryAllocator(void *base,
         throw std::invalid_argument(
             "total size cannot hold a single block");
 
-    mBitmap = std::string(total_size / block_size, BLOCK_FREE);
+    mUsed = std::make_unique<std::atomic<Word>[]>(mWordCount);
+    mAllocationEnd = std::make_unique<std::atomic<Word>[]>(mWordCount);
+    for(std::size_t i = 0; i < mWordCount; ++i)
+    {
+        mUsed[i].store(0, std::memory_order_relaxed);
+        mAllocationEnd[i].store(0, std::memory_order_relaxed);
+    }
+    // the bits past the last block never become free
+    if(const auto tail = mBlockCount % WORD_BITS)
+        mUsed[mWordCount - 1].store(~Word(0) << tail);
 }
 
-std::size_t BitmapMemoryAllocator::usableSize() const
+template <typename Visitor>
+std::size_t BitmapMemoryAllocator::visitFreeRuns(Visitor visitor) const
 {
-    return mBlockSize * std::count(mBitmap.begin(), mBitmap.end(), BLOCK_FREE);
+    // the run of free blocks reaching the end of the previous word
+    std::size_t run_begin = 0, run_length = 0;
+    const auto fit = [&]() { return visitor(run_begin, run_length); };
+
+    for(std::size_t i = 0; i < mWordCount; ++i)
+    {
+        const auto used = mUsed[i].load(std::memory_order_acquire);
+        if(used == ~Word(0))
+        {
+            run_length = 0;
+            continue;
+        }
+        if(used == 0)
+        {
+            if(!run_length) run_begin = i * WORD_BITS;
+            run_length += WORD_BITS;
+            if(const auto first = fit(); first != NO_BLOCK)
+                return first;
+            continue;
+        }
+        // visit the free runs in the word from the lowest bit
+        const auto free = ~used;
+        std::size_t bit = 0;
+        while(bit < WORD_BITS)
+        {
+            const auto rest = free >> bit;
+            if(rest == 0)
+            {
+                run_length = 0;
+                break;
+            }
+            if(const auto used_bits = utility::countTrailingZeros(rest))
+            {
+                run_length = 0;
+                bit += used_bits;
+            }
+            // the upper bits shifted in are ones so the run ends within
+            // the word
+            const auto length = utility::countTrailingZeros(~(free >> bit));
+            if(!run_length) run_begin = i * WORD_BITS + bit;
+            run_length += length;
+            if(const auto first = fit(); first != NO_BLOCK)
+                return first;
+            bit += length;
+        }
+    }
+    return NO_BLOCK;
+}
+
+std::size_t BitmapMemoryAllocator::findFreeBlocks(
+    const std::size_t num_blocks,
+    const std::size_t stride,
+    const std::size_t phase) const
+{
+    // returns the first usable block if the run can hold the allocation
+    return visitFreeRuns([&](
+        const std::size_t run_begin,
+        const std::size_t run_length) {
+        const auto first = run_begin <= phase
+            ? phase
+            : phase + utility::roundUpUnsigned(run_begin - phase, stride);
+        return first + num_blocks <= run_begin + run_length
+            ? first : NO_BLOCK;
+    });
 }
 
-void BitmapMemoryAllocator::markBlocksAllocated(
-    std::string::iterator begin,
-    std::string::iterator end)
+std::size_t BitmapMemoryAllocator::largestFreeSize() const
 {
-    *begin = BLOCK_USED_BEGIN;
-    std::fill(++begin, end, BLOCK_USED);
+    std::size_t largest = 0;
+    visitFreeRuns([&](std::size_t, const std::size_t run_length) {
+        largest = std::max(largest, run_length);
+        return NO_BLOCK;
+    });
+    return largest * mBlockSize;
+}
+
+AllocatorStats BitmapMemoryAllocator::stats() const
+{
+    AllocatorStats stats;
+    stats.managed_bytes = mBlockCount * mBlockSize;
+    stats.used_bytes = usedSize();
+    stats.peak_used_bytes = (mBlockCount
+        - mMinFreeBlocks.load(std::memory_order_relaxed)) * mBlockSize;
+    stats.largest_free_bytes = largestFreeSize();
+    stats.total_allocations =
+        mAllocationCount.load(std::memory_order_relaxed);
+    stats.total_deallocations =
+        mDeallocationCount.load(std::memory_order_relaxed);
+    stats.total_allocated_bytes =
+        mAllocatedBlocks.load(std::memory_order_relaxed) * mBlockSize;
+    return stats;
+}
+
+bool BitmapMemoryAllocator::claimBlocks(
+    const std::size_t first_block,
+    const std::size_t num_blocks)
+{
+    const auto last_block = first_block + num_blocks - 1;
+    const auto first_word = first_block / WORD_BITS;
+    const auto last_word = last_block / WORD_BITS;
+
+    for(auto i = first_word; i <= last_word; ++i)
+    {
+        const auto mask = wordMask(i, first_block, last_block);
+        auto expected = mUsed[i].load(std::memory_order_relaxed);
+        do
+        {
+            if(expected & mask)
+            {
+                // lost the race, give back the words claimed so far
+                for(auto j = first_word; j < i; ++j)
+                    mUsed[j].fetch_and(~wordMask(j, first_block, last_block),
+                        std::memory_order_release);
+                return false;
+            }
+        }
+        while(!mUsed[i].compare_exchange_weak(expected, expected | mask,
+            std::memory_order_acq_rel, std::memory_order_relaxed));
+    }
+    mAllocationEnd[last_word].fetch_or(Word(1) << last_block % WORD_BITS,
+        std::memory_order_release);
+    return true;
+}
+
+void BitmapMemoryAllocator::releaseBlocks(
+    const std::size_t first_block,
+    const std::size_t num_blocks)
+{
+    const auto last_block = first_block + num_blocks - 1;
+    const auto last_word = last_block / WORD_BITS;
+    mAllocationEnd[last_word].fetch_and(
+        ~(Word(1) << last_block % WORD_BITS), std::memory_order_relaxed);
+
+    std::size_t released = 0;
+    for(auto i = first_block / WORD_BITS; i <= last_word; ++i)
+    {
+        const auto mask = wordMask(i, first_block, last_block);
+        const auto prev = mUsed[i].fetch_and(~mask, std::memory_order_release);
+        released += utility::popCount(prev & mask);
+    }
+    // otherwise the blocks were freed twice
+    assert(released == num_blocks);
+    mFreeBlocks.fetch_add(released, std::memory_order_relaxed);
+    mDeallocationCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 void * BitmapMemoryAllocator::allocate(
-    const std::size_t num_bytes, const std::size_t alignment)
+    const std::size_t num_bytes, std::size_t alignment)
 {
     if(num_bytes == 0)
         throw std::invalid_argument("allocation size must be greater than 0");
-
-    std::lock_guard<std::mutex> lock_guard(mBitmapLock);
-
     if(alignment == 0)
-    {
-        const auto alloc_unit = utility::calculateSpanningPages(
-            num_bytes, mBlockSize);
+        alignment = 1;
+    if(!utility::isPowerOfTwo(alignment))
+        throw std::invalid_argument("alignment must be a power of two");
 
-        const auto first_free_block = mBitmap.find(std::string(
-            alloc_unit, BLOCK_FREE));
-        if(first_free_block == std::string::npos)
+    // the block starts satisfying the alignment repeat every stride blocks
+    const auto stride = alignment / std::gcd(mBlockSize, alignment);
+    std::size_t phase = 0;
+    while(phase < stride && (mBase + phase * mBlockSize) % alignment)
+        ++phase;
+    // if no block start is aligned, pad the allocation and align the
+    // address within the first block
+    std::size_t padding = 0;
+    if(phase == stride)
+    {
+        if(alignment > mBlockSize)
             throw std::bad_alloc();
-        markBlocksAllocated(
-            mBitmap.begin() + first_free_block,
-            mBitmap.begin() + first_free_block + alloc_unit
-        );
-        return reinterpret_cast<void*>(mBase + first_free_block * mBlockSize);
+        padding = alignment - 1;
+        phase = 0;
     }
 
-    // todo use std::align
-    auto first_addr = utility::roundUpUnsigned(mBase, alignment);
-    const auto end_addr = mBase + mBlockSize * mBitmap.size();
+    const auto num_blocks = utility::calculateSpanningPages(
+        num_bytes + padding, mBlockSize);
     while(true)
     {
-        if(first_addr >= end_addr)
+        if(num_blocks > mFreeBlocks.load(std::memory_order_relaxed))
             throw std::bad_alloc();
-
-        const auto last_addr = first_addr + num_bytes - 1;
-        const auto begin_block = mBitmap.begin() + getAddressBlock(first_addr);
-        const auto end_block = mBitmap.begin() + getAddressBlock(last_addr) + 1;
-        if(std::all_of(
-            begin_block, end_block,
-            [](const char c) { return c == BLOCK_FREE; }))
+        const auto first_block = padding
+            ? findFreeBlocks(num_blocks, 1, 0)
+            : findFreeBlocks(num_blocks, stride, phase);
+        if(first_block == NO_BLOCK)
+            throw std::bad_alloc();
+        if(!claimBlocks(first_block, num_blocks))
+            continue;
+        const auto free_blocks = mFreeBlocks.fetch_sub(
+            num_blocks, std::memory_order_relaxed) - num_blocks;
+        mAllocationCount.fetch_add(1, std::memory_order_relaxed);
+        mAllocatedBlocks.fetch_add(num_blocks, std::memory_order_relaxed);
+        auto min_free = mMinFreeBlocks.load(std::memory_order_relaxed);
+        while(free_blocks < min_free &&
+            !mMinFreeBlocks.compare_exchange_weak(
+                min_free, free_blocks, std::memory_order_relaxed))
         {
-            markBlocksAllocated(begin_block, end_block);
-            return reinterpret_cast<void*>(first_addr);
         }
-
-        first_addr += alignment;
+        const auto address = mBase + first_block * mBlockSize;
+        return reinterpret_cast<void*>(
+            utility::roundUpUnsigned(address, alignment));
     }
 }
 
 void BitmapMemoryAllocator::deallocate(void *pointer)
 {
-    std::lock_guard<std::mutex> lock_guard(mBitmapLock);
-
-    const auto block = getAddressBlock(reinterpret_cast<std::size_t>(pointer));
-    auto iter = mBitmap.begin() + block;
-    assert(*iter == BLOCK_USED_BEGIN);
-    *iter = BLOCK_FREE;
-    while(*++iter == BLOCK_USED)
-        *iter = BLOCK_FREE;
+    const auto first_block = getAddressBlock(
+        reinterpret_cast<std::size_t>(pointer));
+    assert(mUsed[first_block / WORD_BITS].load(std::memory_order_relaxed)
+        & Word(1) << first_block % WORD_BITS);
+
+    // the first allocation end at or after the first block is ours
+    auto i = first_block / WORD_BITS;
+    auto ends = mAllocationEnd[i].load(std::memory_order_acquire)
+        & ~Word(0) << first_block % WORD_BITS;
+    while(!ends)
+    {
+        assert(i + 1 < mWordCount);
+        ends = mAllocationEnd[++i].load(std::memory_order_acquire);
+    }
+    const auto last_block = i * WORD_BITS + utility::countTrailingZeros(ends);
+    releaseBlocks(first_block, last_block - first_block + 1);
 }
 }
@@ -1,33 +1,92 @@
 ﻿#pragma once
 
-#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 #include <Usagi/Utility/Noncopyable.hpp>
 
+#include "AllocatorStats.hpp"
+
 namespace usagi
 {
 /**
- * \brief A thread-safe bitmap allocator for managing remote memory.
+ * \brief A lock-free bitmap allocator for managing remote memory.
+ *
+ * Each block is represented by one bit so free runs are searched one
+ * 64-bit word at a time, skipping fully used or fully free words without
+ * looking at individual bits. Blocks are claimed by compare-and-swap on
+ * the words they span, so allocations fitting in one word never block and
+ * larger ones roll back and retry when they race with another thread.
+ * A second bitmap marks the last block of each allocation so that
+ * deallocation needs only the address.
  */
 class BitmapMemoryAllocator : Noncopyable
 {
-    enum Block : char
-    {
-        BLOCK_FREE = 0,
-        BLOCK_USED = 1,
-        BLOCK_USED_BEGIN = 2,
-    };
+    using Word = std::uint64_t;
+    static constexpr std::size_t WORD_BITS = 64;
+    static constexpr std::size_t NO_BLOCK = SIZE_MAX;
 
     const std::size_t mBase = 0;
     const std::size_t mTotalSize = 0;
     const std::size_t mBlockSize = 0;
-    std::string mBitmap;
-    std::mutex mBitmapLock;
+    const std::size_t mBlockCount = 0;
+    const std::size_t mWordCount = 0;
+
+    /**
+     * \brief Bit set if the block is used. The bits past the last block
+     * are always set.
+     */
+    std::unique_ptr<std::atomic<Word>[]> mUsed;
+    /**
+     * \brief Bit set if the block is the last one of an allocation.
+     */
+    std::unique_ptr<std::atomic<Word>[]> mAllocationEnd;
+    std::atomic<std::size_t> mFreeBlocks;
+
+    // statistics
+    std::atomic<std::size_t> mMinFreeBlocks;
+    std::atomic<std::uint64_t> mAllocationCount = 0;
+    std::atomic<std::uint64_t> mDeallocationCount = 0;
+    std::atomic<std::uint64_t> mAllocatedBlocks = 0;
 
     std::size_t getAddressBlock(std::size_t address) const;
-    void markBlocksAllocated(
-        std::string::iterator begin,
-        std::string::iterator end);
+
+    /**
+     * \brief The bits of the word covered by the blocks
+     * [first_block, last_block].
+     */
+    static Word wordMask(
+        std::size_t word,
+        std::size_t first_block,
+        std::size_t last_block);
+
+    /**
+     * \brief Call visitor(run_begin, run_length) whenever a run of free
+     * blocks is found or extended, until it returns a value other than
+     * NO_BLOCK, which is then returned.
+     */
+    template <typename Visitor>
+    std::size_t visitFreeRuns(Visitor visitor) const;
+
+    /**
+     * \brief Find the first run of free blocks long enough to hold
+     * num_blocks blocks starting at a block satisfying
+     * (block - phase) % stride == 0.
+     * \return The first block of the run or NO_BLOCK if there is none.
+     */
+    std::size_t findFreeBlocks(
+        std::size_t num_blocks,
+        std::size_t stride,
+        std::size_t phase) const;
+
+    /**
+     * \brief Atomically mark the blocks used.
+     * \return false if any of the blocks was taken by another thread since
+     * the search, in which case nothing is changed.
+     */
+    bool claimBlocks(std::size_t first_block, std::size_t num_blocks);
+    void releaseBlocks(std::size_t first_block, std::size_t num_blocks);
 
 public:
     /**
@@ -47,9 +106,34 @@ public:
         std::size_t block_size);
 
     std::size_t managedSize() const { return mTotalSize; }
-    std::size_t usableSize() const;
-    std::size_t usedSize() const { return managedSize() - usableSize(); }
+    std::size_t usableSize() const
+    {
+        return mFreeBlocks.load(std::memory_order_relaxed) * mBlockSize;
+    }
+    std::size_t usedSize() const
+    {
+        return mBlockCount * mBlockSize - usableSize();
+    }
 
+    /**
+     * \brief Size of the largest contiguous free region. Scans the bitmap.
+     * \return
+     */
+    std::size_t largestFreeSize() const;
+
+    /**
+     * \brief The allocation counters are maintained on each call, the
+     * largest free region is found by scanning the bitmap.
+     * \return
+     */
+    AllocatorStats stats() const;
+
+    /**
+     * \brief Allocate memory. Thread-safe.
+     * \param num_bytes
+     * \param alignment Zero or a power of two.
+     * \return
+     */
     void * allocate(std::size_t num_bytes, std::size_t alignment = 0);
     void deallocate(void *pointer);
 };
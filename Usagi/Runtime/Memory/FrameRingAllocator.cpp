@@ -0,0 +1,139 @@
+﻿#include "FrameRingAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <Usagi/Utility/BitHack.hpp>
+#include <Usagi/Utility/Rounding.hpp>
+
+namespace usagi
+{
+FrameRingAllocator::FrameRingAllocator(
+    void *base,
+    const std::size_t total_size,
+    const std::size_t min_alignment)
+    : mBase { reinterpret_cast<std::size_t>(base) }
+    , mSize { total_size }
+    , mMinAlignment { min_alignment }
+{
+    if(!total_size)
+        throw std::invalid_argument("total size must be positive");
+    if(!utility::isPowerOfTwo(min_alignment))
+        throw std::invalid_argument(
+            "minimum alignment must be a power of two");
+}
+
+std::size_t FrameRingAllocator::usedSize() const
+{
+    const auto tail = mTail.load(std::memory_order_acquire);
+    const auto head = mHead.load(std::memory_order_relaxed);
+    // the head may overshoot after failed allocations
+    return std::min(head - tail, mSize);
+}
+
+void * FrameRingAllocator::allocate(
+    const std::size_t num_bytes, std::size_t alignment)
+{
+    if(num_bytes == 0)
+        throw std::invalid_argument("allocation size must be greater than 0");
+    if(alignment != 0 && !utility::isPowerOfTwo(alignment))
+        throw std::invalid_argument("alignment must be a power of two");
+    alignment = std::max(alignment, mMinAlignment);
+    if(num_bytes > mSize)
+        throw std::bad_alloc();
+
+    // the head is always aligned to the minimum alignment, so the common
+    // case only needs an atomic add. over-aligned requests have to read
+    // the head to know the padding.
+    const auto reserved = utility::roundUpUnsigned(num_bytes, mMinAlignment);
+    while(true)
+    {
+        std::size_t begin;
+        if(alignment == mMinAlignment)
+        {
+            begin = mHead.fetch_add(reserved, std::memory_order_relaxed);
+        }
+        else
+        {
+            auto head = mHead.load(std::memory_order_relaxed);
+            do begin = utility::roundUpUnsigned(head, alignment);
+            while(!mHead.compare_exchange_weak(
+                head, begin + reserved, std::memory_order_relaxed));
+        }
+        // the tail only grows, so a stale value is conservative
+        const auto limit = mTail.load(std::memory_order_acquire) + mSize;
+        // give back the reservation if nobody allocated after it, so that
+        // failed requests do not consume the ring
+        const auto give_back = [&]() {
+            auto end = begin + reserved;
+            mHead.compare_exchange_strong(
+                end, begin, std::memory_order_relaxed);
+        };
+
+        auto offset = begin % mSize;
+        if(offset + num_bytes > mSize)
+        {
+            // allocations must be contiguous, so skip the rest of the ring.
+            // the space skipped is reclaimed along with the frame.
+            const auto wrapped = begin - offset + mSize;
+            if(wrapped + num_bytes > limit)
+            {
+                give_back();
+                throw std::bad_alloc();
+            }
+            auto end = begin + reserved;
+            // if another allocation followed, our reservation is wasted
+            // and the next attempt will land after the wrap
+            if(!mHead.compare_exchange_strong(
+                end, wrapped + reserved, std::memory_order_relaxed))
+                continue;
+            offset = 0;
+        }
+        else if(begin + num_bytes > limit)
+        {
+            give_back();
+            throw std::bad_alloc();
+        }
+        return reinterpret_cast<void*>(mBase + offset);
+    }
+}
+
+std::size_t FrameRingAllocator::closeFrame() const
+{
+    const auto used = usedSize();
+    auto peak = mPeakUsed.load(std::memory_order_relaxed);
+    while(used > peak && !mPeakUsed.compare_exchange_weak(
+        peak, used, std::memory_order_relaxed))
+    {
+    }
+    return mHead.load(std::memory_order_relaxed);
+}
+
+AllocatorStats FrameRingAllocator::stats() const
+{
+    const auto tail = mTail.load(std::memory_order_acquire);
+    const auto head = std::max(mHead.load(std::memory_order_relaxed), tail);
+
+    AllocatorStats stats;
+    stats.managed_bytes = mSize;
+    stats.used_bytes = std::min(head - tail, mSize);
+    stats.peak_used_bytes = std::max(
+        mPeakUsed.load(std::memory_order_relaxed), stats.used_bytes);
+    // the free space is contiguous unless it wraps around the end
+    const auto free = mSize - stats.used_bytes;
+    const auto till_end = mSize - head % mSize;
+    stats.largest_free_bytes = std::max(
+        std::min(free, till_end), free - std::min(free, till_end));
+    stats.total_allocated_bytes = head;
+    return stats;
+}
+
+void FrameRingAllocator::retire(const std::size_t frame_mark)
+{
+    auto tail = mTail.load(std::memory_order_relaxed);
+    while(tail < frame_mark && !mTail.compare_exchange_weak(
+        tail, frame_mark, std::memory_order_release))
+    {
+    }
+}
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "AllocatorStats.hpp"
+
+namespace usagi
+{
+/**
+ * \brief A linear allocator over a ring of remote memory for data only
+ * used within one frame, such as streamed geometry.
+ *
+ * Allocation is a single atomic add on the head. Allocations are never
+ * freed individually. Instead, closeFrame() marks the end of the
+ * allocations of a frame when it is submitted, and once the device
+ * finished the frame, retire() reclaims everything allocated before the
+ * mark in one go.
+ *
+ * Positions increase monotonically and are wrapped into the ring when
+ * converted into addresses, so the head and the tail can be compared
+ * without ambiguity.
+ */
+class FrameRingAllocator : Noncopyable
+{
+    const std::size_t mBase = 0;
+    const std::size_t mSize = 0;
+    const std::size_t mMinAlignment = 0;
+
+    // next allocation position
+    std::atomic<std::size_t> mHead = 0;
+    // allocations before this position are retired
+    std::atomic<std::size_t> mTail = 0;
+    // sampled when frames are closed
+    mutable std::atomic<std::size_t> mPeakUsed = 0;
+
+public:
+    /**
+     * \brief
+     * \param base The starting address of the memory region. It must be
+     * aligned to the largest alignment requested, and can be nullptr to
+     * allocate based on offsets.
+     * \param total_size Must be a multiple of the largest alignment
+     * requested, so that the alignment is kept after wrapping around.
+     * \param min_alignment The alignment of all returned addresses. Must be
+     * a power of two.
+     */
+    FrameRingAllocator(
+        void *base,
+        std::size_t total_size,
+        std::size_t min_alignment = 16);
+
+    std::size_t managedSize() const { return mSize; }
+    std::size_t usedSize() const;
+    std::size_t usableSize() const { return mSize - usedSize(); }
+
+    /**
+     * \brief Individual allocations are not counted to keep allocation a
+     * single atomic add, so only the byte totals are reported. The peak
+     * usage is sampled when frames are closed.
+     * \return
+     */
+    AllocatorStats stats() const;
+
+    /**
+     * \brief Allocate memory valid till the frame is retired. Thread-safe.
+     * \param num_bytes
+     * \param alignment Zero or a power of two.
+     * \return
+     */
+    void * allocate(std::size_t num_bytes, std::size_t alignment = 0);
+
+    /**
+     * \brief No-op. The memory is reclaimed by retire().
+     */
+    void deallocate(void *pointer) { }
+
+    /**
+     * \brief End the current frame. Should not be called concurrently with
+     * allocate(), otherwise allocations racing with it may be assigned to
+     * either frame.
+     * \return The position marking the end of the frame.
+     */
+    std::size_t closeFrame() const;
+
+    /**
+     * \brief Reclaim all allocations made before the frame mark. Marks
+     * older than the last retired one are ignored, so frames may be
+     * reported out of order as long as all earlier frames are finished
+     * when a later one is.
+     * \param frame_mark
+     */
+    void retire(std::size_t frame_mark);
+};
+}
@@ -0,0 +1,359 @@
+﻿#include "SlabMemoryAllocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <Usagi/Utility/BitHack.hpp>
+#include <Usagi/Utility/Rounding.hpp>
+
+namespace usagi
+{
+namespace
+{
+// identifies the allocators in the thread-local cache lookup. never reused,
+// so a cache of a destroyed allocator is never found again.
+std::atomic<std::uint64_t> gNextAllocatorId { 1 };
+
+std::size_t roundDownToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while(result <= value / 2) result *= 2;
+    return result;
+}
+
+std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while(result < value) result *= 2;
+    return result;
+}
+}
+
+SlabMemoryAllocator::SlabMemoryAllocator(
+    void *base,
+    const std::size_t total_size,
+    const std::size_t min_alignment)
+    : mBase { reinterpret_cast<std::size_t>(base) }
+    , mMinAlignment { min_alignment }
+    , mId { gNextAllocatorId.fetch_add(1, std::memory_order_relaxed) }
+    , mPages { base, total_size, PAGE_SIZE }
+{
+    if(mBase % SLAB_SIZE)
+        throw std::invalid_argument(
+            "base must be aligned to the slab size");
+    if(total_size < SLAB_SIZE)
+        throw std::invalid_argument(
+            "total size cannot hold a single slab");
+    if(!utility::isPowerOfTwo(min_alignment) ||
+        min_alignment > MAX_SMALL_SIZE)
+        throw std::invalid_argument(
+            "minimum alignment must be a power of two no greater than "
+            "the largest size class");
+
+    // four classes per power of two. every power of two is a class, so
+    // over-aligned requests can be served by rounding them up to one.
+    for(auto size = min_alignment; size <= MAX_SMALL_SIZE;
+        size += std::max(min_alignment, roundDownToPowerOfTwo(size) / 4))
+    {
+        auto size_class = std::make_unique<SizeClass>();
+        size_class->size = size;
+        size_class->batch = std::clamp<std::size_t>(
+            SLAB_SIZE / size / 4, 2, 32);
+        mClasses.push_back(std::move(size_class));
+        mClassSizes.push_back(size);
+    }
+
+    const auto page_count = total_size / PAGE_SIZE;
+    mPageSlabs = std::make_unique<std::atomic<Slab *>[]>(page_count);
+    for(std::size_t i = 0; i < page_count; ++i)
+        mPageSlabs[i].store(nullptr, std::memory_order_relaxed);
+}
+
+SlabMemoryAllocator::ThreadCache & SlabMemoryAllocator::threadCache()
+{
+    // most threads only use one allocator at a time
+    thread_local std::uint64_t last_id = 0;
+    thread_local ThreadCache *last_cache = nullptr;
+    if(last_id == mId)
+        return *last_cache;
+
+    thread_local std::unordered_map<std::uint64_t, ThreadCache *> caches;
+    auto &cache = caches[mId];
+    if(!cache)
+    {
+        auto new_cache = std::make_unique<ThreadCache>();
+        new_cache->objects.resize(mClasses.size());
+        cache = new_cache.get();
+        std::lock_guard<std::mutex> lock(mCachesLock);
+        mCaches.push_back(std::move(new_cache));
+    }
+    last_id = mId;
+    last_cache = cache;
+    return *cache;
+}
+
+std::size_t SlabMemoryAllocator::sizeClassOf(const std::size_t num_bytes) const
+{
+    assert(num_bytes <= MAX_SMALL_SIZE);
+    return std::lower_bound(mClassSizes.begin(), mClassSizes.end(), num_bytes)
+        - mClassSizes.begin();
+}
+
+SlabMemoryAllocator::Slab * SlabMemoryAllocator::slabOf(
+    const std::size_t offset) const
+{
+    return mPageSlabs[offset / PAGE_SIZE].load(std::memory_order_acquire);
+}
+
+SlabMemoryAllocator::Slab * SlabMemoryAllocator::createSlab(
+    SizeClass &size_class, const std::size_t class_index)
+{
+    void *memory;
+    try
+    {
+        memory = mPages.allocate(SLAB_SIZE, SLAB_SIZE);
+    }
+    catch(const std::bad_alloc &)
+    {
+        return nullptr;
+    }
+
+    auto slab = std::make_unique<Slab>();
+    slab->offset = reinterpret_cast<std::size_t>(memory) - mBase;
+    slab->size_class = class_index;
+    slab->capacity = SLAB_SIZE / size_class.size;
+    // hand out the objects from the lower addresses first
+    slab->free.reserve(slab->capacity);
+    for(auto i = slab->capacity; i > 0; --i)
+        slab->free.push_back(static_cast<std::uint32_t>(i - 1));
+    slab->slab_pos = size_class.slabs.size();
+    slab->partial_pos = size_class.partial.size();
+
+    const auto r = slab.get();
+    size_class.partial.push_back(r);
+    size_class.slabs.push_back(std::move(slab));
+    for(std::size_t i = 0; i < SLAB_SIZE / PAGE_SIZE; ++i)
+    {
+        mPageSlabs[r->offset / PAGE_SIZE + i].store(
+            r, std::memory_order_release);
+    }
+    mSlabBytes.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+    mSlabsCreated.fetch_add(1, std::memory_order_relaxed);
+    return r;
+}
+
+void SlabMemoryAllocator::releaseSlab(SizeClass &size_class, Slab *slab)
+{
+    for(std::size_t i = 0; i < SLAB_SIZE / PAGE_SIZE; ++i)
+    {
+        mPageSlabs[slab->offset / PAGE_SIZE + i].store(
+            nullptr, std::memory_order_release);
+    }
+    mSlabBytes.fetch_sub(SLAB_SIZE, std::memory_order_relaxed);
+    mSlabsReleased.fetch_add(1, std::memory_order_relaxed);
+    mPages.deallocate(reinterpret_cast<void*>(mBase + slab->offset));
+
+    if(slab->partial_pos != NOT_PARTIAL)
+    {
+        auto &partial = size_class.partial;
+        partial[slab->partial_pos] = partial.back();
+        partial[slab->partial_pos]->partial_pos = slab->partial_pos;
+        partial.pop_back();
+    }
+    auto &slabs = size_class.slabs;
+    const auto pos = slab->slab_pos;
+    std::swap(slabs[pos], slabs.back());
+    slabs[pos]->slab_pos = pos;
+    slabs.pop_back();
+}
+
+void SlabMemoryAllocator::refill(
+    const std::size_t class_index,
+    std::vector<std::size_t> &objects)
+{
+    auto &size_class = *mClasses[class_index];
+    std::lock_guard<std::mutex> lock(size_class.lock);
+
+    while(objects.size() < size_class.batch)
+    {
+        Slab *slab;
+        if(size_class.partial.empty())
+        {
+            slab = createSlab(size_class, class_index);
+            updatePeakUsage();
+        }
+        else
+        {
+            slab = size_class.partial.back();
+        }
+        if(!slab) break;
+
+        while(!slab->free.empty() && objects.size() < size_class.batch)
+        {
+            objects.push_back(
+                slab->offset + slab->free.back() * size_class.size);
+            slab->free.pop_back();
+        }
+        if(slab->free.empty())
+        {
+            // always the last one in the partial list
+            assert(size_class.partial.back() == slab);
+            size_class.partial.pop_back();
+            slab->partial_pos = NOT_PARTIAL;
+        }
+    }
+    if(objects.empty())
+        throw std::bad_alloc();
+}
+
+void SlabMemoryAllocator::flush(
+    const std::size_t class_index,
+    std::vector<std::size_t> &objects,
+    const std::size_t count)
+{
+    auto &size_class = *mClasses[class_index];
+    std::lock_guard<std::mutex> lock(size_class.lock);
+
+    for(std::size_t i = objects.size() - count; i < objects.size(); ++i)
+    {
+        const auto slab = slabOf(objects[i]);
+        assert(slab && slab->size_class == class_index);
+        if(slab->free.empty())
+        {
+            slab->partial_pos = size_class.partial.size();
+            size_class.partial.push_back(slab);
+        }
+        slab->free.push_back(static_cast<std::uint32_t>(
+            (objects[i] - slab->offset) / size_class.size));
+        // keep one slab around to avoid repeatedly creating and releasing
+        // slabs at the boundary
+        if(slab->free.size() == slab->capacity &&
+            size_class.partial.size() > 1)
+            releaseSlab(size_class, slab);
+    }
+    objects.resize(objects.size() - count);
+}
+
+std::ptrdiff_t SlabMemoryAllocator::smallUsedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mCachesLock);
+    std::ptrdiff_t bytes = 0;
+    for(auto &&c : mCaches)
+        bytes += c->used_bytes.load(std::memory_order_relaxed);
+    return bytes;
+}
+
+void SlabMemoryAllocator::updatePeakUsage() const
+{
+    const auto used = usedSize();
+    auto peak = mPeakUsed.load(std::memory_order_relaxed);
+    while(used > peak && !mPeakUsed.compare_exchange_weak(
+        peak, used, std::memory_order_relaxed))
+    {
+    }
+}
+
+AllocatorStats SlabMemoryAllocator::stats() const
+{
+    updatePeakUsage();
+
+    const auto pages = mPages.stats();
+    AllocatorStats stats;
+    stats.managed_bytes = pages.managed_bytes;
+    stats.used_bytes = usedSize();
+    stats.peak_used_bytes = mPeakUsed.load(std::memory_order_relaxed);
+    stats.largest_free_bytes = pages.largest_free_bytes;
+    stats.total_allocations = pages.total_allocations
+        - mSlabsCreated.load(std::memory_order_relaxed);
+    stats.total_deallocations = pages.total_deallocations
+        - mSlabsReleased.load(std::memory_order_relaxed);
+    stats.total_allocated_bytes = pages.total_allocated_bytes
+        - mSlabsCreated.load(std::memory_order_relaxed) * SLAB_SIZE;
+    {
+        std::lock_guard<std::mutex> lock(mCachesLock);
+        for(auto &&c : mCaches)
+        {
+            stats.total_allocations +=
+                c->allocations.load(std::memory_order_relaxed);
+            stats.total_deallocations +=
+                c->deallocations.load(std::memory_order_relaxed);
+            stats.total_allocated_bytes +=
+                c->allocated_bytes.load(std::memory_order_relaxed);
+        }
+    }
+    return stats;
+}
+
+std::size_t SlabMemoryAllocator::usableSize() const
+{
+    return mPages.usableSize()
+        + mSlabBytes.load(std::memory_order_relaxed) - smallUsedBytes();
+}
+
+std::size_t SlabMemoryAllocator::usedSize() const
+{
+    return mPages.usedSize()
+        - mSlabBytes.load(std::memory_order_relaxed) + smallUsedBytes();
+}
+
+void * SlabMemoryAllocator::allocate(
+    const std::size_t num_bytes, const std::size_t alignment)
+{
+    if(num_bytes == 0)
+        throw std::invalid_argument("allocation size must be greater than 0");
+    if(alignment != 0 && !utility::isPowerOfTwo(alignment))
+        throw std::invalid_argument("alignment must be a power of two");
+
+    // the objects of the power-of-two classes are aligned to their size
+    const auto size = alignment > mMinAlignment
+        ? roundUpToPowerOfTwo(std::max(num_bytes, alignment))
+        : num_bytes;
+    if(size > MAX_SMALL_SIZE)
+        return mPages.allocate(num_bytes, std::max(alignment, mMinAlignment));
+
+    const auto class_index = sizeClassOf(size);
+    auto &cache = threadCache();
+    auto &objects = cache.objects[class_index];
+    if(objects.empty())
+        refill(class_index, objects);
+    const auto offset = objects.back();
+    objects.pop_back();
+    cache.used_bytes.store(
+        cache.used_bytes.load(std::memory_order_relaxed)
+        + mClassSizes[class_index], std::memory_order_relaxed);
+    cache.allocations.store(
+        cache.allocations.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    cache.allocated_bytes.store(
+        cache.allocated_bytes.load(std::memory_order_relaxed)
+        + mClassSizes[class_index], std::memory_order_relaxed);
+    return reinterpret_cast<void*>(mBase + offset);
+}
+
+void SlabMemoryAllocator::deallocate(void *pointer)
+{
+    const auto offset = reinterpret_cast<std::size_t>(pointer) - mBase;
+    const auto slab = slabOf(offset);
+    if(!slab)
+    {
+        mPages.deallocate(pointer);
+        return;
+    }
+
+    const auto class_index = slab->size_class;
+    auto &cache = threadCache();
+    auto &objects = cache.objects[class_index];
+    objects.push_back(offset);
+    cache.used_bytes.store(
+        cache.used_bytes.load(std::memory_order_relaxed)
+        - mClassSizes[class_index], std::memory_order_relaxed);
+    cache.deallocations.store(
+        cache.deallocations.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    const auto batch = mClasses[class_index]->batch;
+    if(objects.size() > 2 * batch)
+        flush(class_index, objects, batch);
+}
+}
@@ -0,0 +1,154 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Usagi/Utility/Noncopyable.hpp>
+
+#include "BitmapMemoryAllocator.hpp"
+
+namespace usagi
+{
+/**
+ * \brief A size-class segregated allocator for managing remote memory.
+ *
+ * Small requests are rounded up to one of the size classes, spaced four per
+ * power of two so that the rounding wastes at most a quarter of the
+ * request. Each class carves fixed-size objects out of slabs, which are
+ * allocated from an underlying BitmapMemoryAllocator like any request too
+ * big for the size classes. Every thread keeps a cache of free objects of
+ * each class, so most allocations and deallocations touch no shared state.
+ * The caches are refilled from and flushed to the slabs in batches under a
+ * per-class lock, and slabs which become entirely free are returned to the
+ * bitmap, which keeps the fragmentation bounded over long sessions.
+ *
+ * Since the managed memory may not be accessible by the host, all
+ * bookkeeping is kept in host memory. The objects cached by a thread are
+ * not reused by other threads after it exits until the allocator is
+ * destroyed.
+ */
+class SlabMemoryAllocator : Noncopyable
+{
+public:
+    static constexpr std::size_t PAGE_SIZE = 4 * 1024;
+    static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+    static constexpr std::size_t MAX_SMALL_SIZE = SLAB_SIZE / 8;
+
+private:
+    const std::size_t mBase = 0;
+    const std::size_t mMinAlignment = 0;
+    const std::uint64_t mId = 0;
+
+    BitmapMemoryAllocator mPages;
+
+    struct Slab
+    {
+        std::size_t offset = 0;
+        std::size_t size_class = 0;
+        std::size_t capacity = 0;
+        // indices of the free objects
+        std::vector<std::uint32_t> free;
+        // position in SizeClass::slabs and SizeClass::partial
+        std::size_t slab_pos = 0;
+        std::size_t partial_pos = NOT_PARTIAL;
+    };
+
+    static constexpr std::size_t NOT_PARTIAL = SIZE_MAX;
+
+    struct SizeClass
+    {
+        std::size_t size = 0;
+        std::size_t batch = 0;
+        std::mutex lock;
+        std::vector<std::unique_ptr<Slab>> slabs;
+        // slabs with free objects
+        std::vector<Slab *> partial;
+    };
+
+    std::vector<std::unique_ptr<SizeClass>> mClasses;
+    // sizes of the classes in ascending order
+    std::vector<std::size_t> mClassSizes;
+
+    /**
+     * \brief The slab occupying each page. nullptr if the page is free or
+     * is part of a large allocation.
+     */
+    std::unique_ptr<std::atomic<Slab *>[]> mPageSlabs;
+    std::atomic<std::size_t> mSlabBytes = 0;
+
+    // statistics. the slabs are also counted by the page allocator, which
+    // needs to be subtracted from its counts.
+    std::atomic<std::uint64_t> mSlabsCreated = 0;
+    std::atomic<std::uint64_t> mSlabsReleased = 0;
+    // sampled when slabs are created and when stats() is called
+    mutable std::atomic<std::size_t> mPeakUsed = 0;
+    void updatePeakUsage() const;
+
+    struct ThreadCache
+    {
+        // offsets of the cached objects of each size class
+        std::vector<std::vector<std::size_t>> objects;
+        // bytes of small objects allocated minus freed by this thread.
+        // only written by the owning thread.
+        std::atomic<std::ptrdiff_t> used_bytes = 0;
+        std::atomic<std::uint64_t> allocations = 0;
+        std::atomic<std::uint64_t> deallocations = 0;
+        std::atomic<std::uint64_t> allocated_bytes = 0;
+    };
+
+    mutable std::mutex mCachesLock;
+    std::vector<std::unique_ptr<ThreadCache>> mCaches;
+
+    ThreadCache & threadCache();
+    std::size_t sizeClassOf(std::size_t num_bytes) const;
+    Slab * slabOf(std::size_t offset) const;
+    Slab * createSlab(SizeClass &size_class, std::size_t class_index);
+    void releaseSlab(SizeClass &size_class, Slab *slab);
+    void refill(std::size_t class_index, std::vector<std::size_t> &objects);
+    void flush(
+        std::size_t class_index,
+        std::vector<std::size_t> &objects,
+        std::size_t count);
+    std::ptrdiff_t smallUsedBytes() const;
+
+public:
+    /**
+     * \brief
+     * \param base The starting address of the memory region. It must be
+     * aligned to SLAB_SIZE, and can be nullptr to allocate based on
+     * offsets.
+     * \param total_size Total usable size. Must be at least SLAB_SIZE.
+     * \param min_alignment The alignment of all returned addresses, also
+     * the granularity of the size classes. Must be a power of two no
+     * greater than MAX_SMALL_SIZE.
+     */
+    SlabMemoryAllocator(
+        void *base,
+        std::size_t total_size,
+        std::size_t min_alignment = 16);
+
+    std::size_t managedSize() const { return mPages.managedSize(); }
+    std::size_t usableSize() const;
+    std::size_t usedSize() const;
+
+    /**
+     * \brief The peak usage is sampled when new slabs are needed and when
+     * this function is called, so short spikes within the cached objects
+     * may be missed.
+     * \return
+     */
+    AllocatorStats stats() const;
+
+    /**
+     * \brief Allocate memory. Thread-safe.
+     * \param num_bytes
+     * \param alignment Zero or a power of two.
+     * \return
+     */
+    void * allocate(std::size_t num_bytes, std::size_t alignment = 0);
+    void deallocate(void *pointer);
+};
+}
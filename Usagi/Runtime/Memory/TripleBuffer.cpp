@@ -1,5 +0,0 @@
-﻿#include "DoubleBuffering.hpp"
-
-namespace yuki::memory
-{
-}
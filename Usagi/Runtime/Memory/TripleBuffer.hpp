@@ -1,60 +1,154 @@
 ﻿#pragma once
 
-#include <memory>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
-namespace yuki::memory
+#include <Usagi/Utility/Noncopyable.hpp>
+
+namespace usagi
 {
 /**
- * \brief Buffer for asynchronize read and write at different speed.
- * Can be customized for both CPU and GPU usages.
- * 
- * Requirements:
- * No assumption on the operations supported by Buffer.
- * Support resource staging.
- * 
- * Invariants:
- * read() != write()
- * 
- * Considerations:
- * Updating status before & after each frame is too costly.
- * Synchronize implicitly?
- * 
- * todo Triple buffer should be enough for games, but consider extending to multiple buffers
- * 
- * References:
- * https://users.rust-lang.org/t/spmc-buffer-triple-buffering-for-multiple-consumers/10118/2
- * https://docs.unrealengine.com/latest/INT/API/Runtime/Core/Containers/TTripleBuffer/
- * 
- * Memory Management Startegies:
- * https://msdn.microsoft.com/en-us/library/windows/desktop/mt613239(v=vs.85).aspx
- * elements like gui must be copied before rendering
- * object streaming can be done at the background
- * https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples
- * 
- * \tparam Buffer 
- * \tparam FallbackPolicy 
+ * \brief Passes snapshots from one producer thread to one consumer thread
+ * running at different rates, such as the simulation and the renderer.
+ * The producer always has a buffer to write into and the consumer always
+ * reads the latest complete snapshot, without either of them waiting for
+ * the other.
+ *
+ * The producer owns one buffer and the consumer owns N - 2 buffers. The
+ * remaining one is exchanged between them through a single atomic word
+ * holding its index and whether it contains a snapshot not yet taken by
+ * the consumer. Both sides swap their buffers with it using one atomic
+ * exchange, so all operations are wait-free. If the producer publishes
+ * faster than the consumer reads, the older snapshots are dropped.
+ *
+ * With N = 3 this is the classic triple buffer. Larger N let the consumer
+ * keep using the previous N - 3 snapshots after taking a new one, which
+ * is needed when the buffers are read by the GPU with several frames in
+ * flight: a buffer is only handed back to the producer after the consumer
+ * took N - 2 newer snapshots.
+ *
+ * Buffer may be any type, e.g. a plain struct for CPU data or a
+ * std::shared_ptr<GpuBuffer> for data read by the GPU. The buffers are
+ * reused, so the producer must overwrite everything it relies on.
+ *
+ * \tparam Buffer
+ * \tparam N Number of buffers.
  */
-template <
-    typename Buffer,
-    typename WriteProxy,
-    typename FallbackPolicy
->
-class TripleBuffer
+template <typename Buffer, std::size_t N>
+class MultiBuffer : Noncopyable
 {
-    std::shared_ptr<Buffer> mBuffers[3];
-    uint8_t mBack = 0, mStaging = 1, mFront = 2;
+    static_assert(N >= 3, "At least three buffers are required.");
+    static_assert(N <= 128, "Too many buffers.");
+
+    static constexpr std::uint8_t INDEX_MASK = 0x7f;
+    static constexpr std::uint8_t FRESH = 0x80;
+
+    std::array<Buffer, N> mBuffers;
+
+    // the buffer being exchanged. FRESH is set when it holds a snapshot
+    // not yet taken by the consumer.
+    alignas(64) std::atomic<std::uint8_t> mShared { 1 };
+
+    // producer state
+    alignas(64) std::uint8_t mWriteIndex = 0;
+
+    // consumer state. the buffers taken by the consumer in a ring, the
+    // latest one at mNewest.
+    alignas(64) std::array<std::uint8_t, N - 2> mReadIndices;
+    std::size_t mNewest = N - 3;
+
+    template <typename Factory, std::size_t... I>
+    static std::array<Buffer, N> makeBuffers(
+        Factory &factory,
+        std::index_sequence<I...>)
+    {
+        return { { factory(I)... } };
+    }
 
 public:
-    std::shared_ptr<Buffer> & read()
+    MultiBuffer()
+    {
+        for(std::size_t i = 0; i < N - 2; ++i)
+            mReadIndices[i] = static_cast<std::uint8_t>(i + 2);
+    }
+
+    /**
+     * \brief Construct the buffers using factory(index).
+     * \tparam Factory
+     * \param factory
+     */
+    template <typename Factory>
+    explicit MultiBuffer(Factory &&factory)
+        : mBuffers { makeBuffers(factory, std::make_index_sequence<N>()) }
     {
-        return mBuffers[mFront];
+        for(std::size_t i = 0; i < N - 2; ++i)
+            mReadIndices[i] = static_cast<std::uint8_t>(i + 2);
     }
 
-    Buffer & write()
+    // Producer
+
+    /**
+     * \brief The buffer owned by the producer. May contain any older
+     * snapshot.
+     * \return
+     */
+    Buffer & writeBuffer() { return mBuffers[mWriteIndex]; }
+
+    /**
+     * \brief Make the write buffer the latest snapshot and take another
+     * buffer to write into.
+     */
+    void publish()
     {
-        if(mBuffers[mBack].count() )
-        return *mBuffers[mBack].get();
+        const auto previous = mShared.exchange(
+            mWriteIndex | FRESH, std::memory_order_acq_rel);
+        mWriteIndex = previous & INDEX_MASK;
     }
 
+    // Consumer
+
+    /**
+     * \brief Take the latest snapshot if there is one newer than the
+     * current read buffer.
+     * \return Whether the read buffer changed.
+     */
+    bool update()
+    {
+        if(!(mShared.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        // hand over the oldest buffer taken
+        const auto oldest = (mNewest + 1) % (N - 2);
+        const auto previous = mShared.exchange(
+            mReadIndices[oldest], std::memory_order_acq_rel);
+        mReadIndices[oldest] = previous & INDEX_MASK;
+        mNewest = oldest;
+        return true;
+    }
+
+    /**
+     * \brief The latest snapshot taken by update(). Before the first
+     * snapshot is taken, it is a buffer in its initial state.
+     * \return
+     */
+    Buffer & readBuffer() { return mBuffers[mReadIndices[mNewest]]; }
+
+    /**
+     * \brief A snapshot taken before the current one, which is still not
+     * handed back to the producer.
+     * \param age 0 is the current one. Must be less than N - 2.
+     * \return
+     */
+    Buffer & readBuffer(const std::size_t age)
+    {
+        assert(age < N - 2);
+        return mBuffers[mReadIndices[(mNewest + (N - 2) - age) % (N - 2)]];
+    }
 };
+
+template <typename Buffer>
+using TripleBuffer = MultiBuffer<Buffer, 3>;
 }
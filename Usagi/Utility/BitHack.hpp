@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace usagi::utility
 {
 // https://stackoverflow.com/questions/108318/whats-the-simplest-way-to-test-whether-a-number-is-a-power-of-2-in-c
@@ -14,4 +20,29 @@ bool isPowerOfTwo(T value)
 {
     return (value & (value - 1)) == 0 && value != 0;
 }
+
+/**
+ * \brief Index of the lowest set bit. The value must not be zero.
+ * \param value
+ * \return
+ */
+inline unsigned countTrailingZeros(const std::uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+inline unsigned popCount(const std::uint64_t value)
+{
+#ifdef _MSC_VER
+    return static_cast<unsigned>(__popcnt64(value));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(value));
+#endif
+}
 }
@@ -6,22 +6,26 @@
 
 using namespace CryptoPP;
 
-std::string usagi::sha256(const std::string &string)
+std::string usagi::sha256(const std::string_view string)
 {
     std::string digest;
     SHA256 hash;
-    const StringSource src(string, true, new HashFilter(
-        hash, new HexEncoder(new StringSink(digest), false)
-    ));
+    const StringSource src(
+        reinterpret_cast<const unsigned char*>(string.data()), string.size(),
+        true, new HashFilter(
+            hash, new HexEncoder(new StringSink(digest), false)
+        ));
     return digest;
 }
 
-std::string usagi::crc32(const std::string &string)
+std::string usagi::crc32(const std::string_view string)
 {
     std::string digest;
     CRC32 hash;
-    const StringSource src(string, true, new HashFilter(
-        hash, new HexEncoder(new StringSink(digest), false)
-    ));
+    const StringSource src(
+        reinterpret_cast<const unsigned char*>(string.data()), string.size(),
+        true, new HashFilter(
+            hash, new HexEncoder(new StringSink(digest), false)
+        ));
     return digest;
 }
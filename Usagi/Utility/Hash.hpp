@@ -1,9 +1,10 @@
 ﻿#pragma once
 
 #include <string>
+#include <string_view>
 
 namespace usagi
 {
-std::string sha256(const std::string &string);
-std::string crc32(const std::string &string);
+std::string sha256(std::string_view string);
+std::string crc32(std::string_view string);
 }
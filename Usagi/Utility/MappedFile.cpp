@@ -0,0 +1,114 @@
+﻿#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <Usagi/Core/Logging.hpp>
+
+#include "Noncopyable.hpp"
+
+namespace
+{
+class FileMapping : usagi::Noncopyable
+{
+    const void *mAddress = nullptr;
+    std::size_t mSize = 0;
+
+public:
+    explicit FileMapping(const std::filesystem::path &path)
+    {
+#ifdef _WIN32
+        const auto file = CreateFileW(path.c_str(), GENERIC_READ,
+            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open file.");
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to query file size.");
+        }
+        mSize = static_cast<std::size_t>(size.QuadPart);
+        if(mSize == 0)
+        {
+            CloseHandle(file);
+            return;
+        }
+        const auto mapping = CreateFileMappingW(
+            file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        // the view keeps the mapping and the file open
+        CloseHandle(file);
+        if(!mapping)
+            throw std::runtime_error("Failed to create file mapping.");
+        mAddress = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if(!mAddress)
+            throw std::runtime_error("Failed to map file.");
+#else
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::runtime_error("Failed to open file.");
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Failed to query file size.");
+        }
+        mSize = static_cast<std::size_t>(st.st_size);
+        if(mSize == 0)
+        {
+            ::close(fd);
+            return;
+        }
+        const auto address = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping keeps the file open
+        ::close(fd);
+        if(address == MAP_FAILED)
+            throw std::runtime_error("Failed to map file.");
+        mAddress = address;
+#endif
+    }
+
+    ~FileMapping()
+    {
+        if(!mAddress) return;
+#ifdef _WIN32
+        UnmapViewOfFile(mAddress);
+#else
+        munmap(const_cast<void*>(mAddress), mSize);
+#endif
+    }
+
+    const void * address() const { return mAddress; }
+    std::size_t size() const { return mSize; }
+};
+}
+
+usagi::MemoryView usagi::mapFile(const std::filesystem::path &path)
+{
+    std::shared_ptr<FileMapping> mapping;
+    try
+    {
+        mapping = std::make_shared<FileMapping>(path);
+    }
+    catch(const std::exception &e)
+    {
+        LOG(error, "Failed to map {}: {}", path.u8string(), e.what());
+        throw;
+    }
+    if(mapping->size() == 0)
+        return { };
+    const auto address = mapping->address();
+    const auto size = mapping->size();
+    return { std::move(mapping), address, size };
+}
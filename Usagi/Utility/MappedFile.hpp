@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <filesystem>
+
+#include "MemoryView.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Map the whole file into memory for reading. The pages are loaded on
+ * demand and shared with other processes mapping the same file through the
+ * page cache of the OS. The mapping is released when the last copy of the
+ * returned view is destroyed.
+ * \param path
+ * \return An empty view if the file is empty.
+ */
+MemoryView mapFile(const std::filesystem::path &path);
+}
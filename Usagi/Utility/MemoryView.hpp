@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace usagi
+{
+/**
+ * \brief A read-only span of bytes which keeps the memory it refers to
+ * alive, such as a memory-mapped file. Copying the view does not copy the
+ * memory.
+ */
+class MemoryView
+{
+    std::shared_ptr<const void> mOwner;
+    const std::byte *mData = nullptr;
+    std::size_t mSize = 0;
+
+public:
+    MemoryView() = default;
+
+    MemoryView(
+        std::shared_ptr<const void> owner,
+        const void *data,
+        const std::size_t size)
+        : mOwner { std::move(owner) }
+        , mData { static_cast<const std::byte*>(data) }
+        , mSize { size }
+    {
+    }
+
+    const std::byte * data() const { return mData; }
+    std::size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    const std::byte * begin() const { return mData; }
+    const std::byte * end() const { return mData + mSize; }
+
+    std::string_view asStringView() const
+    {
+        return { reinterpret_cast<const char*>(mData), mSize };
+    }
+
+    /**
+     * \brief A view of a part of the memory sharing the same owner.
+     * \param offset
+     * \param size
+     * \return
+     */
+    MemoryView subview(const std::size_t offset, const std::size_t size) const
+    {
+        return { mOwner, mData + offset, size };
+    }
+};
+}
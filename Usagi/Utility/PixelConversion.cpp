@@ -0,0 +1,579 @@
+﻿#include "PixelConversion.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define USAGI_PIXEL_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC allows using any intrinsic without enabling the instruction set for
+// the whole file, while GCC and Clang need it enabled per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define USAGI_TARGET(features)
+#else
+#define USAGI_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace
+{
+struct CpuFeatures
+{
+    bool ssse3 = false;
+    bool avx2 = false;
+    bool f16c = false;
+};
+
+#ifdef USAGI_PIXEL_SIMD
+void cpuid(const int leaf, unsigned regs[4])
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, leaf, 0);
+    for(int i = 0; i < 4; ++i)
+        regs[i] = static_cast<unsigned>(info[i]);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+std::uint64_t xgetbv()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (std::uint64_t(hi) << 32) | lo;
+#endif
+}
+
+CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures features;
+    unsigned regs[4];
+    cpuid(0, regs);
+    const auto max_leaf = regs[0];
+    cpuid(1, regs);
+    const auto ecx = regs[2];
+    features.ssse3 = ecx & (1u << 9);
+    // the OS must save the AVX registers on context switches
+    const bool avx = (ecx & (1u << 28)) && (ecx & (1u << 27)) &&
+        (xgetbv() & 0x6) == 0x6;
+    features.f16c = avx && (ecx & (1u << 29));
+    if(avx && max_leaf >= 7)
+    {
+        cpuid(7, regs);
+        features.avx2 = regs[1] & (1u << 5);
+    }
+    return features;
+}
+#else
+CpuFeatures detectCpuFeatures()
+{
+    return { };
+}
+#endif
+
+const CpuFeatures & cpu()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+std::uint8_t premultiply(const unsigned color, const unsigned alpha)
+{
+    // color * alpha / 255 rounded to nearest
+    const auto t = color * alpha + 128;
+    return static_cast<std::uint8_t>((t + (t >> 8)) >> 8);
+}
+
+struct SrgbTables
+{
+    std::array<float, 256> to_linear;
+    // the midpoints between the linear values of adjacent sRGB codes
+    std::array<float, 255> thresholds;
+
+    SrgbTables()
+    {
+        for(std::size_t i = 0; i < to_linear.size(); ++i)
+        {
+            const auto c = i / 255.f;
+            to_linear[i] = c <= 0.04045f
+                ? c / 12.92f
+                : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for(std::size_t i = 0; i < thresholds.size(); ++i)
+            thresholds[i] = (to_linear[i] + to_linear[i + 1]) * 0.5f;
+    }
+
+    std::uint8_t toSrgb(const float linear) const
+    {
+        return static_cast<std::uint8_t>(std::upper_bound(
+            thresholds.begin(), thresholds.end(), linear
+        ) - thresholds.begin());
+    }
+};
+
+const SrgbTables & srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+#ifdef USAGI_PIXEL_SIMD
+USAGI_TARGET("ssse3")
+std::size_t convertRgb8ToRgba8Ssse3(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto shuffle = _mm_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const auto alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    // each load reads 16 bytes but only uses the 12 bytes of 4 pixels, so
+    // stop before reading past the end of the source.
+    for(; i + 6 <= pixel_count; i += 4)
+    {
+        auto v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i * 3));
+        v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+    }
+    return i;
+}
+
+std::size_t convertL8ToRgba8Sse2(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for(; i + 16 <= pixel_count; i += 16)
+    {
+        const auto v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i));
+        // duplicate each byte twice, then each pair twice
+        const auto lo = _mm_unpacklo_epi8(v, v);
+        const auto hi = _mm_unpackhi_epi8(v, v);
+        const auto out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0,
+            _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+        _mm_storeu_si128(out + 1,
+            _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+        _mm_storeu_si128(out + 2,
+            _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+        _mm_storeu_si128(out + 3,
+            _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+    }
+    return i;
+}
+
+std::size_t convertLa8ToRgba8Sse2(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto lum_mask = _mm_set1_epi16(0xFF);
+    std::size_t i = 0;
+    for(; i + 8 <= pixel_count; i += 8)
+    {
+        // each 16-bit lane holds the luminance in the low byte and the
+        // alpha in the high byte, which makes the second half of a pixel.
+        const auto la = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i * 2));
+        const auto l = _mm_and_si128(la, lum_mask);
+        const auto ll = _mm_or_si128(l, _mm_slli_epi16(l, 8));
+        const auto out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(ll, la));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(ll, la));
+    }
+    return i;
+}
+
+// multiply the 16-bit color lanes of two pixels by their alpha
+__m128i premultiplyLanes(const __m128i pixels)
+{
+    const auto round = _mm_set1_epi16(128);
+    const auto alpha = _mm_shufflehi_epi16(
+        _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)),
+        _MM_SHUFFLE(3, 3, 3, 3));
+    const auto t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), round);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+std::size_t premultiplyRgba8Sse2(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for(; i + 4 <= pixel_count; i += 4)
+    {
+        const auto v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i * 4));
+        auto r = _mm_packus_epi16(
+            premultiplyLanes(_mm_unpacklo_epi8(v, zero)),
+            premultiplyLanes(_mm_unpackhi_epi8(v, zero)));
+        // keep the original alpha
+        r = _mm_or_si128(
+            _mm_andnot_si128(alpha_mask, r),
+            _mm_and_si128(alpha_mask, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), r);
+    }
+    return i;
+}
+
+// the AVX2 instructions operate on each 128-bit lane separately like the
+// SSE2 version, so unpacking and packing keep the order of the pixels.
+USAGI_TARGET("avx2")
+__m256i premultiplyLanesAvx2(const __m256i pixels)
+{
+    const auto round = _mm256_set1_epi16(128);
+    const auto alpha = _mm256_shufflehi_epi16(
+        _mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)),
+        _MM_SHUFFLE(3, 3, 3, 3));
+    const auto t = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), round);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+USAGI_TARGET("avx2")
+std::size_t premultiplyRgba8Avx2(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto zero = _mm256_setzero_si256();
+    const auto alpha_mask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for(; i + 8 <= pixel_count; i += 8)
+    {
+        const auto v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + i * 4));
+        auto r = _mm256_packus_epi16(
+            premultiplyLanesAvx2(_mm256_unpacklo_epi8(v, zero)),
+            premultiplyLanesAvx2(_mm256_unpackhi_epi8(v, zero)));
+        r = _mm256_or_si256(
+            _mm256_andnot_si256(alpha_mask, r),
+            _mm256_and_si256(alpha_mask, v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), r);
+    }
+    return i;
+}
+
+USAGI_TARGET("avx,f16c")
+std::size_t convertFloat32ToFloat16F16c(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t count)
+{
+    std::size_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const auto h = _mm256_cvtps_ph(
+            _mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    return i;
+}
+
+USAGI_TARGET("avx,f16c")
+std::size_t convertRgb32fToRgba16fF16c(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto one = _mm_set1_ps(1.f);
+    std::size_t i = 0;
+    // each load reads the first channel of the next pixel, which is
+    // replaced by the alpha.
+    for(; i + 2 <= pixel_count; ++i)
+    {
+        const auto v = _mm_blend_ps(_mm_loadu_ps(src + i * 3), one, 0x8);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 4),
+            _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+USAGI_TARGET("avx,f16c")
+std::size_t convertL32fToRgba16fF16c(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    const auto one = _mm256_set1_ps(1.f);
+    std::size_t i = 0;
+    for(; i + 4 <= pixel_count; i += 4)
+    {
+        // l0 l1 l2 l3 -> l0 l0 l0 1 l1 l1 l1 1, l2 l2 l2 1 l3 l3 l3 1
+        const auto l = _mm_loadu_ps(src + i);
+        const auto lo = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(_mm_shuffle_ps(l, l, 0x00)),
+            _mm_shuffle_ps(l, l, 0x55), 1);
+        const auto hi = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(_mm_shuffle_ps(l, l, 0xAA)),
+            _mm_shuffle_ps(l, l, 0xFF), 1);
+        const auto out = reinterpret_cast<__m128i*>(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm256_cvtps_ph(
+            _mm256_blend_ps(lo, one, 0x88), _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128(out + 1, _mm256_cvtps_ph(
+            _mm256_blend_ps(hi, one, 0x88), _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+USAGI_TARGET("avx,f16c")
+std::size_t convertLa32fToRgba16fF16c(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+    for(; i + 2 <= pixel_count; i += 2)
+    {
+        // l0 a0 l1 a1 -> l0 l0 l0 a0 l1 l1 l1 a1
+        const auto la = _mm_loadu_ps(src + i * 2);
+        const auto v = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(
+                _mm_shuffle_ps(la, la, _MM_SHUFFLE(1, 0, 0, 0))),
+            _mm_shuffle_ps(la, la, _MM_SHUFFLE(3, 2, 2, 2)), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4),
+            _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+#endif
+}
+
+void usagi::convertRgb8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().ssse3)
+        i = convertRgb8ToRgba8Ssse3(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 0xFF;
+    }
+}
+
+void usagi::convertL8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    i = convertL8ToRgba8Sse2(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        dst[i * 4 + 0] = src[i];
+        dst[i * 4 + 1] = src[i];
+        dst[i * 4 + 2] = src[i];
+        dst[i * 4 + 3] = 0xFF;
+    }
+}
+
+void usagi::convertLa8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    i = convertLa8ToRgba8Sse2(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        dst[i * 4 + 0] = src[i * 2 + 0];
+        dst[i * 4 + 1] = src[i * 2 + 0];
+        dst[i * 4 + 2] = src[i * 2 + 0];
+        dst[i * 4 + 3] = src[i * 2 + 1];
+    }
+}
+
+void usagi::premultiplyRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().avx2)
+        i = premultiplyRgba8Avx2(src, dst, pixel_count);
+    i += premultiplyRgba8Sse2(src + i * 4, dst + i * 4, pixel_count - i);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        const auto p = i * 4;
+        const auto alpha = src[p + 3];
+        dst[p + 0] = premultiply(src[p + 0], alpha);
+        dst[p + 1] = premultiply(src[p + 1], alpha);
+        dst[p + 2] = premultiply(src[p + 2], alpha);
+        dst[p + 3] = alpha;
+    }
+}
+
+void usagi::premultiplySrgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    const std::size_t pixel_count)
+{
+    // the transfer function is not vectorized. the lookup tables keep the
+    // conversion cheap enough compared with decoding.
+    auto &tables = srgbTables();
+    for(std::size_t i = 0; i < pixel_count; ++i)
+    {
+        const auto p = i * 4;
+        const auto alpha = src[p + 3];
+        const auto a = alpha / 255.f;
+        for(std::size_t c = 0; c < 3; ++c)
+            dst[p + c] = tables.toSrgb(tables.to_linear[src[p + c]] * a);
+        dst[p + 3] = alpha;
+    }
+}
+
+void usagi::convertFloat32ToFloat16(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().f16c)
+        i = convertFloat32ToFloat16F16c(src, dst, count);
+#endif
+    for(; i < count; ++i)
+        dst[i] = floatToHalf(src[i]);
+}
+
+void usagi::convertRgb32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().f16c)
+        i = convertRgb32fToRgba16fF16c(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        dst[i * 4 + 0] = floatToHalf(src[i * 3 + 0]);
+        dst[i * 4 + 1] = floatToHalf(src[i * 3 + 1]);
+        dst[i * 4 + 2] = floatToHalf(src[i * 3 + 2]);
+        dst[i * 4 + 3] = floatToHalf(1.f);
+    }
+}
+
+void usagi::convertL32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().f16c)
+        i = convertL32fToRgba16fF16c(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        const auto l = floatToHalf(src[i]);
+        dst[i * 4 + 0] = l;
+        dst[i * 4 + 1] = l;
+        dst[i * 4 + 2] = l;
+        dst[i * 4 + 3] = floatToHalf(1.f);
+    }
+}
+
+void usagi::convertLa32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    const std::size_t pixel_count)
+{
+    std::size_t i = 0;
+#ifdef USAGI_PIXEL_SIMD
+    if(cpu().f16c)
+        i = convertLa32fToRgba16fF16c(src, dst, pixel_count);
+#endif
+    for(; i < pixel_count; ++i)
+    {
+        const auto l = floatToHalf(src[i * 2 + 0]);
+        dst[i * 4 + 0] = l;
+        dst[i * 4 + 1] = l;
+        dst[i * 4 + 2] = l;
+        dst[i * 4 + 3] = floatToHalf(src[i * 2 + 1]);
+    }
+}
+
+std::uint16_t usagi::floatToHalf(const float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+    const auto abs = bits & 0x7FFFFFFF;
+
+    // infinity or NaN, keeping NaN quiet
+    if(abs >= 0x7F800000)
+        return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);
+    // rounds to a value larger than the max half 65504
+    if(abs >= 0x477FF000)
+        return sign | 0x7C00;
+    // below the min normal half 2^-14, represented in units of 2^-24
+    if(abs < 0x38800000)
+    {
+        float magnitude;
+        std::memcpy(&magnitude, &abs, sizeof(magnitude));
+        // scaling by a power of two is exact and the default rounding mode
+        // rounds to nearest even
+        return sign | static_cast<std::uint16_t>(
+            std::nearbyint(magnitude * 16777216.f));
+    }
+    // rebias the exponent from 127 to 15 and round the mantissa to nearest
+    // even. a carry into the exponent gives the correct result.
+    auto h = abs - 0x38000000;
+    h += 0xFFF + ((h >> 13) & 1);
+    return sign | static_cast<std::uint16_t>(h >> 13);
+}
+
+float usagi::halfToFloat(const std::uint16_t value)
+{
+    const auto sign = std::uint32_t(value & 0x8000) << 16;
+    const auto exponent = (value >> 10) & 0x1F;
+    const auto mantissa = std::uint32_t(value & 0x3FF);
+
+    if(exponent == 0)
+    {
+        const auto magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    std::uint32_t bits;
+    if(exponent == 0x1F)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Conversions of decoded pixels into the formats consumed by the GPU. The
+ * kernels use SSE2, SSSE3, AVX2 and F16C when the CPU supports them, which is
+ * detected at runtime, and fall back to scalar code otherwise. The source and
+ * the destination may be the same buffer if the pixel sizes are the same.
+ * They are usually written into mapped staging memory, so the destination is
+ * only written sequentially and never read.
+ */
+
+namespace usagi
+{
+/**
+ * \brief Expand 8-bit RGB pixels to RGBA with opaque alpha.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertRgb8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Expand 8-bit luminance pixels to gray RGBA with opaque alpha.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertL8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Expand 8-bit luminance-alpha pixels to gray RGBA.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertLa8ToRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Multiply the color of 8-bit RGBA pixels by their alpha, treating
+ * the color as linear values.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void premultiplyRgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Multiply the color of 8-bit RGBA pixels by their alpha, where the
+ * color is sRGB encoded. The color is converted to linear space for the
+ * multiplication, so that it matches the blending done by the GPU after
+ * sampling sRGB images.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void premultiplySrgba8(
+    const std::uint8_t *src,
+    std::uint8_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Convert floats to IEEE half-precision floats, rounding to the
+ * nearest even value.
+ * \param src
+ * \param dst
+ * \param count The number of values.
+ */
+void convertFloat32ToFloat16(
+    const float *src,
+    std::uint16_t *dst,
+    std::size_t count);
+
+/**
+ * \brief Convert 32-bit float RGB pixels to 16-bit float RGBA with opaque
+ * alpha.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertRgb32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Convert 32-bit float luminance pixels to gray 16-bit float RGBA with
+ * opaque alpha.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertL32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    std::size_t pixel_count);
+
+/**
+ * \brief Convert 32-bit float luminance-alpha pixels to gray 16-bit float
+ * RGBA.
+ * \param src
+ * \param dst
+ * \param pixel_count
+ */
+void convertLa32fToRgba16f(
+    const float *src,
+    std::uint16_t *dst,
+    std::size_t pixel_count);
+
+std::uint16_t floatToHalf(float value);
+float halfToFloat(std::uint16_t value);
+}
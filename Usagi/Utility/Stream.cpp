@@ -6,3 +6,47 @@ std::string usagi::readStreamAsString(std::istream &in)
     const std::istreambuf_iterator<char> begin(in), end;
     return { begin, end };
 }
+
+usagi::MemoryViewStreamBuf::MemoryViewStreamBuf(MemoryView view)
+    : mView { std::move(view) }
+{
+    // the get area is never written through
+    const auto begin = const_cast<char*>(mView.asStringView().data());
+    setg(begin, begin, begin + mView.size());
+}
+
+usagi::MemoryViewStreamBuf::pos_type usagi::MemoryViewStreamBuf::seekoff(
+    const off_type off,
+    const std::ios_base::seekdir dir,
+    const std::ios_base::openmode which)
+{
+    if(!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+    off_type base;
+    switch(dir)
+    {
+        case std::ios_base::beg: base = 0; break;
+        case std::ios_base::cur: base = gptr() - eback(); break;
+        case std::ios_base::end: base = egptr() - eback(); break;
+        default: return pos_type(off_type(-1));
+    }
+    const auto pos = base + off;
+    if(pos < 0 || pos > egptr() - eback())
+        return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+usagi::MemoryViewStreamBuf::pos_type usagi::MemoryViewStreamBuf::seekpos(
+    const pos_type pos,
+    const std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+usagi::MemoryViewInputStream::MemoryViewInputStream(MemoryView view)
+    : std::istream { nullptr }
+    , mBuffer { std::move(view) }
+{
+    rdbuf(&mBuffer);
+}
@@ -1,8 +1,11 @@
 ﻿#pragma once
 
 #include <istream>
+#include <streambuf>
 #include <string>
 
+#include "MemoryView.hpp"
+
 namespace usagi
 {
 /**
@@ -13,4 +16,35 @@ namespace usagi
  * \return
  */
 std::string readStreamAsString(std::istream &in);
+
+/**
+ * \brief A stream buffer reading from memory without copying it. Seeking is
+ * supported.
+ */
+class MemoryViewStreamBuf : public std::streambuf
+{
+    MemoryView mView;
+
+protected:
+    pos_type seekoff(
+        off_type off,
+        std::ios_base::seekdir dir,
+        std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+public:
+    explicit MemoryViewStreamBuf(MemoryView view);
+};
+
+/**
+ * \brief An input stream over a MemoryView, which is kept alive by the
+ * stream.
+ */
+class MemoryViewInputStream : public std::istream
+{
+    MemoryViewStreamBuf mBuffer;
+
+public:
+    explicit MemoryViewInputStream(MemoryView view);
+};
 }